@@ -66,6 +66,7 @@ using ndn::security::v2::ValidationError;
 using ndn::security::ValidatorConfig;
 
 using std::shared_ptr;
+using std::unique_ptr;
 using std::make_shared;
 using std::bind;
 using std::placeholders::_1;
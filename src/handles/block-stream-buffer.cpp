@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "block-stream-buffer.hpp"
+
+#include <ndn-cxx/encoding/tlv.hpp>
+
+#include <atomic>
+#include <cstring>
+
+namespace repo {
+
+const size_t BlockStreamBuffer::MAX_ELEMENT_SIZE;
+const size_t BlockStreamBuffer::MIN_CHUNK_SIZE;
+
+BlockStreamBuffer::BlockStreamBuffer(size_t chunkSize)
+  : m_chunk(make_shared<ndn::Buffer>(std::max(chunkSize, MIN_CHUNK_SIZE)))
+  , m_begin(0)
+  , m_end(0)
+{
+}
+
+void
+BlockStreamBuffer::commit(size_t nBytes)
+{
+  BOOST_ASSERT(nBytes <= getFreeSize());
+  m_end += nBytes;
+}
+
+bool
+BlockStreamBuffer::next(Block& element)
+{
+  const ndn::Buffer& chunk = *m_chunk;
+  ndn::Buffer::const_iterator begin = chunk.begin() + m_begin;
+  ndn::Buffer::const_iterator end = chunk.begin() + m_end;
+  ndn::Buffer::const_iterator pos = begin;
+
+  uint64_t type = 0;
+  uint64_t length = 0;
+  bool isComplete = ndn::tlv::readVarNumber(pos, end, type) &&
+                    ndn::tlv::readVarNumber(pos, end, length);
+  if (!isComplete)
+    return false;
+
+  size_t headerSize = pos - begin;
+  if (length > MAX_ELEMENT_SIZE - headerSize)
+    BOOST_THROW_EXCEPTION(Error("TLV element of " + std::to_string(length) +
+                                " octets exceeds the maximum packet size"));
+
+  if (static_cast<size_t>(end - pos) < length)
+    return false;
+
+  element = Block(m_chunk, begin, pos + length, true);
+  m_begin += headerSize + length;
+  return true;
+}
+
+void
+BlockStreamBuffer::prepare()
+{
+  if (m_begin == m_end && m_chunk.use_count() == 1) {
+    // use_count() is a relaxed load: the fence orders the coming writes to the chunk after
+    // the last reads of an element released on another thread
+    std::atomic_thread_fence(std::memory_order_acquire);
+    m_begin = m_end = 0;
+    return;
+  }
+
+  if (m_chunk->size() - m_begin >= MAX_ELEMENT_SIZE)
+    return;
+
+  size_t nPending = m_end - m_begin;
+  if (m_chunk.use_count() == 1) {
+    // nobody holds on to the returned elements, the chunk can be reused, after the same
+    // fence as above
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::memmove(m_chunk->data(), m_chunk->data() + m_begin, nPending);
+  }
+  else {
+    auto chunk = make_shared<ndn::Buffer>(m_chunk->size());
+    std::memcpy(chunk->data(), m_chunk->data() + m_begin, nPending);
+    m_chunk = chunk;
+  }
+  m_begin = 0;
+  m_end = nPending;
+}
+
+} // namespace repo
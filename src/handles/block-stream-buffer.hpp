@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_HANDLES_BLOCK_STREAM_BUFFER_HPP
+#define REPO_HANDLES_BLOCK_STREAM_BUFFER_HPP
+
+#include "../common.hpp"
+
+#include <ndn-cxx/encoding/buffer.hpp>
+
+namespace repo {
+
+/**
+ * @brief receive buffer that splits a byte stream into TLV elements without copying them
+ *
+ * Bytes are received straight into a large chunk and every complete element is returned
+ * as a Block that shares the chunk, so a single receive can yield many packets and none
+ * of them is copied.  When the room left after the pending element can no longer hold a
+ * maximum size packet, the chunk is recycled if no Block references it anymore, or
+ * otherwise replaced by a fresh one; in both cases only the incomplete tail is copied,
+ * so at most one partial packet is moved per chunk rather than the leftover of every receive.
+ */
+class BlockStreamBuffer : noncopyable
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  /**
+   * @brief the largest element that is accepted from the stream
+   */
+  static const size_t MAX_ELEMENT_SIZE = 8800;
+
+  /**
+   * @brief the smallest chunk size, anything smaller is rounded up to it
+   */
+  static const size_t MIN_CHUNK_SIZE = 2 * MAX_ELEMENT_SIZE;
+
+  explicit
+  BlockStreamBuffer(size_t chunkSize = 1024 * 1024);
+
+  /**
+   * @brief make sure the element being received fits in the chunk
+   *
+   * Call it before getFreeSpace() and after dropping the elements that are not needed
+   * anymore, so that the chunk can be reused rather than replaced.
+   */
+  void
+  prepare();
+
+  /**
+   * @brief where the next received bytes should be written
+   */
+  uint8_t*
+  getFreeSpace()
+  {
+    return m_chunk->data() + m_end;
+  }
+
+  /**
+   * @brief how many bytes can be written at getFreeSpace()
+   */
+  size_t
+  getFreeSize() const
+  {
+    return m_chunk->size() - m_end;
+  }
+
+  /**
+   * @brief account for @p nBytes written at getFreeSpace()
+   */
+  void
+  commit(size_t nBytes);
+
+  /**
+   * @brief take the next complete element off the stream
+   * @return false if the buffered bytes do not hold a complete element yet
+   * @throw Error the next element is longer than MAX_ELEMENT_SIZE
+   */
+  bool
+  next(Block& element);
+
+  /**
+   * @brief number of buffered bytes that are not part of a returned element yet
+   */
+  size_t
+  getPendingSize() const
+  {
+    return m_end - m_begin;
+  }
+
+  size_t
+  getChunkSize() const
+  {
+    return m_chunk->size();
+  }
+
+private:
+  shared_ptr<ndn::Buffer> m_chunk;
+  size_t m_begin;  ///< start of the first element not returned yet
+  size_t m_end;    ///< end of the received bytes
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_BLOCK_STREAM_BUFFER_HPP
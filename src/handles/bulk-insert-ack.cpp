@@ -0,0 +1,58 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "bulk-insert-ack.hpp"
+#include "repo-tlv.hpp"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/encoding/encoding-buffer.hpp>
+
+namespace repo {
+
+Block
+BulkInsertAck::wireEncode() const
+{
+  ndn::EncodingBuffer encoder;
+  size_t totalLength = ndn::prependNonNegativeIntegerBlock(encoder, tlv::FailedNum, nFailed);
+  totalLength += ndn::prependNonNegativeIntegerBlock(encoder, tlv::InsertNum, nInserted);
+  encoder.prependVarNumber(totalLength);
+  encoder.prependVarNumber(tlv::BulkInsertAck);
+  return encoder.block();
+}
+
+void
+BulkInsertAck::wireDecode(const Block& wire)
+{
+  if (wire.type() != tlv::BulkInsertAck)
+    BOOST_THROW_EXCEPTION(Error("BulkInsertAck malformed"));
+
+  wire.parse();
+  auto val = wire.find(tlv::InsertNum);
+  if (val == wire.elements_end())
+    BOOST_THROW_EXCEPTION(Error("BulkInsertAck is missing InsertNum"));
+  nInserted = ndn::readNonNegativeInteger(*val);
+
+  val = wire.find(tlv::FailedNum);
+  if (val == wire.elements_end())
+    BOOST_THROW_EXCEPTION(Error("BulkInsertAck is missing FailedNum"));
+  nFailed = ndn::readNonNegativeInteger(*val);
+}
+
+} // namespace repo
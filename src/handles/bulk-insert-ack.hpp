@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_HANDLES_BULK_INSERT_ACK_HPP
+#define REPO_HANDLES_BULK_INSERT_ACK_HPP
+
+#include "common.hpp"
+
+namespace repo {
+
+/**
+ * @brief cumulative counts a bulk insert connection reports back in acknowledgement mode
+ *
+ * BulkInsertAck ::= BULK-INSERT-ACK-TYPE TLV-LENGTH
+ *                     InsertNum
+ *                     FailedNum
+ *
+ * Both counts cover the oldest packets received on the connection: InsertNum + FailedNum
+ * is the number of TLV elements, from the first one on, that have been processed, so a
+ * sender can drop its copies of that many of the oldest elements it has sent.
+ */
+class BulkInsertAck
+{
+public:
+  class Error : public ndn::tlv::Error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : ndn::tlv::Error(what)
+    {
+    }
+  };
+
+  BulkInsertAck(uint64_t nInserted = 0, uint64_t nFailed = 0)
+    : nInserted(nInserted)
+    , nFailed(nFailed)
+  {
+  }
+
+  explicit
+  BulkInsertAck(const Block& wire)
+  {
+    wireDecode(wire);
+  }
+
+  Block
+  wireEncode() const;
+
+  /**
+   * @throw Error @p wire is not a BulkInsertAck
+   */
+  void
+  wireDecode(const Block& wire);
+
+public:
+  uint64_t nInserted;  ///< packets inserted
+  uint64_t nFailed;    ///< elements not inserted, because they were not valid Data or already stored
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_BULK_INSERT_ACK_HPP
@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "bulk-insert-pipeline.hpp"
+
+#include <ndn-cxx/util/logger.hpp>
+
+namespace repo {
+
+NDN_LOG_INIT(repo.BulkInsertPipeline);
+
+BulkInsertPipeline::BulkInsertPipeline(boost::asio::io_service& ioService,
+                                       RepoStorage& storageHandle, size_t nWorkers)
+  : m_ioService(ioService)
+  , m_storageHandle(storageHandle)
+  , m_nWorkers(nWorkers)
+  , m_nPending(0)
+  , m_isStopping(false)
+  , m_isInsertPosted(false)
+{
+  if (m_nWorkers == 0)
+    m_nWorkers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+BulkInsertPipeline::~BulkInsertPipeline()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_jobMutex);
+    m_isStopping = true;
+  }
+  m_hasJob.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void
+BulkInsertPipeline::submit(std::vector<Block> elements, const InsertCallback& callback)
+{
+  if (m_workers.empty()) {
+    for (size_t i = 0; i < m_nWorkers; ++i) {
+      m_workers.emplace_back(&BulkInsertPipeline::runWorker, this);
+    }
+  }
+
+  m_nPending += elements.size();
+  {
+    std::lock_guard<std::mutex> lock(m_jobMutex);
+    m_jobs.push_back(Job{std::move(elements), callback});
+  }
+  m_hasJob.notify_one();
+}
+
+void
+BulkInsertPipeline::runWorker()
+{
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_jobMutex);
+      m_hasJob.wait(lock, [this] { return m_isStopping || !m_jobs.empty(); });
+      if (m_isStopping)
+        return;
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+
+    PreparedBatch batch = prepare(job);
+
+    bool needsPost = false;
+    {
+      std::lock_guard<std::mutex> lock(m_preparedMutex);
+      m_prepared.push_back(std::move(batch));
+      needsPost = !m_isInsertPosted;
+      m_isInsertPosted = true;
+    }
+    if (needsPost)
+      m_ioService.post(bind(&BulkInsertPipeline::insertPrepared, this));
+  }
+}
+
+BulkInsertPipeline::PreparedBatch
+BulkInsertPipeline::prepare(Job& job)
+{
+  PreparedBatch batch;
+  batch.nElements = job.elements.size();
+  batch.callback = std::move(job.callback);
+  for (const Block& element : job.elements) {
+    try {
+      auto data = make_shared<Data>(element);
+      batch.metas.push_back(RepoStorage::prepareInsert(*data));
+      batch.data.push_back(data);
+    }
+    catch (const std::runtime_error& error) {
+      /// \todo Catch specific error after determining what wireDecode() can throw
+      std::cerr << "Error decoding received Data packet" << std::endl;
+    }
+  }
+  return batch;
+}
+
+void
+BulkInsertPipeline::insertPrepared()
+{
+  std::vector<PreparedBatch> prepared;
+  {
+    std::lock_guard<std::mutex> lock(m_preparedMutex);
+    prepared.swap(m_prepared);
+    m_isInsertPosted = false;
+  }
+
+  // everything prepared so far goes into storage in one transaction
+  std::vector<shared_ptr<const Data>> data;
+  std::vector<Storage::ItemMeta> metas;
+  for (const PreparedBatch& batch : prepared) {
+    data.insert(data.end(), batch.data.begin(), batch.data.end());
+    metas.insert(metas.end(), batch.metas.begin(), batch.metas.end());
+  }
+  std::vector<bool> isInserted(data.size(), false);
+  if (!data.empty()) {
+    // a storage error fails these batches only; their submitters still hear back
+    try {
+      isInserted = m_storageHandle.insertBatch(data, metas);
+    }
+    catch (const std::exception& e) {
+      NDN_LOG_ERROR("Failed to insert " << data.size() << " bulk inserted data: " << e.what());
+    }
+  }
+
+  auto result = isInserted.begin();
+  for (const PreparedBatch& batch : prepared) {
+    std::vector<bool> batchResult(result, result + batch.data.size());
+    result += batch.data.size();
+    m_nPending -= batch.nElements;
+    if (batch.callback)
+      batch.callback(batch.data, batchResult, batch.nElements);
+  }
+}
+
+} // namespace repo
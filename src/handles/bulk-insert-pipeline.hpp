@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_HANDLES_BULK_INSERT_PIPELINE_HPP
+#define REPO_HANDLES_BULK_INSERT_PIPELINE_HPP
+
+#include "common.hpp"
+#include "storage/repo-storage.hpp"
+
+#include <boost/asio/io_service.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace repo {
+
+/**
+ * @brief decodes bulk inserted packets on worker threads and inserts them from one thread
+ *
+ * Decoding a Data packet and computing its implicit digest and keyLocator hash are done by
+ * a pool of worker threads.  The prepared batches are handed back to the io_service thread,
+ * which stays the only one touching RepoStorage, so the index is kept consistent with the
+ * command handles that share it.  Batches that are ready at the same time are written in
+ * one storage transaction.  Batches of one submitter may be inserted out of order.
+ */
+class BulkInsertPipeline : noncopyable
+{
+public:
+  /**
+   * @brief called on the io_service thread once a batch has been inserted
+   * @param data        the packets that could be decoded
+   * @param isInserted  whether each of @p data was inserted
+   * @param nElements   the number of elements that were submitted
+   */
+  typedef std::function<void(const std::vector<shared_ptr<const Data>>& data,
+                             const std::vector<bool>& isInserted,
+                             size_t nElements)> InsertCallback;
+
+  /**
+   * @param nWorkers  the number of worker threads, 0 uses one per hardware thread
+   */
+  BulkInsertPipeline(boost::asio::io_service& ioService, RepoStorage& storageHandle,
+                     size_t nWorkers = 0);
+
+  ~BulkInsertPipeline();
+
+  /**
+   * @brief decode @p elements as Data on a worker thread and insert them
+   *
+   * Must be called on the io_service thread.  The worker threads are started on first use.
+   */
+  void
+  submit(std::vector<Block> elements, const InsertCallback& callback);
+
+  /**
+   * @brief number of submitted elements that are not inserted yet
+   */
+  size_t
+  getNPending() const
+  {
+    return m_nPending;
+  }
+
+  size_t
+  getNWorkers() const
+  {
+    return m_nWorkers;
+  }
+
+private:
+  struct Job
+  {
+    std::vector<Block> elements;
+    InsertCallback callback;
+  };
+
+  struct PreparedBatch
+  {
+    std::vector<shared_ptr<const Data>> data;
+    std::vector<Storage::ItemMeta> metas;
+    size_t nElements;
+    InsertCallback callback;
+  };
+
+  void
+  runWorker();
+
+  static PreparedBatch
+  prepare(Job& job);
+
+  /**
+   * @brief insert every prepared batch, on the io_service thread
+   */
+  void
+  insertPrepared();
+
+private:
+  boost::asio::io_service& m_ioService;
+  RepoStorage& m_storageHandle;
+  size_t m_nWorkers;
+  std::vector<std::thread> m_workers;
+  size_t m_nPending;
+
+  std::mutex m_jobMutex;
+  std::condition_variable m_hasJob;
+  std::deque<Job> m_jobs;
+  bool m_isStopping;
+
+  std::mutex m_preparedMutex;
+  std::vector<PreparedBatch> m_prepared;
+  bool m_isInsertPosted;
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_BULK_INSERT_PIPELINE_HPP
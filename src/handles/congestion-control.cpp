@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "congestion-control.hpp"
+
+#include <limits>
+
+namespace repo {
+
+static const double MIN_WINDOW = 1.0;
+
+RttEstimator::RttEstimator(const ndn::time::milliseconds& initialRto,
+                           const ndn::time::milliseconds& minRto,
+                           const ndn::time::milliseconds& maxRto)
+  : m_minRto(minRto)
+  , m_maxRto(maxRto)
+  , m_srtt(0)
+  , m_rttVar(0)
+  , m_rto(initialRto)
+  , m_hasMeasurement(false)
+{
+}
+
+void
+RttEstimator::addMeasurement(const ndn::time::nanoseconds& rtt)
+{
+  if (!m_hasMeasurement) {
+    m_srtt = rtt;
+    m_rttVar = rtt / 2;
+    m_hasMeasurement = true;
+  }
+  else {
+    // alpha = 1/8, beta = 1/4
+    ndn::time::nanoseconds error = m_srtt > rtt ? m_srtt - rtt : rtt - m_srtt;
+    m_rttVar = (m_rttVar * 3 + error) / 4;
+    m_srtt = (m_srtt * 7 + rtt) / 8;
+  }
+  m_rto = std::min(std::max(m_srtt + 4 * m_rttVar, m_minRto), m_maxRto);
+}
+
+void
+RttEstimator::backoffRto()
+{
+  m_rto = std::min(m_rto * 2, m_maxRto);
+}
+
+AimdWindow::AimdWindow(size_t initialWindow, size_t maxWindow)
+  : m_cwnd(std::max<double>(initialWindow, MIN_WINDOW))
+  , m_ssthresh(std::numeric_limits<double>::max())
+  , m_maxWindow(std::max<double>(maxWindow, m_cwnd))
+  , m_hasDecreased(false)
+  , m_recoveryPoint(0)
+{
+}
+
+void
+AimdWindow::increase()
+{
+  if (m_cwnd < m_ssthresh)
+    m_cwnd += 1.0;
+  else
+    m_cwnd += 1.0 / m_cwnd;
+  m_cwnd = std::min(m_cwnd, m_maxWindow);
+}
+
+void
+AimdWindow::decrease(SegmentNo lostSegment, SegmentNo highestSegment)
+{
+  // the other losses of the same window are part of the same congestion event
+  if (m_hasDecreased && lostSegment <= m_recoveryPoint)
+    return;
+
+  m_ssthresh = std::max(m_cwnd / 2, MIN_WINDOW);
+  m_cwnd = m_ssthresh;
+  m_hasDecreased = true;
+  m_recoveryPoint = highestSegment;
+}
+
+DeficitRoundRobin::DeficitRoundRobin(size_t quantum)
+  : m_quantum(std::max<size_t>(quantum, 1))
+{
+}
+
+void
+DeficitRoundRobin::activate(ProcessId processId)
+{
+  if (m_deficits.insert({processId, 0}).second)
+    m_round.push_back(processId);
+}
+
+void
+DeficitRoundRobin::deactivate(ProcessId processId)
+{
+  if (m_deficits.erase(processId) > 0)
+    m_round.remove(processId);
+}
+
+size_t
+DeficitRoundRobin::serve(size_t budget, const SendCallback& send)
+{
+  size_t nSent = 0;
+  while (nSent < budget && !m_round.empty()) {
+    ProcessId processId = m_round.front();
+    m_round.pop_front();
+    // a turn cut short by the budget is resumed, not started over
+    size_t& deficit = m_deficits[processId];
+    if (deficit == 0)
+      deficit = m_quantum;
+
+    bool isBacklogged = true;
+    while (deficit > 0 && nSent < budget) {
+      if (!send(processId)) {
+        isBacklogged = false;
+        break;
+      }
+      --deficit;
+      ++nSent;
+    }
+
+    if (!isBacklogged)
+      m_deficits.erase(processId);
+    else if (deficit > 0)
+      m_round.push_front(processId);
+    else
+      m_round.push_back(processId);
+  }
+  return nSent;
+}
+
+} // namespace repo
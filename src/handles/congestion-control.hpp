@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_HANDLES_CONGESTION_CONTROL_HPP
+#define REPO_HANDLES_CONGESTION_CONTROL_HPP
+
+#include "../common.hpp"
+
+namespace repo {
+
+/**
+ * @brief RttEstimator computes the retransmission timeout of a fetch process
+ *
+ * SRTT, RTTVAR and RTO follow RFC 6298.  Only samples of segments that were not
+ * retransmitted should be added (Karn's algorithm).
+ */
+class RttEstimator
+{
+public:
+  explicit
+  RttEstimator(const ndn::time::milliseconds& initialRto = ndn::time::milliseconds(1000),
+               const ndn::time::milliseconds& minRto = ndn::time::milliseconds(200),
+               const ndn::time::milliseconds& maxRto = ndn::time::milliseconds(4000));
+
+  void
+  addMeasurement(const ndn::time::nanoseconds& rtt);
+
+  /**
+   * @brief double the RTO after a timeout, up to the maximum
+   */
+  void
+  backoffRto();
+
+  ndn::time::milliseconds
+  getRto() const
+  {
+    return ndn::time::duration_cast<ndn::time::milliseconds>(m_rto);
+  }
+
+  /**
+   * @return smoothed RTT, or zero before the first measurement
+   */
+  ndn::time::nanoseconds
+  getSmoothedRtt() const
+  {
+    return m_srtt;
+  }
+
+  ndn::time::nanoseconds
+  getRttVariation() const
+  {
+    return m_rttVar;
+  }
+
+private:
+  ndn::time::nanoseconds m_minRto;
+  ndn::time::nanoseconds m_maxRto;
+  ndn::time::nanoseconds m_srtt;
+  ndn::time::nanoseconds m_rttVar;
+  ndn::time::nanoseconds m_rto;
+  bool m_hasMeasurement;
+};
+
+/**
+ * @brief AimdWindow is the congestion window of a fetch process
+ *
+ * The window grows by one segment per Data in slow start and by one segment per
+ * window of Data in congestion avoidance.  A loss halves it, at most once per window:
+ * losses of segments sent before the last decrease do not decrease it again.
+ */
+class AimdWindow
+{
+public:
+  explicit
+  AimdWindow(size_t initialWindow = 12, size_t maxWindow = 1024);
+
+  void
+  increase();
+
+  /**
+   * @param lostSegment     the segment that timed out
+   * @param highestSegment  the highest segment sent so far
+   */
+  void
+  decrease(SegmentNo lostSegment, SegmentNo highestSegment);
+
+  /**
+   * @brief number of segments that may be in flight
+   */
+  size_t
+  getSize() const
+  {
+    return static_cast<size_t>(m_cwnd);
+  }
+
+  double
+  getSlowStartThreshold() const
+  {
+    return m_ssthresh;
+  }
+
+private:
+  double m_cwnd;
+  double m_ssthresh;
+  double m_maxWindow;
+  bool m_hasDecreased;
+  SegmentNo m_recoveryPoint; ///< highest segment sent at the last decrease
+};
+
+/**
+ * @brief DeficitRoundRobin shares a budget of Interests among fetch processes
+ *
+ * Processes that have Interests to send are served in turn.  On each turn a process
+ * earns a quantum of credit and sends while it has credit, the budget lasts and its
+ * window has room; a process whose window fills up leaves the round, forfeiting its
+ * credit, and rejoins at the tail when activated again.  A turn cut short by the budget
+ * is resumed first when the budget allows again.  Because every Interest costs
+ * the same, each active process gets an equal share of the budget whatever its window.
+ */
+class DeficitRoundRobin
+{
+public:
+  /**
+   * @brief send one Interest for a process
+   * @return false if the process has nothing it may send now
+   */
+  typedef std::function<bool(ProcessId)> SendCallback;
+
+  explicit
+  DeficitRoundRobin(size_t quantum = 1);
+
+  /**
+   * @brief let @p processId take part in the next rounds, unless it already does
+   */
+  void
+  activate(ProcessId processId);
+
+  void
+  deactivate(ProcessId processId);
+
+  bool
+  isActive(ProcessId processId) const
+  {
+    return m_deficits.count(processId) > 0;
+  }
+
+  /**
+   * @return the number of processes waiting for their turn
+   */
+  size_t
+  size() const
+  {
+    return m_round.size();
+  }
+
+  /**
+   * @brief serve the active processes until @p budget Interests are sent or none is left
+   * @return the number of Interests sent
+   */
+  size_t
+  serve(size_t budget, const SendCallback& send);
+
+private:
+  size_t m_quantum;
+  std::list<ProcessId> m_round;
+  std::map<ProcessId, size_t> m_deficits;
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_CONGESTION_CONTROL_HPP
@@ -19,16 +19,28 @@
 
 #include "delete-handle.hpp"
 
+#include <limits>
+
 namespace repo {
 
+static const milliseconds PROCESS_DELETE_TIME(10000);
+static const size_t DEFAULT_CHUNK_SIZE = 1000;
+
 DeleteHandle::DeleteHandle(Face& face, RepoStorage& storageHandle, KeyChain& keyChain,
                            Scheduler& scheduler,
                            Validator& validator)
   : BaseHandle(face, storageHandle, keyChain, scheduler)
   , m_validator(validator)
+  , m_chunkSize(DEFAULT_CHUNK_SIZE)
 {
 }
 
+void
+DeleteHandle::setChunkSize(size_t nEntries)
+{
+  m_chunkSize = std::max<size_t>(nEntries, 1);
+}
+
 void
 DeleteHandle::onInterest(const Name& prefix, const Interest& interest)
 {
@@ -70,22 +82,41 @@ DeleteHandle::listen(const Name& prefix)
 {
   getFace().setInterestFilter(Name(prefix).append("delete"),
                               bind(&DeleteHandle::onInterest, this, _1, _2));
+  getFace().setInterestFilter(Name(prefix).append("delete check"),
+                              bind(&DeleteHandle::onCheckInterest, this, _1, _2));
 }
 
 void
-DeleteHandle::positiveReply(const Interest& interest, const RepoCommandParameter& parameter,
-                            uint64_t statusCode, uint64_t nDeletedDatas)
+DeleteHandle::onCheckInterest(const Name& prefix, const Interest& interest)
 {
-  RepoCommandResponse response;
-  if (parameter.hasProcessId()) {
-    response.setProcessId(parameter.getProcessId());
-    response.setStatusCode(statusCode);
-    response.setDeleteNum(nDeletedDatas);
+  m_validator.validate(interest,
+                       bind(&DeleteHandle::onCheckValidated, this, _1, prefix),
+                       bind(&DeleteHandle::onCheckValidated, this, _1, prefix));
+}
+
+void
+DeleteHandle::onCheckValidated(const Interest& interest, const Name& prefix)
+{
+  RepoCommandParameter parameter;
+  try {
+    extractParameter(interest, prefix, parameter);
+  }
+  catch (RepoCommandParameter::Error) {
+    negativeReply(interest, 403);
+    return;
   }
-  else {
-    response.setStatusCode(403);
+
+  if (!parameter.hasProcessId()) {
+    negativeReply(interest, 403);
+    return;
   }
-  reply(interest, response);
+  auto process = m_processes.find(parameter.getProcessId());
+  if (process == m_processes.end()) {
+    std::cerr << "no such processId: " << parameter.getProcessId() << std::endl;
+    negativeReply(interest, 404);
+    return;
+  }
+  reply(interest, process->second.response);
 }
 
 void
@@ -100,13 +131,10 @@ void
 DeleteHandle::processSingleDeleteCommand(const Interest& interest,
                                          RepoCommandParameter& parameter)
 {
-  int64_t nDeletedDatas = getStorageHandle().deleteData(parameter.getName());
-  if (nDeletedDatas == -1) {
-    std::cerr << "Deletion Failed!" <<std::endl;
-    negativeReply(interest, 405); //405 means deletion fail
-  }
-  else
-    positiveReply(interest, parameter, 200, nDeletedDatas);
+  ProcessInfo process;
+  process.prefix = parameter.getName();
+  process.isSegmented = false;
+  startProcess(interest, parameter, process);
 }
 
 void
@@ -116,30 +144,99 @@ DeleteHandle::processSegmentDeleteCommand(const Interest& interest,
   if (!parameter.hasStartBlockId())
     parameter.setStartBlockId(0);
 
-  if (parameter.hasEndBlockId()) {
-    SegmentNo startBlockId = parameter.getStartBlockId();
-    SegmentNo endBlockId = parameter.getEndBlockId();
-
-    if (startBlockId > endBlockId) {
-      negativeReply(interest, 403);
-      return;
-    }
-
-    Name prefix = parameter.getName();
-    uint64_t nDeletedDatas = 0;
-    for (SegmentNo i = startBlockId; i <= endBlockId; i++) {
-      Name name = prefix;
-      name.appendSegment(i);
-      if (getStorageHandle().deleteData(name)) {
-        nDeletedDatas++;
-      }
-    }
-    //All the data deleted, return 200
-    positiveReply(interest, parameter, 200, nDeletedDatas);
+  ProcessInfo process;
+  process.prefix = parameter.getName();
+  process.isSegmented = true;
+  process.startBlockId = parameter.getStartBlockId();
+  // without EndBlockId, every segment from StartBlockId on is deleted
+  process.endBlockId = parameter.hasEndBlockId() ? parameter.getEndBlockId() :
+                                                   std::numeric_limits<SegmentNo>::max();
+  if (process.startBlockId > process.endBlockId) {
+    negativeReply(interest, 403);
+    return;
+  }
+
+  process.response.setStartBlockId(process.startBlockId);
+  if (parameter.hasEndBlockId())
+    process.response.setEndBlockId(process.endBlockId);
+  startProcess(interest, parameter, process);
+}
+
+void
+DeleteHandle::startProcess(const Interest& interest, const RepoCommandParameter& parameter,
+                           const ProcessInfo& process)
+{
+  if (!parameter.hasProcessId()) {
+    negativeReply(interest, 403);
+    return;
+  }
+
+  ProcessId processId = parameter.getProcessId();
+  if (m_processes.count(processId) != 0) {
+    // a retransmitted command gets the progress of the running process
+    reply(interest, m_processes[processId].response);
+    return;
+  }
+
+  m_processes[processId] = process;
+  RepoCommandResponse& response = m_processes[processId].response;
+  response.setProcessId(processId);
+  response.setStatusCode(300);
+  response.setDeleteNum(0);
+
+  // small deletions are done by the time the command is answered
+  deleteChunk(processId);
+  if (response.getStatusCode() == 405) {
+    std::cerr << "Deletion Failed!" <<std::endl;
+    negativeReply(interest, 405); //405 means deletion fail
+  }
+  else
+    reply(interest, response);
+}
+
+void
+DeleteHandle::deleteChunk(ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end())
+    return;
+  ProcessInfo& process = it->second;
+  RepoCommandResponse& response = process.response;
+
+  ssize_t nDeletedDatas = process.isSegmented ?
+    getStorageHandle().deleteSegments(process.prefix, process.startBlockId, process.endBlockId,
+                                      m_chunkSize) :
+    getStorageHandle().deleteData(process.prefix, m_chunkSize);
+  if (nDeletedDatas == -1) {
+    response.setStatusCode(405);
+    deferredDeleteProcess(processId);
+    return;
   }
-  else {
-    BOOST_ASSERT(false); // segmented deletion without EndBlockId, not implemented
+
+  response.setDeleteNum(response.getDeleteNum() + nDeletedDatas);
+  if (static_cast<size_t>(nDeletedDatas) < m_chunkSize) {
+    //All the data deleted, StatusCode is refreshed as 200
+    response.setStatusCode(200);
+    deferredDeleteProcess(processId);
+    return;
   }
+
+  // yield to the event loop, so that Interests are served before the next chunk
+  getScheduler().scheduleEvent(milliseconds(0),
+                               bind(&DeleteHandle::deleteChunk, this, processId));
+}
+
+void
+DeleteHandle::deleteProcess(ProcessId processId)
+{
+  m_processes.erase(processId);
+}
+
+void
+DeleteHandle::deferredDeleteProcess(ProcessId processId)
+{
+  getScheduler().scheduleEvent(PROCESS_DELETE_TIME,
+                               bind(&DeleteHandle::deleteProcess, this, processId));
 }
 
 } // namespace repo
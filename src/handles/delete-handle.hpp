@@ -24,6 +24,16 @@
 
 namespace repo {
 
+using std::map;
+
+/**
+ * @brief DeleteHandle deletes data in chunks, as a background process
+ *
+ * Each turn of the event loop deletes at most the chunk size of entries, so that reads
+ * are served between the chunks of a large deletion.  A deletion finished within its
+ * first chunk is answered with StatusCode 200; otherwise the reply carries StatusCode 300
+ * and the progress so far, and the client follows it with "delete check" commands.
+ */
 class DeleteHandle : public BaseHandle
 {
 
@@ -45,6 +55,25 @@ public:
   virtual void
   listen(const Name& prefix);
 
+  /**
+   * @brief set the maximum number of entries deleted in one turn of the event loop
+   */
+  void
+  setChunkSize(size_t nEntries);
+
+private:
+  /**
+   * @brief Information of delete process including variables for response
+   */
+  struct ProcessInfo
+  {
+    RepoCommandResponse response;
+    Name prefix;
+    bool isSegmented;
+    SegmentNo startBlockId;
+    SegmentNo endBlockId; ///< std::numeric_limits<SegmentNo>::max() if the range is open-ended
+  };
+
 private:
   void
   onInterest(const Name& prefix, const Interest& interest);
@@ -56,14 +85,13 @@ private:
   onValidationFailed(const Interest& interest, const ValidationError& error);
 
   /**
-   * @todo delete check has not been realized due to the while loop of segmented data deletion.
+   * @brief handle delete check command, which reports the progress of a delete process
    */
   void
   onCheckInterest(const Name& prefix, const Interest& interest);
 
   void
-  positiveReply(const Interest& interest, const RepoCommandParameter& parameter,
-                uint64_t statusCode, uint64_t nDeletedDatas);
+  onCheckValidated(const Interest& interest, const Name& prefix);
 
   void
   negativeReply(const Interest& interest, uint64_t statusCode);
@@ -74,9 +102,34 @@ private:
   void
   processSegmentDeleteCommand(const Interest& interest, RepoCommandParameter& parameter);
 
+  /**
+   * @brief run the first chunk of a delete process and reply to its command
+   */
+  void
+  startProcess(const Interest& interest, const RepoCommandParameter& parameter,
+               const ProcessInfo& process);
+
+  /**
+   * @brief delete the next chunk of a process and schedule the one after it, if any
+   */
+  void
+  deleteChunk(ProcessId processId);
+
+  void
+  deleteProcess(ProcessId processId);
+
+  /**
+   * @brief schedule a event to delete the process
+   */
+  void
+  deferredDeleteProcess(ProcessId processId);
+
 private:
   Validator& m_validator;
 
+  map<ProcessId, ProcessInfo> m_processes;
+  size_t m_chunkSize;
+
 };
 
 } // namespace repo
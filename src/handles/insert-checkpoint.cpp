@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "insert-checkpoint.hpp"
+
+#include <cstring>
+
+namespace repo {
+
+static const uint32_t CHECKPOINT_MAGIC = 0x534e4952; // "RINS" on little-endian hosts
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+template<typename T>
+static void
+writeValue(std::ostream& os, const T& value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void
+writeInsertCheckpoints(std::ostream& os, const std::vector<InsertCheckpoint>& checkpoints)
+{
+  writeValue(os, CHECKPOINT_MAGIC);
+  writeValue(os, CHECKPOINT_VERSION);
+  writeValue(os, static_cast<uint32_t>(checkpoints.size()));
+  for (const InsertCheckpoint& checkpoint : checkpoints) {
+    writeValue(os, checkpoint.processId);
+    const Block& name = checkpoint.prefix.wireEncode();
+    writeValue(os, static_cast<uint32_t>(name.size()));
+    os.write(reinterpret_cast<const char*>(name.wire()), name.size());
+    writeValue(os, checkpoint.startBlockId);
+    writeValue(os, static_cast<uint8_t>(checkpoint.hasEndBlockId));
+    writeValue(os, checkpoint.endBlockId);
+    writeValue(os, static_cast<int64_t>(checkpoint.interestLifetime.count()));
+    writeValue(os, checkpoint.insertNum);
+    writeValue(os, checkpoint.base);
+    writeValue(os, static_cast<uint32_t>(checkpoint.received.size()));
+    for (uint64_t word : checkpoint.received) {
+      writeValue(os, word);
+    }
+  }
+}
+
+namespace {
+
+class CheckpointReader
+{
+public:
+  CheckpointReader(const uint8_t* buffer, size_t size)
+    : m_position(buffer)
+    , m_end(buffer + size)
+  {
+  }
+
+  template<typename T>
+  T
+  read()
+  {
+    T value;
+    std::memcpy(&value, readBytes(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  const uint8_t*
+  readBytes(size_t size)
+  {
+    if (static_cast<size_t>(m_end - m_position) < size)
+      BOOST_THROW_EXCEPTION(InsertCheckpoint::Error("Insert checkpoint is truncated"));
+    const uint8_t* bytes = m_position;
+    m_position += size;
+    return bytes;
+  }
+
+  bool
+  isAtEnd() const
+  {
+    return m_position == m_end;
+  }
+
+private:
+  const uint8_t* m_position;
+  const uint8_t* m_end;
+};
+
+} // namespace
+
+std::vector<InsertCheckpoint>
+readInsertCheckpoints(const uint8_t* buffer, size_t size)
+{
+  CheckpointReader reader(buffer, size);
+  if (reader.read<uint32_t>() != CHECKPOINT_MAGIC || reader.read<uint32_t>() != CHECKPOINT_VERSION)
+    BOOST_THROW_EXCEPTION(InsertCheckpoint::Error("Not an insert checkpoint of this version "
+                                                  "and byte order"));
+
+  // the counts are not trusted to size allocations before their data has been read
+  std::vector<InsertCheckpoint> checkpoints;
+  uint32_t nCheckpoints = reader.read<uint32_t>();
+  for (uint32_t i = 0; i < nCheckpoints; ++i) {
+    checkpoints.emplace_back();
+    InsertCheckpoint& checkpoint = checkpoints.back();
+    checkpoint.processId = reader.read<ProcessId>();
+    uint32_t nameSize = reader.read<uint32_t>();
+    const uint8_t* name = reader.readBytes(nameSize);
+    try {
+      checkpoint.prefix.wireDecode(Block(name, nameSize));
+    }
+    catch (const ndn::tlv::Error& e) {
+      BOOST_THROW_EXCEPTION(InsertCheckpoint::Error("Insert checkpoint has an invalid Name: " +
+                                                    std::string(e.what())));
+    }
+    checkpoint.startBlockId = reader.read<SegmentNo>();
+    checkpoint.hasEndBlockId = reader.read<uint8_t>() != 0;
+    checkpoint.endBlockId = reader.read<SegmentNo>();
+    checkpoint.interestLifetime = ndn::time::milliseconds(reader.read<int64_t>());
+    checkpoint.insertNum = reader.read<uint64_t>();
+    checkpoint.base = reader.read<SegmentNo>();
+    uint32_t nWords = reader.read<uint32_t>();
+    for (uint32_t j = 0; j < nWords; ++j) {
+      checkpoint.received.push_back(reader.read<uint64_t>());
+    }
+  }
+
+  if (!reader.isAtEnd())
+    BOOST_THROW_EXCEPTION(InsertCheckpoint::Error("Insert checkpoint does not match its header"));
+  return checkpoints;
+}
+
+} // namespace repo
@@ -0,0 +1,77 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_HANDLES_INSERT_CHECKPOINT_HPP
+#define REPO_HANDLES_INSERT_CHECKPOINT_HPP
+
+#include "../common.hpp"
+
+#include <ostream>
+
+namespace repo {
+
+/**
+ * @brief the state of a segmented insert process that is needed to resume it after a restart
+ */
+struct InsertCheckpoint
+{
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  ProcessId processId;
+  Name prefix;
+  SegmentNo startBlockId;
+  bool hasEndBlockId;
+  SegmentNo endBlockId;
+  ndn::time::milliseconds interestLifetime;
+  uint64_t insertNum;
+  SegmentNo base;                  ///< every segment below it was received
+  std::vector<uint64_t> received;  ///< bit i % 64 of word i / 64 is set if segment base + i
+                                   ///< was received
+};
+
+/**
+ * @brief write @p checkpoints to @p os
+ *
+ * The format is host byte order and only meant to be read back by the same repo:
+ * uint32 magic, uint32 version, uint32 number of checkpoints, then each checkpoint as
+ * uint64 process id, uint32 size and bytes of the Name TLV, uint64 StartBlockId,
+ * uint8 whether there is an EndBlockId, uint64 EndBlockId, int64 InterestLifetime in
+ * milliseconds, uint64 InsertNum, uint64 base, uint32 number of bitmap words and the words.
+ */
+void
+writeInsertCheckpoints(std::ostream& os, const std::vector<InsertCheckpoint>& checkpoints);
+
+/**
+ * @brief read the checkpoints written by writeInsertCheckpoints()
+ * @throw InsertCheckpoint::Error the buffer is truncated or is not a checkpoint file
+ */
+std::vector<InsertCheckpoint>
+readInsertCheckpoints(const uint8_t* buffer, size_t size);
+
+} // namespace repo
+
+#endif // REPO_HANDLES_INSERT_CHECKPOINT_HPP
@@ -49,10 +49,11 @@ ReadHandle::connectAutoListen()
 void
 ReadHandle::onInterest(const Name& prefix, const Interest& interest)
 {
-  shared_ptr<ndn::Data> data = getStorageHandle().readData(interest);
-  if (data != nullptr) {
-      getFace().put(*data);
-      // sample output, to make sure that repo gets the interest
+  Block wire = getStorageHandle().readWire(interest);
+  if (!wire.empty()) {
+    // Face::put keeps the wire of the decoded Data, so the stored TLV is not re-encoded;
+    // it only takes a Data, though, so the stored TLV is still parsed once per Interest
+    getFace().put(Data(wire));
   }
 }
 
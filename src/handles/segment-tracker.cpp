@@ -0,0 +1,208 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "segment-tracker.hpp"
+
+namespace repo {
+
+static const size_t INITIAL_RING_SIZE = 64;
+
+SegmentTracker::SegmentTracker(SegmentNo first)
+{
+  reset(first);
+}
+
+void
+SegmentTracker::reset(SegmentNo first)
+{
+  m_base = first;
+  m_received.assign(INITIAL_RING_SIZE / 64, 0);
+  m_outstanding.assign(INITIAL_RING_SIZE / 64, 0);
+  m_sendTimes.assign(INITIAL_RING_SIZE, ndn::time::steady_clock::TimePoint());
+  m_nOutstanding = 0;
+  m_retries.clear();
+  m_nPendingRetx = 0;
+}
+
+bool
+SegmentTracker::isReceived(SegmentNo segment) const
+{
+  if (segment < m_base)
+    return true;
+  return isTracked(segment) && getBit(m_received, getSlot(segment));
+}
+
+void
+SegmentTracker::markSent(SegmentNo segment, const ndn::time::steady_clock::TimePoint& now)
+{
+  if (isReceived(segment))
+    return;
+  while (!isTracked(segment))
+    grow();
+
+  size_t slot = getSlot(segment);
+  if (!getBit(m_outstanding, slot)) {
+    setBit(m_outstanding, slot, true);
+    ++m_nOutstanding;
+  }
+  m_sendTimes[slot] = now;
+}
+
+bool
+SegmentTracker::markReceived(SegmentNo segment, const ndn::time::steady_clock::TimePoint& now,
+                             ndn::time::nanoseconds& rtt)
+{
+  rtt = ndn::time::nanoseconds::zero();
+  if (!isTracked(segment) || isReceived(segment))
+    return false;
+
+  size_t slot = getSlot(segment);
+  bool wasOutstanding = getBit(m_outstanding, slot);
+  auto retry = findRetry(segment);
+  if (!wasOutstanding && retry == m_retries.end())
+    return false;
+
+  if (wasOutstanding) {
+    setBit(m_outstanding, slot, false);
+    --m_nOutstanding;
+    if (retry == m_retries.end())
+      rtt = now - m_sendTimes[slot];
+  }
+  if (retry != m_retries.end()) {
+    if (retry->isPending)
+      --m_nPendingRetx;
+    m_retries.erase(retry);
+  }
+  setBit(m_received, slot, true);
+  advance();
+  return true;
+}
+
+bool
+SegmentTracker::markStored(SegmentNo segment)
+{
+  if (isReceived(segment))
+    return false;
+  cancel(segment);
+  while (!isTracked(segment))
+    grow();
+
+  setBit(m_received, getSlot(segment), true);
+  advance();
+  return true;
+}
+
+int
+SegmentTracker::markTimedOut(SegmentNo segment)
+{
+  if (!isTracked(segment) || !getBit(m_outstanding, getSlot(segment)))
+    return 0;
+
+  setBit(m_outstanding, getSlot(segment), false);
+  --m_nOutstanding;
+
+  auto retry = findRetry(segment);
+  if (retry == m_retries.end()) {
+    m_retries.push_back(Retry{segment, 0, false});
+    retry = m_retries.end() - 1;
+  }
+  ++retry->nTimeouts;
+  if (!retry->isPending) {
+    retry->isPending = true;
+    ++m_nPendingRetx;
+  }
+  return retry->nTimeouts;
+}
+
+void
+SegmentTracker::cancel(SegmentNo segment)
+{
+  if (isTracked(segment) && getBit(m_outstanding, getSlot(segment))) {
+    setBit(m_outstanding, getSlot(segment), false);
+    --m_nOutstanding;
+  }
+  auto retry = findRetry(segment);
+  if (retry != m_retries.end()) {
+    if (retry->isPending)
+      --m_nPendingRetx;
+    m_retries.erase(retry);
+  }
+}
+
+SegmentNo
+SegmentTracker::popRetransmission()
+{
+  BOOST_ASSERT(hasRetransmission());
+  auto lowest = m_retries.end();
+  for (auto retry = m_retries.begin(); retry != m_retries.end(); ++retry) {
+    if (retry->isPending && (lowest == m_retries.end() || retry->segment < lowest->segment))
+      lowest = retry;
+  }
+  lowest->isPending = false;
+  --m_nPendingRetx;
+  return lowest->segment;
+}
+
+void
+SegmentTracker::setBit(std::vector<uint64_t>& bitmap, size_t slot, bool value)
+{
+  uint64_t mask = uint64_t(1) << (slot % 64);
+  if (value)
+    bitmap[slot / 64] |= mask;
+  else
+    bitmap[slot / 64] &= ~mask;
+}
+
+void
+SegmentTracker::grow()
+{
+  size_t oldSize = m_sendTimes.size();
+  std::vector<uint64_t> received(oldSize * 2 / 64, 0);
+  std::vector<uint64_t> outstanding(oldSize * 2 / 64, 0);
+  std::vector<ndn::time::steady_clock::TimePoint> sendTimes(oldSize * 2);
+
+  for (SegmentNo segment = m_base; segment < m_base + oldSize; ++segment) {
+    size_t oldSlot = getSlot(segment);
+    size_t newSlot = segment & (oldSize * 2 - 1);
+    setBit(received, newSlot, getBit(m_received, oldSlot));
+    setBit(outstanding, newSlot, getBit(m_outstanding, oldSlot));
+    sendTimes[newSlot] = m_sendTimes[oldSlot];
+  }
+  m_received.swap(received);
+  m_outstanding.swap(outstanding);
+  m_sendTimes.swap(sendTimes);
+}
+
+void
+SegmentTracker::advance()
+{
+  while (getBit(m_received, getSlot(m_base))) {
+    setBit(m_received, getSlot(m_base), false);
+    ++m_base;
+  }
+}
+
+std::vector<SegmentTracker::Retry>::iterator
+SegmentTracker::findRetry(SegmentNo segment)
+{
+  return std::find_if(m_retries.begin(), m_retries.end(),
+                      [segment] (const Retry& retry) { return retry.segment == segment; });
+}
+
+} // namespace repo
@@ -0,0 +1,186 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_HANDLES_SEGMENT_TRACKER_HPP
+#define REPO_HANDLES_SEGMENT_TRACKER_HPP
+
+#include "../common.hpp"
+
+namespace repo {
+
+/**
+ * @brief SegmentTracker keeps the state of the segments of a fetch process
+ *
+ * Segments below the base have all been received.  From the base on, the received
+ * and outstanding state of each segment is a bit in a ring of bitmaps, next to the time
+ * its Interest was sent; the ring only grows when the window of segments in flight does.
+ * Segments that timed out are listed in a small retry table until they are received,
+ * so per-segment bookkeeping neither allocates nor searches.
+ */
+class SegmentTracker
+{
+public:
+  explicit
+  SegmentTracker(SegmentNo first = 0);
+
+  /**
+   * @brief forget all segments and start over at @p first
+   */
+  void
+  reset(SegmentNo first);
+
+  /**
+   * @return the lowest segment not received yet
+   */
+  SegmentNo
+  getBase() const
+  {
+    return m_base;
+  }
+
+  /**
+   * @return the first segment past the ring; segments below it are marked without growing it
+   */
+  SegmentNo
+  getEnd() const
+  {
+    return m_base + m_sendTimes.size();
+  }
+
+  /**
+   * @return the number of segments sent and neither received nor timed out
+   */
+  size_t
+  getNOutstanding() const
+  {
+    return m_nOutstanding;
+  }
+
+  bool
+  isReceived(SegmentNo segment) const;
+
+  /**
+   * @brief record that the Interest for @p segment was sent, or sent again, at @p now
+   */
+  void
+  markSent(SegmentNo segment, const ndn::time::steady_clock::TimePoint& now);
+
+  /**
+   * @brief record that @p segment was received, possibly out of order
+   * @param[out] rtt  time since the Interest was sent, or zero if it was retransmitted
+   *                  (Karn's algorithm) or had already timed out
+   * @return false if @p segment was already received or was never sent
+   */
+  bool
+  markReceived(SegmentNo segment, const ndn::time::steady_clock::TimePoint& now,
+               ndn::time::nanoseconds& rtt);
+
+  /**
+   * @brief record that @p segment is already in storage, so it need not be fetched
+   * @return false if @p segment was already received
+   *
+   * Like markSent(), this grows the ring up to @p segment, so it is meant for segments
+   * around the window; stored segments further out are found in storage when reached.
+   */
+  bool
+  markStored(SegmentNo segment);
+
+  /**
+   * @brief record that the Interest for @p segment timed out, and queue it for retransmission
+   * @return the number of times @p segment has timed out, 0 if it was not outstanding
+   */
+  int
+  markTimedOut(SegmentNo segment);
+
+  /**
+   * @brief drop @p segment, e.g. because it is beyond the FinalBlockId
+   */
+  void
+  cancel(SegmentNo segment);
+
+  bool
+  hasRetransmission() const
+  {
+    return m_nPendingRetx > 0;
+  }
+
+  /**
+   * @brief take the lowest segment waiting for retransmission
+   * @pre hasRetransmission()
+   */
+  SegmentNo
+  popRetransmission();
+
+private:
+  struct Retry
+  {
+    SegmentNo segment;
+    int nTimeouts;
+    bool isPending; ///< waiting to be sent again
+  };
+
+  bool
+  isTracked(SegmentNo segment) const
+  {
+    return segment >= m_base && segment - m_base < m_sendTimes.size();
+  }
+
+  size_t
+  getSlot(SegmentNo segment) const
+  {
+    return segment & (m_sendTimes.size() - 1);
+  }
+
+  static bool
+  getBit(const std::vector<uint64_t>& bitmap, size_t slot)
+  {
+    return (bitmap[slot / 64] >> (slot % 64)) & 1;
+  }
+
+  static void
+  setBit(std::vector<uint64_t>& bitmap, size_t slot, bool value);
+
+  /**
+   * @brief double the ring, keeping the state of the tracked segments
+   */
+  void
+  grow();
+
+  /**
+   * @brief move the base past the received segments
+   */
+  void
+  advance();
+
+  std::vector<Retry>::iterator
+  findRetry(SegmentNo segment);
+
+private:
+  SegmentNo m_base;
+  std::vector<uint64_t> m_received;
+  std::vector<uint64_t> m_outstanding;
+  std::vector<ndn::time::steady_clock::TimePoint> m_sendTimes; ///< ring size, a power of two
+  size_t m_nOutstanding;
+  std::vector<Retry> m_retries;
+  size_t m_nPendingRetx;
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_SEGMENT_TRACKER_HPP
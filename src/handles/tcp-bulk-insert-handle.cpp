@@ -19,56 +19,130 @@
 
 #include "tcp-bulk-insert-handle.hpp"
 
+#include <ndn-cxx/util/logger.hpp>
+
+#include <boost/filesystem.hpp>
+
 namespace repo {
 
-const size_t MAX_NDN_PACKET_SIZE = 8800;
+NDN_LOG_INIT(repo.TcpBulkInsertHandle);
 
 namespace detail {
 
-class TcpBulkInsertClient : noncopyable
+/**
+ * @brief one bulk insert connection, over TCP or a Unix stream socket
+ */
+template<class Protocol>
+class BulkInsertClient : noncopyable
 {
 public:
-  TcpBulkInsertClient(TcpBulkInsertHandle& writer,
-                      const shared_ptr<boost::asio::ip::tcp::socket>& socket)
+  typedef typename Protocol::socket Socket;
+
+  BulkInsertClient(TcpBulkInsertHandle& writer, const shared_ptr<Socket>& socket)
     : m_writer(writer)
     , m_socket(socket)
     , m_hasStarted(false)
-    , m_inputBufferSize(0)
+    , m_buffer(writer.getBufferSize())
+    , m_ackTimer(socket->get_io_service())
+    , m_nPending(0)
+    , m_isEof(false)
+    , m_nSubmittedBatches(0)
+    , m_nCountedBatches(0)
+    , m_isSendingAck(false)
+    , m_hasSentAck(false)
   {
   }
 
   static void
-  startReceive(const shared_ptr<TcpBulkInsertClient>& client)
+  startReceive(const shared_ptr<BulkInsertClient>& client)
   {
     BOOST_ASSERT(!client->m_hasStarted);
 
-    client->m_socket->async_receive(
-      boost::asio::buffer(client->m_inputBuffer, MAX_NDN_PACKET_SIZE), 0,
-      bind(&TcpBulkInsertClient::handleReceive, client, _1, _2, client));
-
+    client->receive(client);
+    if (client->isAckEnabled())
+      client->scheduleAck(client);
     client->m_hasStarted = true;
   }
 
 private:
+  bool
+  isAckEnabled() const
+  {
+    return m_writer.getAckInterval() > ndn::time::milliseconds::zero();
+  }
+
+  void
+  receive(const shared_ptr<BulkInsertClient>& client)
+  {
+    m_buffer.prepare();
+    m_socket->async_receive(boost::asio::buffer(m_buffer.getFreeSpace(), m_buffer.getFreeSize()), 0,
+                            bind(&BulkInsertClient::handleReceive, this, _1, _2, client));
+  }
+
   void
   handleReceive(const boost::system::error_code& error,
                 std::size_t nBytesReceived,
-                const shared_ptr<TcpBulkInsertClient>& client);
+                const shared_ptr<BulkInsertClient>& client);
+
+  /**
+   * @brief account for the batch submitted @p batchNo -th on this connection
+   *
+   * The pipeline may complete batches out of order; the counts only grow by the batches
+   * completed in the order they were received, so they always cover the oldest packets.
+   */
+  void
+  onInserted(const std::vector<shared_ptr<const Data>>& data,
+             const std::vector<bool>& isInserted,
+             size_t nElements,
+             uint64_t batchNo,
+             const shared_ptr<BulkInsertClient>& client);
+
+  void
+  scheduleAck(const shared_ptr<BulkInsertClient>& client);
+
+  /**
+   * @brief send the counts if they changed since the last acknowledgement
+   *
+   * Once the sender has finished and all its packets are inserted, the last counts are
+   * sent and the connection is closed.
+   */
+  void
+  sendAck(const shared_ptr<BulkInsertClient>& client);
+
+  void
+  close();
 
 private:
   TcpBulkInsertHandle& m_writer;
-  shared_ptr<boost::asio::ip::tcp::socket> m_socket;
+  shared_ptr<Socket> m_socket;
   bool m_hasStarted;
-  uint8_t m_inputBuffer[MAX_NDN_PACKET_SIZE];
-  std::size_t m_inputBufferSize;
+  BlockStreamBuffer m_buffer;
+
+  boost::asio::steady_timer m_ackTimer;
+  size_t m_nPending;        ///< packets submitted to the pipeline and not inserted yet
+  bool m_isEof;             ///< whether the sender has shut down its side
+  uint64_t m_nSubmittedBatches;
+  uint64_t m_nCountedBatches;                       ///< batches included in m_counts
+  std::map<uint64_t, BulkInsertAck> m_laterBatches; ///< completed after an earlier batch
+  BulkInsertAck m_counts;
+  BulkInsertAck m_sentCounts;
+  Block m_ackWire;          ///< the acknowledgement being sent
+  bool m_isSendingAck;
+  bool m_hasSentAck;
 };
 
 } // namespace detail
 
 TcpBulkInsertHandle::TcpBulkInsertHandle(boost::asio::io_service& ioService,
-                                         RepoStorage& storageHandle)
+                                         RepoStorage& storageHandle,
+                                         size_t nWorkers)
   : m_acceptor(ioService)
+  , m_localAcceptor(ioService)
   , m_storageHandle(storageHandle)
+  , m_pipeline(ioService, storageHandle, nWorkers)
+  , m_bufferSize(1024 * 1024)
+  , m_ackInterval(0)
+  , m_highWatermark(16384)
 {
 }
 
@@ -105,11 +179,59 @@ TcpBulkInsertHandle::listen(const std::string& host, const std::string& port)
                                clientSocket));
 }
 
+void
+TcpBulkInsertHandle::listenLocal(const std::string& path)
+{
+  using namespace boost::asio;
+
+  if (m_localAcceptor.is_open())
+    BOOST_THROW_EXCEPTION(Error("Already listening on " + m_localPath));
+
+  // a socket file left over by a previous run would make bind fail; only a socket that
+  // refuses connections is removed, anything else at the path is left for bind to reject
+  boost::system::error_code error;
+  if (boost::filesystem::symlink_status(path, error).type() == boost::filesystem::socket_file) {
+    local::stream_protocol::socket probe(m_localAcceptor.get_io_service());
+    probe.connect(local::stream_protocol::endpoint(path), error);
+    if (!error)
+      BOOST_THROW_EXCEPTION(Error("Another process is listening on " + path));
+    if (error == boost::asio::error::connection_refused)
+      boost::filesystem::remove(path, error);
+  }
+
+  m_localPath = path;
+  std::cerr << "Start listening on " << m_localPath << std::endl;
+
+  local::stream_protocol::endpoint endpoint(m_localPath);
+  m_localAcceptor.open(endpoint.protocol());
+  try {
+    m_localAcceptor.bind(endpoint);
+    m_localAcceptor.listen(255);
+  }
+  catch (const boost::system::system_error&) {
+    m_localAcceptor.close(error);
+    throw;
+  }
+
+  shared_ptr<local::stream_protocol::socket> clientSocket =
+    make_shared<local::stream_protocol::socket>(std::ref(m_localAcceptor.get_io_service()));
+  m_localAcceptor.async_accept(*clientSocket,
+                               bind(&TcpBulkInsertHandle::handleLocalAccept, this, _1,
+                                    clientSocket));
+}
+
 void
 TcpBulkInsertHandle::stop()
 {
-  m_acceptor.cancel();
-  m_acceptor.close();
+  boost::system::error_code error;
+  m_acceptor.cancel(error);
+  m_acceptor.close(error);
+
+  if (m_localAcceptor.is_open()) {
+    m_localAcceptor.cancel(error);
+    m_localAcceptor.close(error);
+    boost::filesystem::remove(m_localPath, error);
+  }
 }
 
 void
@@ -126,9 +248,8 @@ TcpBulkInsertHandle::handleAccept(const boost::system::error_code& error,
 
   std::cerr << "New connection from " << socket->remote_endpoint() << std::endl;
 
-  shared_ptr<detail::TcpBulkInsertClient> client =
-    make_shared<detail::TcpBulkInsertClient>(std::ref(*this), socket);
-  detail::TcpBulkInsertClient::startReceive(client);
+  typedef detail::BulkInsertClient<ip::tcp> Client;
+  Client::startReceive(make_shared<Client>(std::ref(*this), socket));
 
   // prepare accepting the next connection
   shared_ptr<ip::tcp::socket> clientSocket =
@@ -139,78 +260,187 @@ TcpBulkInsertHandle::handleAccept(const boost::system::error_code& error,
 }
 
 void
-detail::TcpBulkInsertClient::handleReceive(const boost::system::error_code& error,
+TcpBulkInsertHandle::handleLocalAccept(const boost::system::error_code& error,
+                                       const shared_ptr<boost::asio::local::stream_protocol::socket>& socket)
+{
+  using namespace boost::asio;
+
+  if (error)
+    return;
+
+  std::cerr << "New connection on " << m_localPath << std::endl;
+
+  typedef detail::BulkInsertClient<local::stream_protocol> Client;
+  Client::startReceive(make_shared<Client>(std::ref(*this), socket));
+
+  // prepare accepting the next connection
+  shared_ptr<local::stream_protocol::socket> clientSocket =
+    make_shared<local::stream_protocol::socket>(std::ref(m_localAcceptor.get_io_service()));
+  m_localAcceptor.async_accept(*clientSocket,
+                               bind(&TcpBulkInsertHandle::handleLocalAccept, this, _1,
+                                    clientSocket));
+}
+
+template<class Protocol>
+void
+detail::BulkInsertClient<Protocol>::handleReceive(const boost::system::error_code& error,
                                            std::size_t nBytesReceived,
-                                           const shared_ptr<detail::TcpBulkInsertClient>& client)
+                                           const shared_ptr<BulkInsertClient>& client)
 {
   if (error)
     {
       if (error == boost::system::errc::operation_canceled) // when socket is closed by someone
         return;
 
-      boost::system::error_code error;
-      m_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-      m_socket->close(error);
+      if (error == boost::asio::error::eof && isAckEnabled()) {
+        // the sender is done and waits for the final counts
+        m_isEof = true;
+        if (m_nPending == 0)
+          sendAck(client);
+        return;
+      }
+
+      close();
       return;
     }
 
-  m_inputBufferSize += nBytesReceived;
+  m_buffer.commit(nBytesReceived);
 
-  // do magic
-
-  std::size_t offset = 0;
-
-  bool isOk = true;
+  // every complete packet in the buffer is handed to the pipeline without copying it out
+  std::vector<Block> batch;
   Block element;
-  while (m_inputBufferSize - offset > 0) {
-    std::tie(isOk, element) = Block::fromBuffer(m_inputBuffer + offset, m_inputBufferSize - offset);
-    if (!isOk)
+  bool isOk = true;
+  while (isOk) {
+    try {
+      isOk = m_buffer.next(element);
+    }
+    catch (const BlockStreamBuffer::Error& e) {
+      std::cerr << "Closing connection: " << e.what() << std::endl;
+      close();
       break;
-
-    offset += element.size();
-    BOOST_ASSERT(offset <= m_inputBufferSize);
-
-    if (element.type() == ndn::tlv::Data) {
-      try {
-        Data data(element);
-        bool isInserted = m_writer.getStorageHandle().insertData(data);
-        if (isInserted)
-          std::cerr << "Successfully injected " << data.getName() << std::endl;
-        else
-          std::cerr << "FAILED to inject " << data.getName() << std::endl;
-      }
-      catch (const std::runtime_error& error) {
-        /// \todo Catch specific error after determining what wireDecode() can throw
-        std::cerr << "Error decoding received Data packet" << std::endl;
-      }
     }
+
+    // elements other than Data fail to decode, and are counted as failed in order
+    if (isOk)
+      batch.push_back(element);
   }
 
-  if (!isOk && m_inputBufferSize == MAX_NDN_PACKET_SIZE && offset == 0)
-    {
-      boost::system::error_code error;
-      m_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
-      m_socket->close(error);
-      return;
-    }
+  if (!batch.empty()) {
+    m_nPending += batch.size();
+    m_writer.getPipeline().submit(std::move(batch),
+                                  bind(&BulkInsertClient::onInserted, this, _1, _2,
+                                       std::placeholders::_3, m_nSubmittedBatches++, client));
+  }
 
-  if (offset > 0)
-    {
-      if (offset != m_inputBufferSize)
-        {
-          std::copy(m_inputBuffer + offset, m_inputBuffer + m_inputBufferSize,
-                    m_inputBuffer);
-          m_inputBufferSize -= offset;
-        }
-      else
-        {
-          m_inputBufferSize = 0;
-        }
-    }
+  if (!m_socket->is_open())
+    return;
+
+  element = Block();
+  if (m_writer.isOverloaded())
+    m_writer.pauseReceive(bind(&BulkInsertClient::receive, this, client));
+  else
+    receive(client);
+}
+
+template<class Protocol>
+void
+detail::BulkInsertClient<Protocol>::onInserted(const std::vector<shared_ptr<const Data>>& data,
+                                        const std::vector<bool>& isInserted,
+                                        size_t nElements,
+                                        uint64_t batchNo,
+                                        const shared_ptr<BulkInsertClient>& client)
+{
+  size_t nInserted = std::count(isInserted.begin(), isInserted.end(), true);
+  NDN_LOG_DEBUG("Injected " << nInserted << " out of " << nElements << " packets");
+
+  // packets that could not be decoded count as failed too
+  m_laterBatches[batchNo] = BulkInsertAck(nInserted, nElements - nInserted);
+  for (auto it = m_laterBatches.begin();
+       it != m_laterBatches.end() && it->first == m_nCountedBatches;
+       it = m_laterBatches.erase(it), ++m_nCountedBatches) {
+    m_counts.nInserted += it->second.nInserted;
+    m_counts.nFailed += it->second.nFailed;
+  }
+  m_nPending -= nElements;
+  if (m_isEof && m_nPending == 0)
+    sendAck(client);
+
+  m_writer.afterBatchInserted();
+}
+
+template<class Protocol>
+void
+detail::BulkInsertClient<Protocol>::scheduleAck(const shared_ptr<BulkInsertClient>& client)
+{
+  m_ackTimer.expires_from_now(std::chrono::milliseconds(m_writer.getAckInterval().count()));
+  m_ackTimer.async_wait([this, client] (const boost::system::error_code& error) {
+      if (error || !m_socket->is_open())
+        return;
+      sendAck(client);
+      scheduleAck(client);
+    });
+}
 
-  m_socket->async_receive(boost::asio::buffer(m_inputBuffer + m_inputBufferSize,
-                                              MAX_NDN_PACKET_SIZE - m_inputBufferSize), 0,
-                          bind(&TcpBulkInsertClient::handleReceive, this, _1, _2, client));
+template<class Protocol>
+void
+detail::BulkInsertClient<Protocol>::sendAck(const shared_ptr<BulkInsertClient>& client)
+{
+  // a write in progress calls back here when it completes
+  if (!m_socket->is_open() || m_isSendingAck)
+    return;
+
+  bool isFinal = m_isEof && m_nPending == 0;
+  if (m_hasSentAck && m_counts.nInserted == m_sentCounts.nInserted &&
+      m_counts.nFailed == m_sentCounts.nFailed) {
+    if (isFinal)
+      close();
+    return;
+  }
+
+  m_sentCounts = m_counts;
+  m_ackWire = m_counts.wireEncode();
+  m_isSendingAck = true;
+  m_hasSentAck = true;
+  boost::asio::async_write(*m_socket, boost::asio::buffer(m_ackWire.wire(), m_ackWire.size()),
+    [this, client] (const boost::system::error_code& error, size_t) {
+      m_isSendingAck = false;
+      if (error) {
+        if (error != boost::system::errc::operation_canceled)
+          close();
+        return;
+      }
+      if (m_isEof && m_nPending == 0)
+        sendAck(client);
+    });
+}
+
+template<class Protocol>
+void
+detail::BulkInsertClient<Protocol>::close()
+{
+  boost::system::error_code error;
+  m_ackTimer.cancel(error);
+  m_socket->shutdown(Socket::shutdown_both, error);
+  m_socket->close(error);
+}
+
+void
+TcpBulkInsertHandle::pauseReceive(const std::function<void()>& resume)
+{
+  m_pausedReceives.push_back(resume);
+}
+
+void
+TcpBulkInsertHandle::afterBatchInserted()
+{
+  if (m_pausedReceives.empty() || m_pipeline.getNPending() > m_highWatermark / 2)
+    return;
+
+  std::vector<std::function<void()>> paused;
+  paused.swap(m_pausedReceives);
+  for (const auto& resume : paused) {
+    resume();
+  }
 }
 
 
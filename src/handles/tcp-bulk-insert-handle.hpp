@@ -22,8 +22,12 @@
 
 #include "common.hpp"
 #include "storage/repo-storage.hpp"
+#include "block-stream-buffer.hpp"
+#include "bulk-insert-pipeline.hpp"
+#include "bulk-insert-ack.hpp"
 
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 namespace repo {
 
@@ -41,30 +45,135 @@ public:
   };
 
 public:
+  /**
+   * @param nWorkers  the number of threads decoding received packets, 0 uses one per
+   *                  hardware thread
+   */
   TcpBulkInsertHandle(boost::asio::io_service& ioService,
-                      RepoStorage& storageHandle);
+                      RepoStorage& storageHandle,
+                      size_t nWorkers = 0);
 
   void
   listen(const std::string& host, const std::string& port);
 
+  /**
+   * @brief also accept bulk insert connections on the Unix stream socket at @p path
+   *
+   * Local connections share the receive buffer size, decoding pipeline, acknowledgements
+   * and flow control of TCP connections.  A stale socket file at @p path is replaced, and
+   * stop() removes it.
+   */
+  void
+  listenLocal(const std::string& path);
+
   void
   stop();
 
+  /**
+   * @brief set the size of the chunks that connections receive into
+   *
+   * A larger chunk lets a single receive carry many packets.  Sizes below
+   * BlockStreamBuffer::MIN_CHUNK_SIZE are rounded up.  Only affects new connections.
+   */
+  void
+  setBufferSize(size_t nBytes)
+  {
+    m_bufferSize = std::max(nBytes, BlockStreamBuffer::MIN_CHUNK_SIZE);
+  }
+
+  size_t
+  getBufferSize() const
+  {
+    return m_bufferSize;
+  }
+
   RepoStorage&
   getStorageHandle()
   {
     return m_storageHandle;
   }
 
+  /**
+   * @brief report cumulative insert counts to each connection every @p interval
+   *
+   * Each connection is sent a BulkInsertAck whenever its counts changed.  When the sender
+   * shuts down its side, the final counts are sent once all its packets are processed, and
+   * the connection is then closed.  Zero, the default, disables acknowledgements.
+   */
+  void
+  setAckInterval(const ndn::time::milliseconds& interval)
+  {
+    m_ackInterval = interval;
+  }
+
+  const ndn::time::milliseconds&
+  getAckInterval() const
+  {
+    return m_ackInterval;
+  }
+
+  /**
+   * @brief stop reading from the connections while more than @p nPackets received
+   *        packets wait to be inserted
+   *
+   * Reading resumes once the backlog is down to half of it.
+   */
+  void
+  setHighWatermark(size_t nPackets)
+  {
+    m_highWatermark = std::max<size_t>(nPackets, 1);
+  }
+
+  size_t
+  getHighWatermark() const
+  {
+    return m_highWatermark;
+  }
+
+  BulkInsertPipeline&
+  getPipeline()
+  {
+    return m_pipeline;
+  }
+
+  bool
+  isOverloaded() const
+  {
+    return m_pipeline.getNPending() > m_highWatermark;
+  }
+
+  /**
+   * @brief call @p resume once the backlog has drained, instead of reading now
+   */
+  void
+  pauseReceive(const std::function<void()>& resume);
+
+  /**
+   * @brief resume the paused connections if the backlog has drained enough
+   */
+  void
+  afterBatchInserted();
+
 private:
   void
   handleAccept(const boost::system::error_code& error,
                const std::shared_ptr<boost::asio::ip::tcp::socket>& socket);
 
+  void
+  handleLocalAccept(const boost::system::error_code& error,
+                    const std::shared_ptr<boost::asio::local::stream_protocol::socket>& socket);
+
 private:
   boost::asio::ip::tcp::acceptor m_acceptor;
   boost::asio::ip::tcp::endpoint m_localEndpoint;
+  boost::asio::local::stream_protocol::acceptor m_localAcceptor;
+  std::string m_localPath;
   RepoStorage& m_storageHandle;
+  BulkInsertPipeline m_pipeline;
+  size_t m_bufferSize;
+  ndn::time::milliseconds m_ackInterval;
+  size_t m_highWatermark;
+  std::vector<std::function<void()>> m_pausedReceives;
 };
 
 } // namespace repo
@@ -0,0 +1,364 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tcp-bulk-read-handle.hpp"
+#include "block-stream-buffer.hpp"
+
+namespace repo {
+
+namespace detail {
+
+class TcpBulkReadClient : noncopyable
+{
+public:
+  TcpBulkReadClient(TcpBulkReadHandle& reader,
+                    const shared_ptr<boost::asio::ip::tcp::socket>& socket)
+    : m_reader(reader)
+    , m_socket(socket)
+    , m_request(0)
+    , m_nextEntry(0)
+    , m_isIndexDone(false)
+    , m_isWriting(false)
+    , m_isGathering(false)
+  {
+  }
+
+  static void
+  startReceive(const shared_ptr<TcpBulkReadClient>& client)
+  {
+    client->receive(client);
+  }
+
+private:
+  void
+  receive(const shared_ptr<TcpBulkReadClient>& client)
+  {
+    m_request.prepare();
+    m_socket->async_receive(boost::asio::buffer(m_request.getFreeSpace(), m_request.getFreeSize()), 0,
+                            bind(&TcpBulkReadClient::handleReceive, this, _1, _2, client));
+  }
+
+  void
+  handleReceive(const boost::system::error_code& error,
+                std::size_t nBytesReceived,
+                const shared_ptr<TcpBulkReadClient>& client);
+
+  /**
+   * @brief append the next stored Data to @p buffer, up to the write size
+   *        and at most MAX_FILL_PACKETS of them
+   */
+  void
+  fill(std::vector<uint8_t>& buffer);
+
+  bool
+  isAllRead() const
+  {
+    return m_isIndexDone && m_nextEntry == m_entries.size();
+  }
+
+  /**
+   * @brief fill the next write by one step after other pending events
+   */
+  void
+  scheduleGather(const shared_ptr<TcpBulkReadClient>& client);
+
+  void
+  gather(const shared_ptr<TcpBulkReadClient>& client);
+
+  /**
+   * @brief start writing the gathered data, or end the stream once all is sent
+   */
+  void
+  sendNext(const shared_ptr<TcpBulkReadClient>& client);
+
+  /**
+   * @brief end the stream and close once the client has closed its side
+   */
+  void
+  finish(const shared_ptr<TcpBulkReadClient>& client);
+
+  void
+  discardInput(const shared_ptr<TcpBulkReadClient>& client);
+
+  void
+  close();
+
+private:
+  /**
+   * @brief how many Data one step reads, so that SQLite reads on the io thread
+   *        do not hold up other events for long
+   */
+  static const size_t MAX_FILL_PACKETS = 64;
+
+  TcpBulkReadHandle& m_reader;
+  shared_ptr<boost::asio::ip::tcp::socket> m_socket;
+  BlockStreamBuffer m_request;
+
+  Name m_prefix;
+  std::vector<std::pair<int64_t, Name>> m_entries; ///< the next data to send, in name order
+  size_t m_nextEntry;              ///< position in m_entries of the next data to read
+  bool m_isIndexDone;              ///< whether the index has no data after m_entries
+  std::vector<uint8_t> m_writing;  ///< the bytes being written
+  std::vector<uint8_t> m_next;     ///< the bytes to write next
+  bool m_isWriting;
+  bool m_isGathering;
+};
+
+const size_t TcpBulkReadClient::MAX_FILL_PACKETS;
+
+void
+TcpBulkReadClient::handleReceive(const boost::system::error_code& error,
+                                 std::size_t nBytesReceived,
+                                 const shared_ptr<TcpBulkReadClient>& client)
+{
+  if (error) {
+    if (error != boost::system::errc::operation_canceled)
+      close();
+    return;
+  }
+
+  m_request.commit(nBytesReceived);
+
+  Block element;
+  try {
+    if (!m_request.next(element)) {
+      receive(client);
+      return;
+    }
+  }
+  catch (const BlockStreamBuffer::Error& e) {
+    std::cerr << "Closing connection: " << e.what() << std::endl;
+    close();
+    return;
+  }
+
+  if (element.type() != ndn::tlv::Name) {
+    std::cerr << "Closing connection: expecting a Name, got TLV type " << element.type() << std::endl;
+    close();
+    return;
+  }
+
+  try {
+    m_prefix.wireDecode(element);
+  }
+  catch (const std::runtime_error& e) {
+    std::cerr << "Closing connection: malformed Name" << std::endl;
+    close();
+    return;
+  }
+
+  std::cerr << "Sending data under " << m_prefix << std::endl;
+  scheduleGather(client);
+}
+
+void
+TcpBulkReadClient::fill(std::vector<uint8_t>& buffer)
+{
+  // the index is walked in steps from the last name taken, so data deleted meanwhile
+  // is skipped and data inserted meanwhile is sent if it sorts after that name
+  RepoStorage& storage = m_reader.getStorageHandle();
+  for (size_t nRead = 0; nRead < MAX_FILL_PACKETS && buffer.size() < m_reader.getWriteSize();
+       ++nRead) {
+    if (m_nextEntry == m_entries.size()) {
+      if (m_isIndexDone)
+        return;
+      Name after = m_entries.empty() ? Name() : m_entries.back().second;
+      m_entries = storage.getStoredAfter(m_prefix, after, MAX_FILL_PACKETS);
+      m_nextEntry = 0;
+      m_isIndexDone = m_entries.size() < MAX_FILL_PACKETS;
+      if (m_entries.empty())
+        return;
+    }
+    Block wire = storage.readWire(m_entries[m_nextEntry++].first);
+    if (wire.hasWire())
+      buffer.insert(buffer.end(), wire.begin(), wire.end());
+  }
+}
+
+void
+TcpBulkReadClient::scheduleGather(const shared_ptr<TcpBulkReadClient>& client)
+{
+  if (m_isGathering || isAllRead() || m_next.size() >= m_reader.getWriteSize())
+    return;
+  m_isGathering = true;
+  m_socket->get_io_service().post(bind(&TcpBulkReadClient::gather, this, client));
+}
+
+void
+TcpBulkReadClient::gather(const shared_ptr<TcpBulkReadClient>& client)
+{
+  m_isGathering = false;
+  if (!m_socket->is_open())
+    return;
+
+  fill(m_next);
+  if (m_isWriting)
+    scheduleGather(client);
+  else
+    sendNext(client);
+}
+
+void
+TcpBulkReadClient::sendNext(const shared_ptr<TcpBulkReadClient>& client)
+{
+  if (m_isWriting || !m_socket->is_open())
+    return;
+
+  if (m_next.empty()) {
+    if (isAllRead())
+      finish(client);
+    else
+      scheduleGather(client);
+    return;
+  }
+
+  m_writing.swap(m_next);
+  m_next.clear();
+  m_isWriting = true;
+  boost::asio::async_write(*m_socket, boost::asio::buffer(m_writing),
+    [this, client] (const boost::system::error_code& error, size_t) {
+      m_isWriting = false;
+      if (error) {
+        if (error != boost::system::errc::operation_canceled)
+          close();
+        return;
+      }
+      sendNext(client);
+    });
+
+  // gather the next write while this one is in flight
+  scheduleGather(client);
+}
+
+void
+TcpBulkReadClient::finish(const shared_ptr<TcpBulkReadClient>& client)
+{
+  // closing with unread input would reset the connection and could drop what is still
+  // in flight, so signal the end and wait for the client to close its side
+  boost::system::error_code error;
+  m_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_send, error);
+  if (error) {
+    close();
+    return;
+  }
+  // nothing is written anymore, so the write buffer can take the discarded input
+  m_writing.resize(4096);
+  discardInput(client);
+}
+
+void
+TcpBulkReadClient::discardInput(const shared_ptr<TcpBulkReadClient>& client)
+{
+  m_socket->async_receive(boost::asio::buffer(m_writing), 0,
+    [this, client] (const boost::system::error_code& error, size_t) {
+      if (error) {
+        if (error != boost::system::errc::operation_canceled)
+          close();
+        return;
+      }
+      discardInput(client);
+    });
+}
+
+void
+TcpBulkReadClient::close()
+{
+  boost::system::error_code error;
+  m_socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+  m_socket->close(error);
+}
+
+} // namespace detail
+
+TcpBulkReadHandle::TcpBulkReadHandle(boost::asio::io_service& ioService,
+                                     RepoStorage& storageHandle)
+  : m_acceptor(ioService)
+  , m_storageHandle(storageHandle)
+  , m_writeSize(1024 * 1024)
+{
+}
+
+void
+TcpBulkReadHandle::setWriteSize(size_t nBytes)
+{
+  m_writeSize = std::max(nBytes, BlockStreamBuffer::MAX_ELEMENT_SIZE);
+}
+
+void
+TcpBulkReadHandle::listen(const std::string& host, const std::string& port)
+{
+  using namespace boost::asio;
+
+  ip::tcp::resolver resolver(m_acceptor.get_io_service());
+  ip::tcp::resolver::query query(host, port);
+
+  ip::tcp::resolver::iterator endpoint = resolver.resolve(query);
+  ip::tcp::resolver::iterator end;
+
+  if (endpoint == end)
+    BOOST_THROW_EXCEPTION(Error("Cannot listen on [" + host + ":" + port + "]"));
+
+  m_localEndpoint = *endpoint;
+  std::cerr << "Start listening for bulk reads on " << m_localEndpoint << std::endl;
+
+  m_acceptor.open(m_localEndpoint.protocol());
+  m_acceptor.set_option(ip::tcp::acceptor::reuse_address(true));
+  if (m_localEndpoint.address().is_v6()) {
+    m_acceptor.set_option(ip::v6_only(true));
+  }
+  m_acceptor.bind(m_localEndpoint);
+  m_acceptor.listen(255);
+
+  shared_ptr<ip::tcp::socket> clientSocket =
+    make_shared<ip::tcp::socket>(std::ref(m_acceptor.get_io_service()));
+  m_acceptor.async_accept(*clientSocket,
+                          bind(&TcpBulkReadHandle::handleAccept, this, _1, clientSocket));
+}
+
+void
+TcpBulkReadHandle::stop()
+{
+  boost::system::error_code error;
+  m_acceptor.cancel(error);
+  m_acceptor.close(error);
+}
+
+void
+TcpBulkReadHandle::handleAccept(const boost::system::error_code& error,
+                                const shared_ptr<boost::asio::ip::tcp::socket>& socket)
+{
+  using namespace boost::asio;
+
+  if (error)
+    return;
+
+  std::cerr << "New bulk read connection from " << socket->remote_endpoint() << std::endl;
+
+  auto client = make_shared<detail::TcpBulkReadClient>(std::ref(*this), socket);
+  detail::TcpBulkReadClient::startReceive(client);
+
+  // prepare accepting the next connection
+  shared_ptr<ip::tcp::socket> clientSocket =
+    make_shared<ip::tcp::socket>(std::ref(m_acceptor.get_io_service()));
+  m_acceptor.async_accept(*clientSocket,
+                          bind(&TcpBulkReadHandle::handleAccept, this, _1, clientSocket));
+}
+
+} // namespace repo
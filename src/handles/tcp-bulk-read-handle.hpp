@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef REPO_HANDLES_TCP_BULK_READ_HANDLE_HPP
+#define REPO_HANDLES_TCP_BULK_READ_HANDLE_HPP
+
+#include "common.hpp"
+#include "storage/repo-storage.hpp"
+
+#include <boost/asio.hpp>
+
+namespace repo {
+
+/**
+ * @brief streams stored data out over TCP
+ *
+ * A client connects and sends a Name TLV.  The repo replies with the wire encoding of
+ * every stored Data under that prefix, back to back in name order, and then closes the
+ * connection.  The index is walked a few names at a time, and the data is read straight
+ * from storage and sent in large writes.  The next write is filled while the previous one
+ * is in flight, in short steps that let other events run in between.
+ */
+class TcpBulkReadHandle : noncopyable
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+public:
+  TcpBulkReadHandle(boost::asio::io_service& ioService,
+                    RepoStorage& storageHandle);
+
+  void
+  listen(const std::string& host, const std::string& port);
+
+  void
+  stop();
+
+  /**
+   * @brief set how many bytes of Data are gathered into one write
+   *
+   * The size is rounded up to the largest packet size.
+   */
+  void
+  setWriteSize(size_t nBytes);
+
+  size_t
+  getWriteSize() const
+  {
+    return m_writeSize;
+  }
+
+  RepoStorage&
+  getStorageHandle()
+  {
+    return m_storageHandle;
+  }
+
+private:
+  void
+  handleAccept(const boost::system::error_code& error,
+               const std::shared_ptr<boost::asio::ip::tcp::socket>& socket);
+
+private:
+  boost::asio::ip::tcp::acceptor m_acceptor;
+  boost::asio::ip::tcp::endpoint m_localEndpoint;
+  RepoStorage& m_storageHandle;
+  size_t m_writeSize;
+};
+
+} // namespace repo
+
+#endif // REPO_HANDLES_TCP_BULK_READ_HANDLE_HPP
@@ -23,24 +23,31 @@ namespace repo {
 
 static const milliseconds PROCESS_DELETE_TIME(10000);
 static const milliseconds DEFAULT_INTEREST_LIFETIME(4000);
+static const size_t DEFAULT_MAX_WINDOW = 64;
+static const size_t INITIAL_WINDOW = 2;
+static const size_t MAX_EXCLUDED_CHILDREN = 100;
+static const int MAX_GAP_RETRIES = 3;
 
 WatchHandle::WatchHandle(Face& face, RepoStorage& storageHandle, KeyChain& keyChain,
                          Scheduler& scheduler, Validator& validator)
   : BaseHandle(face, storageHandle, keyChain, scheduler)
   , m_validator(validator)
-  , m_interestNum(0)
-  , m_maxInterestNum(0)
-  , m_interestLifetime(DEFAULT_INTEREST_LIFETIME)
-  , m_watchTimeout(0)
-  , m_startTime(steady_clock::now())
-  , m_size(0)
+  , m_maxWindow(DEFAULT_MAX_WINDOW)
 {
 }
 
 void
-WatchHandle::deleteProcess(const Name& name)
+WatchHandle::setMaxWindow(size_t nInterests)
 {
-  m_processes.erase(name);
+  m_maxWindow = std::max<size_t>(nInterests, 1);
+}
+
+void
+WatchHandle::deleteProcess(const shared_ptr<WatchProcess>& process)
+{
+  auto it = m_processes.find(process->name);
+  if (it != m_processes.end() && it->second == process)
+    m_processes.erase(it);
 }
 
 // Interest.
@@ -68,15 +75,10 @@ WatchHandle::onValidated(const Interest& interest, const Name& prefix)
   processWatchCommand(interest, parameter);
 }
 
-void WatchHandle::watchStop(const Name& name)
+void WatchHandle::watchStop(WatchProcess& process)
 {
-  m_processes[name].second = false;
-  m_maxInterestNum = 0;
-  m_interestNum = 0;
-  m_startTime = steady_clock::now();
-  m_watchTimeout = milliseconds(0);
-  m_interestLifetime = DEFAULT_INTEREST_LIFETIME;
-  m_size = 0;
+  process.isRunning = false;
+  getScheduler().cancelEvent(process.timeoutEvent);
 }
 
 void
@@ -87,80 +89,224 @@ WatchHandle::onValidationFailed(const Interest& interest, const ValidationError&
 }
 
 void
-WatchHandle::onData(const Interest& interest, const ndn::Data& data, const Name& name)
+WatchHandle::onData(const Interest& interest, const ndn::Data& data,
+                    const shared_ptr<WatchProcess>& process,
+                    const steady_clock::TimePoint& sendTime)
 {
   m_validator.validate(data,
-                       bind(&WatchHandle::onDataValidated, this, interest, _1, name),
-                       bind(&WatchHandle::onDataValidated, this, interest, _1, name));
-                       // bind(&WatchHandle::onDataValidationFailed, this, interest, _1, _2, name));
+                       bind(&WatchHandle::onDataValidated, this, interest, _1, process, sendTime),
+                       bind(&WatchHandle::onDataValidated, this, interest, _1, process, sendTime));
+                       // bind(&WatchHandle::onDataValidationFailed, this, interest, _1, _2, process));
 }
 
 void
-WatchHandle::onDataValidated(const Interest& interest, const Data& data, const Name& name)
+WatchHandle::onDataValidated(const Interest& interest, const Data& data,
+                             const shared_ptr<WatchProcess>& process,
+                             const steady_clock::TimePoint& sendTime)
 {
-  if (!m_processes[name].second) {
+  if (!process->isRunning) {
     return;
   }
-  if (getStorageHandle().insertData(data)) {
-    m_size++;
-    if (!onRunning(name))
-      return;
+  --process->nOutstanding;
+
+  steady_clock::TimePoint now = steady_clock::now();
+  nanoseconds rtt = now - sendTime;
+  if (process->minRtt == nanoseconds::zero() || rtt < process->minRtt) {
+    process->minRtt = rtt;
+  }
 
-    Interest fetchInterest(interest.getName());
-    fetchInterest.setInterestLifetime(m_interestLifetime);
+  // Interests in flight together may bring back the same Data
+  if (!getStorageHandle().hasData(data)) {
+    if (!getStorageHandle().insertData(data)) {
+      BOOST_THROW_EXCEPTION(Error("Insert into Repo Failed"));
+    }
+    process->response.setInsertNum(process->response.getInsertNum() + 1);
+
+    if (process->lastArrival != steady_clock::TimePoint()) {
+      // alpha = 1/8, like the smoothed RTT of RFC 6298
+      nanoseconds interval = now - process->lastArrival;
+      process->publishInterval = process->publishInterval == nanoseconds::zero() ?
+                                 interval : (process->publishInterval * 7 + interval) / 8;
+    }
+    process->lastArrival = now;
+  }
 
-    ++m_interestNum;
-    getFace().expressInterest(fetchInterest,
-                              bind(&WatchHandle::onData, this, _1, _2, name),
-                              bind(&WatchHandle::onTimeout, this, _1, name), // Nack
-                              bind(&WatchHandle::onTimeout, this, _1, name));
+  const Name& name = data.getName();
+  if (name.size() > process->name.size()) {
+    onChildReceived(*process, name.get(process->name.size()));
   }
   else {
-    BOOST_THROW_EXCEPTION(Error("Insert into Repo Failed"));
+    rememberChild(*process, data.getFullName().get(process->name.size()), true);
   }
-  m_processes[name].first.setInsertNum(m_size);
+
+  fillWindow(process);
 }
 
 void
-WatchHandle::onDataValidationFailed(const Interest& interest, const Data& data,
-                                    const ValidationError& error, const Name& name)
+WatchHandle::onChildReceived(WatchProcess& process, const name::Component& child)
 {
-  std::cerr << error << std::endl;
-  if (!m_processes[name].second) {
+  if (process.numbering == WatchProcess::NUMBERING_UNKNOWN) {
+    if (child.isSequenceNumber())
+      process.numbering = WatchProcess::NUMBERING_SEQUENCE;
+    else if (child.isSegment())
+      process.numbering = WatchProcess::NUMBERING_SEGMENT;
+    else
+      process.numbering = WatchProcess::NUMBERING_NONE;
+  }
+
+  if (!process.isNumbered(child)) {
+    rememberChild(process, child, true);
     return;
   }
-  if (!onRunning(name))
+
+  uint64_t number = process.toNumber(child);
+  process.highestNumber = std::max(process.highestNumber, number);
+  process.nextNumber = std::max(process.nextNumber, number + 1);
+  process.retries.erase(number);
+  process.nTimeouts.erase(number);
+}
+
+void
+WatchHandle::rememberChild(WatchProcess& process, const name::Component& child, bool isFetched)
+{
+  if (isFetched) {
+    if (process.hasReceived && child < process.greatestReceived) {
+      // a child published after a greater one: a range may hide children not stored
+      process.isMonotonic = false;
+      process.hasExcludedBefore = false;
+    }
+    else {
+      process.greatestReceived = child;
+      process.hasReceived = true;
+    }
+  }
+
+  if ((process.hasExcludedBefore && child <= process.excludedBefore) ||
+      !process.recentChildren.insert(child).second) {
     return;
+  }
+  process.childOrder.push_back(child);
+  while (process.recentChildren.size() > MAX_EXCLUDED_CHILDREN) {
+    const name::Component& oldest = process.childOrder.front();
+    if (process.isMonotonic && process.hasReceived && oldest < process.greatestReceived &&
+        (!process.hasExcludedBefore || process.excludedBefore < oldest)) {
+      process.excludedBefore = oldest;
+      process.hasExcludedBefore = true;
+    }
+    process.recentChildren.erase(oldest);
+    process.childOrder.pop_front();
+  }
+}
 
-  Interest fetchInterest(interest.getName());
-  fetchInterest.setInterestLifetime(m_interestLifetime);
+ndn::Exclude
+WatchHandle::makeExclude(const WatchProcess& process)
+{
+  ndn::Exclude exclude;
+  if (process.hasExcludedBefore)
+    exclude.excludeBefore(process.excludedBefore);
+  for (const name::Component& child : process.recentChildren) {
+    exclude.excludeOne(child);
+  }
+  return exclude;
+}
+
+void
+WatchHandle::onDataValidationFailed(const Interest& interest, const Data& data,
+                                    const ValidationError& error,
+                                    const shared_ptr<WatchProcess>& process)
+{
+  std::cerr << error << std::endl;
+  if (!process->isRunning) {
+    return;
+  }
+  --process->nOutstanding;
 
-  ++m_interestNum;
-  getFace().expressInterest(fetchInterest,
-                            bind(&WatchHandle::onData, this, _1, _2, name),
-                            bind(&WatchHandle::onTimeout, this, _1, name), // Nack
-                            bind(&WatchHandle::onTimeout, this, _1, name));
+  fillWindow(process);
 }
 
 void
-WatchHandle::onTimeout(const ndn::Interest& interest, const Name& name)
+WatchHandle::onTimeout(const ndn::Interest& interest, const shared_ptr<WatchProcess>& process)
 {
   std::cerr << "Timeout" << std::endl;
-  if (!m_processes[name].second) {
+  if (!process->isRunning) {
     return;
   }
-  if (!onRunning(name))
-    return;
-  
-  Interest fetchInterest(interest.getName());
-  fetchInterest.setInterestLifetime(m_interestLifetime);
+  --process->nOutstanding;
+
+  // a numbered child is requested again; one below the highest received may never have
+  // been published, so it is given up after a few timeouts
+  const Name& name = interest.getName();
+  if (name.size() > process->name.size() && process->isNumbered(name.get(process->name.size()))) {
+    uint64_t number = process->toNumber(name.get(process->name.size()));
+    if (number < process->highestNumber && ++process->nTimeouts[number] > MAX_GAP_RETRIES) {
+      process->nTimeouts.erase(number);
+    }
+    else {
+      process->retries.insert(number);
+    }
+  }
+
+  fillWindow(process);
+}
 
-  ++m_interestNum;
-  getFace().expressInterest(fetchInterest,
-                            bind(&WatchHandle::onData, this, _1, _2, name),
-                            bind(&WatchHandle::onTimeout, this, _1, name), // Nack
-                            bind(&WatchHandle::onTimeout, this, _1, name));
+void
+WatchHandle::fillWindow(const shared_ptr<WatchProcess>& process)
+{
+  while (process->isRunning && process->nOutstanding < getWindow(*process)) {
+    if (!onRunning(process))
+      return;
+
+    if (process->isNumbered()) {
+      uint64_t number;
+      if (!process->retries.empty()) {
+        number = *process->retries.begin();
+        process->retries.erase(process->retries.begin());
+      }
+      else {
+        // children already in the index are skipped, not fetched
+        number = process->nextNumber;
+        while (getStorageHandle().hasName(process->makeChildName(number)))
+          ++number;
+        process->nextNumber = number + 1;
+      }
+      Interest fetchInterest(process->makeChildName(number));
+      expressFetchInterest(fetchInterest, process);
+    }
+    else {
+      Interest fetchInterest(process->name);
+      fetchInterest.setExclude(makeExclude(*process));
+      expressFetchInterest(fetchInterest, process);
+    }
+  }
+}
+
+void
+WatchHandle::expressFetchInterest(Interest& interest, const shared_ptr<WatchProcess>& process)
+{
+  interest.setInterestLifetime(process->interestLifetime);
+
+  ++process->interestNum;
+  ++process->nOutstanding;
+  getFace().expressInterest(interest,
+                            bind(&WatchHandle::onData, this, _1, _2, process,
+                                 steady_clock::now()),
+                            bind(&WatchHandle::onTimeout, this, _1, process), // Nack
+                            bind(&WatchHandle::onTimeout, this, _1, process));
+}
 
+size_t
+WatchHandle::getWindow(const WatchProcess& process) const
+{
+  // the next child cannot be named, so a second Interest would fetch the same Data
+  if (!process.isNumbered())
+    return 1;
+  if (process.publishInterval == nanoseconds::zero() || process.minRtt == nanoseconds::zero())
+    return std::min(INITIAL_WINDOW, process.maxWindow);
+
+  // enough Interests to ask for everything published during one round trip
+  uint64_t nPerRtt = (process.minRtt.count() + process.publishInterval.count() - 1) /
+                     process.publishInterval.count();
+  return static_cast<size_t>(std::min<uint64_t>(nPerRtt + 1, process.maxWindow));
 }
 
 void
@@ -195,7 +341,11 @@ WatchHandle::onStopValidated(const Interest& interest, const Name& prefix)
     return;
   }
 
-  watchStop(parameter.getName());
+  auto it = m_processes.find(parameter.getName());
+  if (it != m_processes.end() && it->second->isRunning) {
+    watchStop(*it->second);
+    deferredDeleteProcess(it->second);
+  }
   negativeReply(interest, 101);
 }
 
@@ -233,14 +383,15 @@ WatchHandle::onCheckValidated(const Interest& interest, const Name& prefix)
   }
   //check whether this process exists
   Name name = parameter.getName();
-  if (m_processes.count(name) == 0) {
+  auto it = m_processes.find(name);
+  if (it == m_processes.end()) {
     std::cerr << "no such process name: " << name << std::endl;
     negativeReply(interest, 404);
     return;
   }
 
-  RepoCommandResponse& response = m_processes[name].first;
-    if (!m_processes[name].second) {
+  RepoCommandResponse& response = it->second->response;
+  if (!it->second->isRunning) {
     response.setStatusCode(101);
   }
 
@@ -256,49 +407,55 @@ WatchHandle::onCheckValidationFailed(const Interest& interest, const ValidationE
 }
 
 void
-WatchHandle::deferredDeleteProcess(const Name& name)
+WatchHandle::deferredDeleteProcess(const shared_ptr<WatchProcess>& process)
 {
   getScheduler().scheduleEvent(PROCESS_DELETE_TIME,
-                               bind(&WatchHandle::deleteProcess, this, name));
+                               bind(&WatchHandle::deleteProcess, this, process));
 }
 
 void
 WatchHandle::processWatchCommand(const Interest& interest,
                                  RepoCommandParameter& parameter)
 {
-  // if there is no watchTimeout specified, m_watchTimeout will be set as 0 and this handle will run forever
-  if (parameter.hasWatchTimeout()) {
-    m_watchTimeout = parameter.getWatchTimeout();
-  }
-  else {
-    m_watchTimeout = milliseconds(0);
+  // a new watch of a name replaces the one in progress
+  auto it = m_processes.find(parameter.getName());
+  if (it != m_processes.end()) {
+    watchStop(*it->second);
   }
 
-  // if there is no maxInterestNum specified, m_maxInterestNum will be 0, which means infinity
-  if (parameter.hasMaxInterestNum()) {
-    m_maxInterestNum = parameter.getMaxInterestNum();
-  }
-  else {
-    m_maxInterestNum = 0;
+  auto process = make_shared<WatchProcess>();
+  process->name = parameter.getName();
+  process->response.setStatusCode(300);
+  process->response.setInsertNum(0);
+  process->maxWindow = m_maxWindow;
+
+  // if there is no maxInterestNum specified, maxInterestNum will be 0, which means infinity
+  process->maxInterestNum = parameter.hasMaxInterestNum() ? parameter.getMaxInterestNum() : 0;
+
+  process->interestLifetime = parameter.hasInterestLifetime() ? parameter.getInterestLifetime() :
+                                                                DEFAULT_INTEREST_LIFETIME;
+
+  // if there is no watchTimeout specified, watchTimeout will be set as 0 and this process
+  // will run forever
+  process->watchTimeout = parameter.hasWatchTimeout() ? parameter.getWatchTimeout() :
+                                                        milliseconds(0);
+  if (process->watchTimeout != milliseconds::zero()) {
+    process->timeoutEvent = getScheduler().scheduleEvent(process->watchTimeout,
+                                                         bind(&WatchHandle::onWatchTimeout,
+                                                              this, process));
   }
 
-  if (parameter.hasInterestLifetime()) {
-    m_interestLifetime = parameter.getInterestLifetime();
+  // the first Interest excludes what is stored already, as far as it can hold
+  for (const name::Component& child :
+         getStorageHandle().getStoredChildren(process->name, MAX_EXCLUDED_CHILDREN)) {
+    rememberChild(*process, child, false);
   }
 
+  m_processes[process->name] = process;
+
   reply(interest, RepoCommandResponse().setStatusCode(100));
 
-  m_processes[parameter.getName()] =
-                std::make_pair(RepoCommandResponse().setStatusCode(300), true);
-  Interest fetchInterest(parameter.getName());
-  
-  fetchInterest.setInterestLifetime(m_interestLifetime);
-  m_startTime = steady_clock::now();
-  m_interestNum++;
-  getFace().expressInterest(fetchInterest,
-                            bind(&WatchHandle::onData, this, _1, _2, parameter.getName()),
-                            bind(&WatchHandle::onTimeout, this, _1, parameter.getName()), // Nack
-                            bind(&WatchHandle::onTimeout, this, _1, parameter.getName()));
+  fillWindow(process);
 }
 
 
@@ -311,17 +468,27 @@ WatchHandle::negativeReply(const Interest& interest, int statusCode)
 }
 
 bool
-WatchHandle::onRunning(const Name& name)
+WatchHandle::onRunning(const shared_ptr<WatchProcess>& process)
 {
-  bool isTimeout = (m_watchTimeout != milliseconds::zero() &&
-                    steady_clock::now() - m_startTime > m_watchTimeout);
-  bool isMaxInterest = m_interestNum >= m_maxInterestNum && m_maxInterestNum != 0;
-  if (isTimeout || isMaxInterest) {
-    deferredDeleteProcess(name);
-    watchStop(name);
-    return false;
+  bool isMaxInterest = process->interestNum >= process->maxInterestNum &&
+                       process->maxInterestNum != 0;
+  if (!isMaxInterest) {
+    return true;
+  }
+  if (process->nOutstanding == 0) {
+    deferredDeleteProcess(process);
+    watchStop(*process);
   }
-  return true;
+  return false;
+}
+
+void
+WatchHandle::onWatchTimeout(const shared_ptr<WatchProcess>& process)
+{
+  if (!process->isRunning)
+    return;
+  deferredDeleteProcess(process);
+  watchStop(*process);
 }
 
 } // namespace repo
@@ -22,7 +22,9 @@
 
 #include "base-handle.hpp"
 
+#include <deque>
 #include <queue>
+#include <set>
 
 namespace repo {
 
@@ -36,6 +38,17 @@ using namespace ndn::time;
  * Repo keeps sending interest to request the data with same prefix. Repo will stop
  * watching the prefix until a command interest tell it to stop, the total
  * amount of sent interests reaches a specific number or time out.
+ *
+ * Each watched prefix is a process of its own, with its own limits, counters and
+ * timeout, so that any number of watches run side by side.  The callbacks of a watch
+ * hold its process, so handling a Data or a timeout does not look the process up.
+ *
+ * Interests for the watched prefix exclude the children that are stored already, as
+ * found in the index when the watch starts and as they arrive.  If the children turn out
+ * to be sequence numbers or segments, the watch requests them by name instead, skipping
+ * those in the index, and keeps a window of Interests outstanding: one more than the
+ * number of Data published in a round trip, as estimated from the arrivals, up to the
+ * maximum window.  Children that cannot be predicted are fetched one at a time.
  */
 class WatchHandle : public BaseHandle
 {
@@ -59,6 +72,95 @@ public:
   virtual void
   listen(const Name& prefix);
 
+  /**
+   * @brief set the largest number of outstanding Interests of a watch
+   */
+  void
+  setMaxWindow(size_t nInterests);
+
+PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  /**
+   * @brief state of one watched prefix
+   */
+  struct WatchProcess
+  {
+    Name name;
+    RepoCommandResponse response;
+    bool isRunning = true;
+    int64_t interestNum = 0;     ///< interests sent so far
+    int64_t maxInterestNum = 0;  ///< 0 means no limit
+    milliseconds interestLifetime = milliseconds::zero();
+    /// 0 means the watch runs until it is stopped
+    milliseconds watchTimeout = milliseconds::zero();
+    ndn::EventId timeoutEvent;
+
+    enum Numbering {
+      NUMBERING_UNKNOWN, ///< no child fetched yet
+      NUMBERING_NONE,
+      NUMBERING_SEQUENCE,
+      NUMBERING_SEGMENT
+    };
+    /// how the children of the watched prefix are named
+    Numbering numbering = NUMBERING_UNKNOWN;
+    size_t nOutstanding = 0;
+    size_t maxWindow = 1;
+    uint64_t nextNumber = 0;             ///< lowest numbered child not requested yet
+    uint64_t highestNumber = 0;          ///< highest numbered child received
+    std::set<uint64_t> retries;          ///< numbered children to request again
+    std::map<uint64_t, int> nTimeouts;   ///< timeouts of children below highestNumber
+
+    /**
+     * @brief the latest children known to be stored, all excluded from the Interests
+     *
+     * To bound the size of the Interests, the oldest children are dropped from the set.
+     * While the children arrive in increasing order, the dropped ones are excluded with a
+     * range up to excludedBefore instead, which never reaches the greatest child received.
+     */
+    std::set<name::Component> recentChildren;
+    std::deque<name::Component> childOrder; ///< recentChildren, oldest first
+    name::Component excludedBefore;
+    bool hasExcludedBefore = false;
+    name::Component greatestReceived; ///< greatest child fetched by this watch
+    bool hasReceived = false;
+    bool isMonotonic = true;          ///< whether the fetched children came in increasing order
+
+    steady_clock::TimePoint lastArrival;
+    /// average time between new Data, 0 if unknown
+    nanoseconds publishInterval = nanoseconds::zero();
+    /// shortest response time seen, 0 if unknown
+    nanoseconds minRtt = nanoseconds::zero();
+
+    bool
+    isNumbered() const
+    {
+      return numbering == NUMBERING_SEQUENCE || numbering == NUMBERING_SEGMENT;
+    }
+
+    /**
+     * @return whether @p child is numbered like the children of the watched prefix
+     */
+    bool
+    isNumbered(const name::Component& child) const
+    {
+      return (numbering == NUMBERING_SEQUENCE && child.isSequenceNumber()) ||
+             (numbering == NUMBERING_SEGMENT && child.isSegment());
+    }
+
+    uint64_t
+    toNumber(const name::Component& child) const
+    {
+      return numbering == NUMBERING_SEQUENCE ? child.toSequenceNumber() : child.toSegment();
+    }
+
+    Name
+    makeChildName(uint64_t number) const
+    {
+      return Name(name).append(numbering == NUMBERING_SEQUENCE ?
+                               name::Component::fromSequenceNumber(number) :
+                               name::Component::fromSegment(number));
+    }
+  };
+
 private: // watch-insert command
   /**
    * @brief handle watch commands
@@ -77,30 +179,75 @@ private: // data fetching
    * @brief fetch data and send next interest
    */
   void
-  onData(const Interest& interest, const Data& data, const Name& name);
+  onData(const Interest& interest, const Data& data, const shared_ptr<WatchProcess>& process,
+         const steady_clock::TimePoint& sendTime);
 
   /**
    * @brief handle when fetching one data timeout
    */
   void
-  onTimeout(const Interest& interest, const Name& name);
+  onTimeout(const Interest& interest, const shared_ptr<WatchProcess>& process);
 
   void
-  onDataValidated(const Interest& interest, const Data& data, const Name& name);
+  onDataValidated(const Interest& interest, const Data& data,
+                  const shared_ptr<WatchProcess>& process,
+                  const steady_clock::TimePoint& sendTime);
 
   /**
    * @brief failure of validation
    */
   void
   onDataValidationFailed(const Interest& interest, const Data& data,
-                         const ValidationError& error, const Name& name);
+                         const ValidationError& error, const shared_ptr<WatchProcess>& process);
+
+  /**
+   * @brief send interests until the window of the process is full or it reached its limit
+   */
+  void
+  fillWindow(const shared_ptr<WatchProcess>& process);
+
+  void
+  expressFetchInterest(Interest& interest, const shared_ptr<WatchProcess>& process);
 
+PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  /**
+   * @return the number of interests the process may have outstanding
+   */
+  size_t
+  getWindow(const WatchProcess& process) const;
+
+  /**
+   * @brief exclude @p child, which is stored, from the next interests of the process
+   * @param isFetched  whether @p child was fetched by the process, rather than found in
+   *                   the index when the watch started
+   *
+   * A fetched child was the leftmost one the producer had that was not excluded, so every
+   * child below it was stored at that time.  While the fetched children come in increasing
+   * order, children below the greatest one are assumed to stay stored and may be excluded
+   * with a range.  Otherwise only stored children are excluded, one by one.
+   */
+  static void
+  rememberChild(WatchProcess& process, const name::Component& child, bool isFetched);
+
+  /**
+   * @brief make the Exclude selector of the next interest of an unnumbered process
+   */
+  static ndn::Exclude
+  makeExclude(const WatchProcess& process);
+
+private:
+
+  /**
+   * @brief record the numbering of the children, and the number of @p child
+   */
+  void
+  onChildReceived(WatchProcess& process, const name::Component& child);
 
   void
   processWatchCommand(const Interest& interest, RepoCommandParameter& parameter);
 
   void
-  watchStop(const Name& name);
+  watchStop(WatchProcess& process);
 
 private: // watch state check command
   /**
@@ -133,24 +280,34 @@ private:
   negativeReply(const Interest& interest, int statusCode);
 
   void
-  deferredDeleteProcess(const Name& name);
+  deferredDeleteProcess(const shared_ptr<WatchProcess>& process);
 
+  /**
+   * @brief forget the process, unless a new watch of the same name replaced it
+   */
   void
-  deleteProcess(const Name& name);
+  deleteProcess(const shared_ptr<WatchProcess>& process);
 
+  /**
+   * @brief determine whether the process may send another interest
+   *
+   * Once it sent its maximum number of interests, the process stops when the last
+   * of them is answered or times out.
+   */
   bool
-  onRunning(const Name& name);
+  onRunning(const shared_ptr<WatchProcess>& process);
+
+  void
+  onWatchTimeout(const shared_ptr<WatchProcess>& process);
 
 private:
   Validator& m_validator;
 
-  map<Name, std::pair<RepoCommandResponse, bool> > m_processes;
-  int64_t m_interestNum;
-  int64_t m_maxInterestNum;
-  milliseconds m_interestLifetime;
-  milliseconds m_watchTimeout;
-  ndn::time::steady_clock::TimePoint m_startTime;
-  int64_t m_size;
+PUBLIC_WITH_TESTS_ELSE_PRIVATE:
+  map<Name, shared_ptr<WatchProcess>> m_processes;
+
+private:
+  size_t m_maxWindow;
 };
 
 } // namespace repo
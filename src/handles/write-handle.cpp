@@ -19,13 +19,23 @@
 
 #include "write-handle.hpp"
 
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <limits>
+
 namespace repo {
 
 static const int RETRY_TIMEOUT = 3;
-static const int DEFAULT_CREDIT = 12;
+static const size_t INITIAL_WINDOW = 12;
+static const size_t DEFAULT_MAX_WINDOW = 1024;
+static const size_t DEFAULT_MAX_OUTSTANDING = 4096;
 static const milliseconds NOEND_TIMEOUT(10000);
 static const milliseconds PROCESS_DELETE_TIME(10000);
 static const milliseconds DEFAULT_INTEREST_LIFETIME(4000);
+static const milliseconds INITIAL_RTO(1000);
+static const milliseconds MIN_RTO(200);
 
 WriteHandle::WriteHandle(Face& face, RepoStorage& storageHandle, KeyChain& keyChain,
                          Scheduler& scheduler,
@@ -33,16 +43,213 @@ WriteHandle::WriteHandle(Face& face, RepoStorage& storageHandle, KeyChain& keyCh
   : BaseHandle(face, storageHandle, keyChain, scheduler)
   , m_validator(validator)
   , m_retryTime(RETRY_TIMEOUT)
-  , m_credit(DEFAULT_CREDIT)
+  , m_initialWindow(INITIAL_WINDOW)
+  , m_maxWindow(DEFAULT_MAX_WINDOW)
   , m_noEndTimeout(NOEND_TIMEOUT)
-  , m_interestLifetime(DEFAULT_INTEREST_LIFETIME)
+  , m_maxOutstanding(DEFAULT_MAX_OUTSTANDING)
+  , m_nOutstanding(0)
+  , m_checkpointInterval(0)
+  , m_isCheckpointScheduled(false)
+{
+}
+
+void
+WriteHandle::setMaxWindow(size_t nSegments)
+{
+  m_maxWindow = std::max<size_t>(nSegments, 1);
+}
+
+void
+WriteHandle::setMaxOutstanding(size_t nInterests)
+{
+  m_maxOutstanding = std::max<size_t>(nInterests, 1);
+}
+
+void
+WriteHandle::setCheckpointPath(const std::string& path, const milliseconds& interval)
+{
+  m_checkpointPath = path;
+  m_checkpointInterval = interval;
+}
+
+void
+WriteHandle::saveCheckpoint()
+{
+  if (m_checkpointPath.empty())
+    return;
+
+  // the segments the checkpoint shows as received must be in storage
+  getStorageHandle().flush();
+
+  std::vector<InsertCheckpoint> checkpoints;
+  for (const auto& entry : m_processes) {
+    const ProcessInfo& process = entry.second;
+    const RepoCommandResponse& response = process.response;
+    if (response.getStatusCode() != 300 || !response.hasStartBlockId())
+      continue;
+
+    InsertCheckpoint checkpoint;
+    checkpoint.processId = entry.first;
+    checkpoint.prefix = process.prefix;
+    checkpoint.startBlockId = response.getStartBlockId();
+    checkpoint.hasEndBlockId = response.hasEndBlockId();
+    checkpoint.endBlockId = response.hasEndBlockId() ? response.getEndBlockId() : 0;
+    checkpoint.interestLifetime = process.interestLifetime;
+    checkpoint.insertNum = response.getInsertNum();
+    checkpoint.base = process.segments.getBase();
+    for (SegmentNo segment = checkpoint.base; segment < process.nextSegment; ++segment) {
+      size_t bit = segment - checkpoint.base;
+      if (bit % 64 == 0)
+        checkpoint.received.push_back(0);
+      if (process.segments.isReceived(segment))
+        checkpoint.received.back() |= uint64_t(1) << (bit % 64);
+    }
+    checkpoints.push_back(checkpoint);
+  }
+
+  // write to a temporary file first, so that a crash never leaves a truncated checkpoint
+  std::string tmpPath = m_checkpointPath + ".tmp";
+  {
+    std::ofstream os(tmpPath, std::ios::binary | std::ios::trunc);
+    writeInsertCheckpoints(os, checkpoints);
+    os.close();
+    if (!os)
+      BOOST_THROW_EXCEPTION(Error("Failed to write insert checkpoint '" + tmpPath + "'"));
+  }
+  boost::filesystem::rename(tmpPath, m_checkpointPath);
+}
+
+void
+WriteHandle::resumeProcesses()
+{
+  if (m_checkpointPath.empty() || !boost::filesystem::exists(m_checkpointPath))
+    return;
+
+  std::vector<InsertCheckpoint> checkpoints;
+  try {
+    std::ifstream is(m_checkpointPath, std::ios::binary);
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(is)),
+                                std::istreambuf_iterator<char>());
+    checkpoints = readInsertCheckpoints(buffer.data(), buffer.size());
+  }
+  catch (const InsertCheckpoint::Error& e) {
+    std::cerr << "Cannot load insert checkpoint '" << m_checkpointPath << "': "
+              << e.what() << std::endl;
+    return;
+  }
+
+  for (const InsertCheckpoint& checkpoint : checkpoints) {
+    resumeProcess(checkpoint);
+  }
+}
+
+void
+WriteHandle::resumeProcess(const InsertCheckpoint& checkpoint)
+{
+  if (m_processes.count(checkpoint.processId) != 0) {
+    return;
+  }
+  ProcessId processId = checkpoint.processId;
+  ProcessInfo& process = m_processes[processId];
+  RepoCommandResponse& response = process.response;
+  response.setStatusCode(300);
+  response.setProcessId(processId);
+  response.setStartBlockId(checkpoint.startBlockId);
+  if (checkpoint.hasEndBlockId) {
+    response.setEndBlockId(checkpoint.endBlockId);
+  }
+  process.prefix = checkpoint.prefix;
+  process.interestLifetime = checkpoint.interestLifetime;
+  initFetch(process, checkpoint.base);
+
+  auto isInCheckpoint = [&checkpoint] (SegmentNo segment) {
+    SegmentNo bit = segment - checkpoint.base;
+    return bit < checkpoint.received.size() * 64 &&
+           ((checkpoint.received[bit / 64] >> (bit % 64)) & 1);
+  };
+  for (size_t bit = 0; bit < checkpoint.received.size() * 64; ++bit) {
+    if (isInCheckpoint(checkpoint.base + bit))
+      process.segments.markStored(checkpoint.base + bit);
+  }
+
+  // segments stored after the checkpoint was written are in the index; they are only
+  // counted here, and skipped once the fetch gets to them, so that far segments do not
+  // grow the ring of the tracker
+  SegmentNo last = checkpoint.hasEndBlockId ? checkpoint.endBlockId :
+                                              std::numeric_limits<SegmentNo>::max();
+  uint64_t nStored = 0;
+  for (SegmentNo segment : getStorageHandle().getStoredSegments(process.prefix,
+                                                                checkpoint.base, last)) {
+    if (!isInCheckpoint(segment))
+      ++nStored;
+  }
+  response.setInsertNum(checkpoint.insertNum + nStored);
+  skipStoredSegments(process);
+
+  std::cerr << "resume process " << processId << ": " << process.prefix
+            << " from segment " << process.segments.getBase() << std::endl;
+
+  if (checkpoint.hasEndBlockId && process.segments.getBase() > checkpoint.endBlockId) {
+    response.setStatusCode(200);
+    deferredDeleteProcess(processId);
+    return;
+  }
+  if (!checkpoint.hasEndBlockId) {
+    process.noEndTime = ndn::time::steady_clock::now() + m_noEndTimeout;
+  }
+
+  scheduleCheckpoint();
+  sendSegments(processId);
+}
+
+void
+WriteHandle::scheduleCheckpoint()
 {
+  if (m_checkpointPath.empty() || m_isCheckpointScheduled)
+    return;
+
+  m_isCheckpointScheduled = true;
+  getScheduler().scheduleEvent(m_checkpointInterval,
+                               bind(&WriteHandle::onCheckpointTimer, this));
+}
+
+void
+WriteHandle::onCheckpointTimer()
+{
+  m_isCheckpointScheduled = false;
+  try {
+    saveCheckpoint();
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: failed to save insert checkpoint: " << e.what() << std::endl;
+  }
+
+  // the last checkpoint, written once no process is in progress, is empty
+  for (const auto& entry : m_processes) {
+    const RepoCommandResponse& response = entry.second.response;
+    if (response.getStatusCode() == 300 && response.hasStartBlockId()) {
+      scheduleCheckpoint();
+      return;
+    }
+  }
 }
 
 void
 WriteHandle::deleteProcess(ProcessId processId)
 {
-  m_processes.erase(processId);
+  eraseProcess(processId);
+}
+
+void
+WriteHandle::eraseProcess(ProcessId processId)
+{
+  auto process = m_processes.find(processId);
+  if (process == m_processes.end())
+    return;
+  m_sendRound.deactivate(processId);
+  m_nOutstanding -= process->second.segments.getNOutstanding();
+  m_processes.erase(process);
+  serveProcesses();
 }
 
 // Interest.
@@ -74,8 +281,6 @@ WriteHandle::onValidated(const Interest& interest, const Name& prefix)
   else {
     processSingleInsertCommand(interest, parameter);
   }
-  if (parameter.hasInterestLifetime())
-    m_interestLifetime = parameter.getInterestLifetime();
 }
 
 void
@@ -135,7 +340,21 @@ WriteHandle::onSegmentDataValidated(const Interest& interest, const Data& data,
   if (m_processes.count(processId) == 0) {
     return;
   }
-  RepoCommandResponse& response = m_processes[processId].response;
+  ProcessInfo& process = m_processes[processId];
+  RepoCommandResponse& response = process.response;
+
+  //segments may arrive out of order; a segment that was already received is dropped
+  SegmentNo segment = interest.getName().get(-1).toSegment();
+  ndn::time::nanoseconds rtt;
+  size_t nOutstanding = process.segments.getNOutstanding();
+  if (!process.segments.markReceived(segment, ndn::time::steady_clock::now(), rtt)) {
+    return;
+  }
+  m_nOutstanding -= nOutstanding - process.segments.getNOutstanding();
+  if (rtt > ndn::time::nanoseconds::zero()) {
+    process.rttEstimator.addMeasurement(rtt);
+  }
+  process.window.increase();
 
   //refresh endBlockId
   Name::Component finalBlockId = data.getFinalBlockId();
@@ -164,7 +383,7 @@ void
 WriteHandle::onTimeout(const Interest& interest, ProcessId processId)
 {
   std::cerr << "Timeout" << std::endl;
-  m_processes.erase(processId);
+  eraseProcess(processId);
 }
 
 void
@@ -188,44 +407,168 @@ void
 WriteHandle::segInit(ProcessId processId, const RepoCommandParameter& parameter)
 {
   ProcessInfo& process = m_processes[processId];
-  process.credit = 0;
+  process.prefix = parameter.getName();
+  process.interestLifetime = parameter.hasInterestLifetime() ?
+                             parameter.getInterestLifetime() : DEFAULT_INTEREST_LIFETIME;
+  initFetch(process, parameter.getStartBlockId());
 
-  map<SegmentNo, int>& processRetry = process.retryCounts;
+  if (!parameter.hasEndBlockId()) {
+    // set noEndTimeout timer
+    process.noEndTime = ndn::time::steady_clock::now() +
+                        m_noEndTimeout;
+  }
 
-  Name name = parameter.getName();
-  SegmentNo startBlockId = parameter.getStartBlockId();
+  scheduleCheckpoint();
+  sendSegments(processId);
+}
 
-  uint64_t initialCredit = m_credit;
+void
+WriteHandle::initFetch(ProcessInfo& process, SegmentNo first)
+{
+  process.nextSegment = first;
+  process.segments.reset(first);
+  process.window = AimdWindow(m_initialWindow, m_maxWindow);
+  process.rttEstimator = RttEstimator(std::min(INITIAL_RTO, process.interestLifetime),
+                                      std::min(MIN_RTO, process.interestLifetime),
+                                      process.interestLifetime);
+  process.isSkipScheduled = false;
+}
 
-  if (parameter.hasEndBlockId()) {
-    initialCredit =
-      std::min(initialCredit, parameter.getEndBlockId() - parameter.getStartBlockId() + 1);
+bool
+WriteHandle::skipStoredSegments(ProcessInfo& process)
+{
+  const RepoCommandResponse& response = process.response;
+  // the end is taken once, so that a base moving along does not extend the walk; a segment
+  // to send at the end still grows the ring as the window needs
+  SegmentNo end = process.segments.getEnd();
+  while (true) {
+    if (response.hasEndBlockId() && process.nextSegment > response.getEndBlockId())
+      return false;
+    if (!process.segments.isReceived(process.nextSegment) &&
+        !getStorageHandle().hasName(Name(process.prefix).appendSegment(process.nextSegment)))
+      return false;
+    if (process.nextSegment >= end)
+      return true;
+    process.segments.markStored(process.nextSegment);
+    ++process.nextSegment;
   }
-  else {
-    // set noEndTimeout timer
-    process.noEndTime = ndn::time::steady_clock::now() +
-                        m_noEndTimeout;
+}
+
+bool
+WriteHandle::completeIfDone(ProcessId processId, ProcessInfo& process)
+{
+  RepoCommandResponse& response = process.response;
+  if (!response.hasEndBlockId())
+    return false;
+
+  skipStoredSegments(process);
+  if (process.segments.getBase() <= response.getEndBlockId())
+    return false;
+
+  //All the data has been inserted, StatusCode is refreshed as 200
+  response.setStatusCode(200);
+  deferredDeleteProcess(processId);
+  serveProcesses();
+  return true;
+}
+
+void
+WriteHandle::scheduleContinueFetch(ProcessId processId, ProcessInfo& process)
+{
+  if (process.isSkipScheduled)
+    return;
+  process.isSkipScheduled = true;
+  getScheduler().scheduleEvent(ndn::time::milliseconds(0),
+                               bind(&WriteHandle::continueFetch, this, processId));
+}
+
+void
+WriteHandle::continueFetch(ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end() || it->second.response.getStatusCode() != 300)
+    return;
+  it->second.isSkipScheduled = false;
+  if (!completeIfDone(processId, it->second))
+    sendSegments(processId);
+}
+
+void
+WriteHandle::sendSegments(ProcessId processId)
+{
+  m_sendRound.activate(processId);
+  serveProcesses();
+}
+
+void
+WriteHandle::serveProcesses()
+{
+  if (m_nOutstanding >= m_maxOutstanding)
+    return;
+  m_sendRound.serve(m_maxOutstanding - m_nOutstanding,
+                    bind(&WriteHandle::sendNextSegment, this, _1));
+}
+
+bool
+WriteHandle::sendNextSegment(ProcessId processId)
+{
+  auto it = m_processes.find(processId);
+  if (it == m_processes.end()) {
+    return false;
   }
-  process.credit = initialCredit;
-  SegmentNo segment = startBlockId;
+  ProcessInfo& process = it->second;
+  RepoCommandResponse& response = process.response;
 
-  for (; segment < startBlockId + initialCredit; ++segment) {
-    Name fetchName = name;
-    fetchName.appendSegment(segment);
-    Interest interest(fetchName);
-    interest.setInterestLifetime(m_interestLifetime);
-    getFace().expressInterest(interest,
-                              bind(&WriteHandle::onSegmentData, this, _1, _2, processId),
-                              bind(&WriteHandle::onSegmentTimeout, this, _1, processId), // Nack
-                              bind(&WriteHandle::onSegmentTimeout, this, _1, processId));
-    process.credit--;
-    processRetry[segment] = 0;
+  //a process that completed or failed sends nothing more
+  if (response.getStatusCode() != 300) {
+    return false;
   }
 
-  queue<SegmentNo>& nextSegmentQueue = process.nextSegmentQueue;
+  while (process.segments.getNOutstanding() < process.window.getSize()) {
+    SegmentNo segment;
+    if (process.segments.hasRetransmission()) {
+      segment = process.segments.popRetransmission();
+      //segments beyond a FinalBlockId learned after they were sent are not retried
+      if (response.hasEndBlockId() && segment > response.getEndBlockId()) {
+        process.segments.cancel(segment);
+        continue;
+      }
+    }
+    else {
+      bool isRingFull = skipStoredSegments(process);
+      //check whether nextSegment exceeds
+      if (response.hasEndBlockId() && process.nextSegment > response.getEndBlockId())
+        return false;
+      if (isRingFull) {
+        // outstanding segments move the base when they arrive or time out
+        if (process.segments.getNOutstanding() == 0)
+          scheduleContinueFetch(processId, process);
+        return false;
+      }
+      segment = process.nextSegment++;
+    }
+    expressSegmentInterest(processId, process, segment);
+    return true;
+  }
+  return false;
+}
 
-  process.nextSegment = segment;
-  nextSegmentQueue.push(segment);
+void
+WriteHandle::expressSegmentInterest(ProcessId processId, ProcessInfo& process,
+                                    SegmentNo segment)
+{
+  Name fetchName = process.prefix;
+  fetchName.appendSegment(segment);
+  Interest fetchInterest(fetchName);
+  // the interest times out when its data is overdue according to the RTT estimate
+  fetchInterest.setInterestLifetime(process.rttEstimator.getRto());
+  getFace().expressInterest(fetchInterest,
+                            bind(&WriteHandle::onSegmentData, this, _1, _2, processId),
+                            bind(&WriteHandle::onSegmentTimeout, this, _1, processId), // Nack
+                            bind(&WriteHandle::onSegmentTimeout, this, _1, processId));
+  size_t nOutstanding = process.segments.getNOutstanding();
+  process.segments.markSent(segment, ndn::time::steady_clock::now());
+  m_nOutstanding += process.segments.getNOutstanding() - nOutstanding;
 }
 
 void
@@ -236,13 +579,8 @@ WriteHandle::onSegmentDataControl(ProcessId processId, const Interest& interest)
   }
   ProcessInfo& process = m_processes[processId];
   RepoCommandResponse& response = process.response;
-  int& processCredit = process.credit;
-  //onSegmentDataControl is called when a data returns.
-  //When data returns, processCredit++
-  processCredit++;
-  SegmentNo& nextSegment = process.nextSegment;
-  queue<SegmentNo>& nextSegmentQueue = process.nextSegmentQueue;
-  map<SegmentNo, int>& retryCounts = process.retryCounts;
+
+  // the segment was already marked received in onSegmentDataValidated()
 
   //read whether notime timeout
   if (!response.hasEndBlockId()) {
@@ -257,77 +595,16 @@ WriteHandle::onSegmentDataControl(ProcessId processId, const Interest& interest)
       response.setStatusCode(405);
       //schedule a delete event
       deferredDeleteProcess(processId);
+      serveProcesses();
       return;
     }
   }
 
-  //read whether this process has total ends, if ends, remove control info from the maps
-  if (response.hasEndBlockId()) {
-    uint64_t nSegments =
-      response.getEndBlockId() - response.getStartBlockId() + 1;
-    if (response.getInsertNum() >= nSegments) {
-      //m_processes.erase(processId);
-      //All the data has been inserted, StatusCode is refreshed as 200
-      response.setStatusCode(200);
-      deferredDeleteProcess(processId);
-      return;
-    }
-  }
-
-  //check whether there is any credit
-  if (processCredit == 0)
+  //read whether this process has total ends, i.e. every segment up to EndBlockId arrived
+  if (completeIfDone(processId, process))
     return;
 
-
-  //check whether sent queue empty
-  if (nextSegmentQueue.empty()) {
-    //do not do anything
-    return;
-  }
-
-  //pop the queue
-  SegmentNo sendingSegment = nextSegmentQueue.front();
-  nextSegmentQueue.pop();
-
-  //check whether sendingSegment exceeds
-  if (response.hasEndBlockId() && sendingSegment > response.getEndBlockId()) {
-    //do not do anything
-    return;
-  }
-
-  //read whether this is retransmitted data;
-  SegmentNo fetchedSegment =
-    interest.getName().get(interest.getName().size() - 1).toSegment();
-
-  BOOST_ASSERT(retryCounts.count(fetchedSegment) != 0);
-
-  //find this fetched data, remove it from this map
-  //rit->second.erase(oit);
-  retryCounts.erase(fetchedSegment);
-  //express the interest of the top of the queue
-  Name fetchName(interest.getName().getPrefix(-1));
-  fetchName.appendSegment(sendingSegment);
-  Interest fetchInterest(fetchName);
-  fetchInterest.setInterestLifetime(m_interestLifetime);
-  getFace().expressInterest(fetchInterest,
-                            bind(&WriteHandle::onSegmentData, this, _1, _2, processId),
-                            bind(&WriteHandle::onSegmentTimeout, this, _1, processId), // Nack
-                            bind(&WriteHandle::onSegmentTimeout, this, _1, processId));
-  //When an interest is expressed, processCredit--
-  processCredit--;
-  if (retryCounts.count(sendingSegment) == 0) {
-    //not found
-    retryCounts[sendingSegment] = 0;
-  }
-  else {
-    //found
-    retryCounts[sendingSegment] = retryCounts[sendingSegment] + 1;
-  }
-  //increase the next seg and put it into the queue
-  if (!response.hasEndBlockId() || (nextSegment + 1) <= response.getEndBlockId()) {
-    nextSegment++;
-    nextSegmentQueue.push(nextSegment);
-  }
+  sendSegments(processId);
 }
 
 void
@@ -337,36 +614,36 @@ WriteHandle::onSegmentTimeoutControl(ProcessId processId, const Interest& intere
     return;
   }
   ProcessInfo& process = m_processes[processId];
-  // RepoCommandResponse& response = process.response;
-  // SegmentNo& nextSegment = process.nextSegment;
-  // queue<SegmentNo>& nextSegmentQueue = process.nextSegmentQueue;
-  map<SegmentNo, int>& retryCounts = process.retryCounts;
+  RepoCommandResponse& response = process.response;
 
   SegmentNo timeoutSegment = interest.getName().get(-1).toSegment();
 
   std::cerr << "timeoutSegment: " << timeoutSegment << std::endl;
 
-  BOOST_ASSERT(retryCounts.count(timeoutSegment) != 0);
+  //a segment beyond FinalBlockId does not exist, so its timeout is no loss
+  size_t nOutstanding = process.segments.getNOutstanding();
+  if (response.hasEndBlockId() && timeoutSegment > response.getEndBlockId()) {
+    process.segments.cancel(timeoutSegment);
+    m_nOutstanding -= nOutstanding - process.segments.getNOutstanding();
+    sendSegments(processId);
+    return;
+  }
 
-  //read the retry time. If retry out of time, fail the process. if not, plus
-  int& retryTime = retryCounts[timeoutSegment];
-  if (retryTime >= m_retryTime) {
+  //read the retry time. If retry out of time, fail the process. if not, it is queued again
+  int nTimeouts = process.segments.markTimedOut(timeoutSegment);
+  if (nTimeouts == 0)
+    return;
+  m_nOutstanding -= nOutstanding - process.segments.getNOutstanding();
+  if (nTimeouts > m_retryTime) {
     //fail this process
     std::cerr << "Retry timeout: " << processId << std::endl;
-    m_processes.erase(processId);
+    eraseProcess(processId);
     return;
   }
-  else {
-    //Reput it in the queue, retryTime++
-    retryTime++;
-    Interest retryInterest(interest.getName());
-    retryInterest.setInterestLifetime(m_interestLifetime);
-    getFace().expressInterest(retryInterest,
-                              bind(&WriteHandle::onSegmentData, this, _1, _2, processId),
-                              bind(&WriteHandle::onSegmentTimeout, this, _1, processId), // Nack
-                              bind(&WriteHandle::onSegmentTimeout, this, _1, processId));
-  }
 
+  process.window.decrease(timeoutSegment, process.nextSegment - 1);
+  process.rttEstimator.backoffRto();
+  sendSegments(processId);
 }
 
 void
@@ -456,8 +733,10 @@ WriteHandle::processSingleInsertCommand(const Interest& interest,
 
   response.setStatusCode(300);
 
+  process.interestLifetime = parameter.hasInterestLifetime() ?
+                             parameter.getInterestLifetime() : DEFAULT_INTEREST_LIFETIME;
   Interest fetchInterest(parameter.getName());
-  fetchInterest.setInterestLifetime(m_interestLifetime);
+  fetchInterest.setInterestLifetime(process.interestLifetime);
   
   getFace().expressInterest(fetchInterest,
                             bind(&WriteHandle::onData, this, _1, _2, processId),
@@ -21,6 +21,9 @@
 #define REPO_HANDLES_WRITE_HANDLE_HPP
 
 #include "base-handle.hpp"
+#include "congestion-control.hpp"
+#include "insert-checkpoint.hpp"
+#include "segment-tracker.hpp"
 
 #include <queue>
 
@@ -31,13 +34,20 @@ using std::pair;
 using std::queue;
 
 /**
- * @brief WriteHandle provides basic credit based congestion control.
+ * @brief WriteHandle fetches segmented data with an adaptive congestion window.
  *
- * First repo sends interests of credit number and then credit will be 0.
+ * Each process keeps as many interests in flight as its AIMD window allows, and all
+ * processes share a budget of outstanding interests: processes whose windows have room
+ * take turns sending by deficit round robin, so that concurrent inserts progress at the
+ * same rate and a large one cannot starve the others.
  *
- * If a data comes, credit++ and sends a interest then credit--.
+ * If a data comes, the window grows and the RTT estimator takes a sample, unless the
+ * segment was retransmitted.
  *
- * If the interest timeout, repo will retry and send interest in retrytimes.
+ * Interests live for the retransmission timeout of the RTT estimator, which is bounded by
+ * the InterestLifetime of the insert command.  If an interest
+ * times out, the window is halved, the timeout is doubled and the segment is retried,
+ * up to retrytimes.
  *
  * If one interest timeout beyond retrytimes, the fetching process will terminate.
  *
@@ -50,6 +60,10 @@ using std::queue;
  * If client sends a insert check command, the noendTimeout timer will be set to 0.
  *
  * If repo cannot get FinalBlockId in noendTimeout time, the fetching process will terminate.
+ *
+ * With a checkpoint path, the segmented processes in progress are checkpointed
+ * periodically, and resumed after a restart: segments the checkpoint or the index shows
+ * as stored are not fetched again.
  */
 class WriteHandle : public BaseHandle
 {
@@ -73,20 +87,64 @@ public:
   virtual void
   listen(const Name& prefix);
 
-private:
+  /**
+   * @brief set the largest congestion window of segmented fetch processes
+   */
+  void
+  setMaxWindow(size_t nSegments);
+
+  /**
+   * @brief set the number of interests segmented fetch processes may have in flight together
+   */
+  void
+  setMaxOutstanding(size_t nInterests);
+
+  /**
+   * @return the number of interests of segmented fetch processes in flight
+   */
+  size_t
+  getNOutstanding() const
+  {
+    return m_nOutstanding;
+  }
+
+  /**
+   * @brief checkpoint the segmented processes in progress to @p path every @p interval
+   */
+  void
+  setCheckpointPath(const std::string& path, const ndn::time::milliseconds& interval);
+
+  /**
+   * @brief write the checkpoint now, after committing the pending group of inserts
+   */
+  void
+  saveCheckpoint();
+
+  /**
+   * @brief resume the processes of the checkpoint left by the previous run, if any
+   *
+   * To be called once the storage has been initialized.  Each process keeps its
+   * ProcessId and only fetches the segments that are not in storage.
+   */
+  void
+  resumeProcesses();
+
+PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   /**
   * @brief Information of insert process including variables for response
-  *        and credit based flow control
+  *        and congestion control
   */
   struct ProcessInfo
   {
     //ProcessId id;
     RepoCommandResponse response;
-    queue<SegmentNo> nextSegmentQueue;  ///< queue of waiting segment
-                                        ///  to be sent when having credits
-    SegmentNo nextSegment;  ///< last segment put into the nextSegmentQueue
-    map<SegmentNo, int> retryCounts;  ///< to store retrying times of timeout segment
-    int credit;  ///< congestion control credits of process
+    Name prefix;  ///< name of the segmented data, without the segment number
+    ndn::time::milliseconds interestLifetime;  ///< InterestLifetime of the insert command
+    SegmentNo nextSegment;  ///< first segment that has not been requested yet
+    SegmentTracker segments;  ///< received, outstanding and timed out segments
+    AimdWindow window;
+    RttEstimator rttEstimator;
+    bool isSkipScheduled;  ///< whether continueFetch() is scheduled
 
     /**
      * @brief the latest time point at which EndBlockId must be determined
@@ -153,12 +211,83 @@ private:  // segmented data fetching
   void
   segInit(ProcessId processId, const RepoCommandParameter& parameter);
 
+  /**
+   * @brief start the congestion control of the process over from segment @p first
+   */
+  void
+  initFetch(ProcessInfo& process, SegmentNo first);
+
+  /**
+   * @brief move the next segment to send past those received or already in storage
+   * @return true if it stopped at the end of the tracker's ring, where more stored
+   *         segments may follow
+   *
+   * Stored segments are marked as they are reached, and never beyond the ring, so the
+   * tracker only holds the segments around the window and one call looks up at most
+   * a ring of segments in the index.
+   */
+  bool
+  skipStoredSegments(ProcessInfo& process);
+
+  /**
+   * @brief reply 200 if every segment up to EndBlockId has been received or was stored
+   * @return whether the process completed
+   */
+  bool
+  completeIfDone(ProcessId processId, ProcessInfo& process);
+
+  /**
+   * @brief go on skipping stored segments in a later turn of the event loop
+   *
+   * Used when a run of stored segments fills the ring while no Interest is outstanding,
+   * so nothing else would move the fetch forward.
+   */
+  void
+  scheduleContinueFetch(ProcessId processId, ProcessInfo& process);
+
+  void
+  continueFetch(ProcessId processId);
+
+  void
+  resumeProcess(const InsertCheckpoint& checkpoint);
+
+  /**
+   * @brief checkpoint again after the interval, while segmented processes are in progress
+   */
+  void
+  scheduleCheckpoint();
+
+  void
+  onCheckpointTimer();
+
   /**
    * @brief control for sending interests in function onSegmentData()
    */
   void
   onSegmentDataControl(ProcessId processId, const Interest& interest);
 
+  /**
+   * @brief let the process take its turns at sending, and serve the processes
+   */
+  void
+  sendSegments(ProcessId processId);
+
+  /**
+   * @brief let the processes whose windows have room send, within the outstanding budget
+   */
+  void
+  serveProcesses();
+
+  /**
+   * @brief send the next retransmission or new segment of the process
+   * @return false if its window is full or it has no segment left to send
+   */
+  bool
+  sendNextSegment(ProcessId processId);
+
+  void
+  expressSegmentInterest(ProcessId processId, ProcessInfo& process, SegmentNo segment);
+
   /**
    * @brief control for sending interest in function onSegmentTimeout
    */
@@ -201,6 +330,12 @@ private:
   void
   deleteProcess(ProcessId processId);
 
+  /**
+   * @brief drop the process, releasing its share of the outstanding budget
+   */
+  void
+  eraseProcess(ProcessId processId);
+
   /**
    * @brief schedule a event to delete the process
    */
@@ -213,12 +348,21 @@ private:
 private:
   Validator& m_validator;
 
+PUBLIC_WITH_TESTS_ELSE_PRIVATE:
   map<ProcessId, ProcessInfo> m_processes;
 
+private:
   int m_retryTime;
-  int m_credit;
+  size_t m_initialWindow;
+  size_t m_maxWindow;
   ndn::time::milliseconds m_noEndTimeout;
-  ndn::time::milliseconds m_interestLifetime;
+  size_t m_maxOutstanding;
+  size_t m_nOutstanding;
+  DeficitRoundRobin m_sendRound;
+
+  std::string m_checkpointPath;
+  ndn::time::milliseconds m_checkpointInterval;
+  bool m_isCheckpointScheduled;
 };
 
 } // namespace repo
@@ -89,6 +89,11 @@ main(int argc, char** argv)
     repoInstance.enableListening();
 
     ioService.run();
+
+    // run() returns once the repo has been stopped
+    repoInstance.stopListening();
+    repoInstance.saveIndexSnapshot();
+    repoInstance.saveInsertCheckpoint();
   }
   catch (const std::exception& e) {
     std::cerr << "ERROR: " << e.what() << std::endl;
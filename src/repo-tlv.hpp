@@ -37,7 +37,9 @@ enum {
   InsertNum            = 209,
   DeleteNum            = 210,
   MaxInterestNum       = 211,
-  WatchTimeout         = 212
+  WatchTimeout         = 212,
+  BulkInsertAck        = 213,
+  FailedNum            = 214
 };
 
 } // tlv
@@ -62,6 +62,15 @@ parseConfig(const std::string& configPath)
   for (const auto& section : commandConf) {
     if (section.first == "prefix")
       repoConfig.repoPrefixes.push_back(Name(section.second.get_value<std::string>()));
+    else if (section.first == "insert-max-window")
+      repoConfig.insertMaxWindow = section.second.get_value<size_t>();
+    else if (section.first == "insert-max-outstanding")
+      repoConfig.insertMaxOutstanding = section.second.get_value<size_t>();
+    else if (section.first == "watch-max-window")
+      repoConfig.watchMaxWindow = section.second.get_value<size_t>();
+    else if (section.first == "insert-checkpoint-interval")
+      repoConfig.insertCheckpointInterval =
+        ndn::time::milliseconds(section.second.get_value<uint64_t>());
     else
       BOOST_THROW_EXCEPTION(Repo::Error("Unrecognized '" + section.first + "' option in 'command' section in "
                                         "configuration file '"+ configPath +"'"));
@@ -78,6 +87,10 @@ parseConfig(const std::string& configPath)
       // tcp_bulk_insert {
       //   host "localhost"  ; IP address or hostname to listen on
       //   port 7635  ; Port number to listen on
+      //   buffer-size 1048576  ; Size of the receive buffer of each connection
+      //   workers 0  ; Threads decoding received packets, 0 for one per hardware thread
+      //   ack-interval 0  ; Milliseconds between acknowledgements, 0 to send none
+      //   high-watermark 16384  ; Received packets waiting for insertion before reading stops
       // }
       if (section.first == "host") {
         host = section.second.get_value<std::string>();
@@ -85,6 +98,19 @@ parseConfig(const std::string& configPath)
       else if (section.first == "port") {
         port = section.second.get_value<std::string>();
       }
+      else if (section.first == "buffer-size") {
+        repoConfig.tcpBulkInsertBufferSize = section.second.get_value<size_t>();
+      }
+      else if (section.first == "workers") {
+        repoConfig.tcpBulkInsertWorkers = section.second.get_value<size_t>();
+      }
+      else if (section.first == "ack-interval") {
+        repoConfig.tcpBulkInsertAckInterval =
+          ndn::time::milliseconds(section.second.get_value<uint64_t>());
+      }
+      else if (section.first == "high-watermark") {
+        repoConfig.tcpBulkInsertHighWatermark = section.second.get_value<size_t>();
+      }
       else
         BOOST_THROW_EXCEPTION(Repo::Error("Unrecognized '" + section.first + "' option in 'tcp_bulk_insert' section in "
                                           "configuration file '"+ configPath +"'"));
@@ -94,6 +120,50 @@ parseConfig(const std::string& configPath)
     repoConfig.tcpBulkInsertEndpoints.push_back(std::make_pair(host, port));
   }
 
+  auto localBulkInsert = repoConf.get_child_optional("local_bulk_insert");
+  if (localBulkInsert) {
+    for (const auto& section : *localBulkInsert) {
+      // local_bulk_insert {
+      //   path "/var/run/ndn-repo-bulk-insert.sock"  ; Unix stream socket to listen on
+      // }
+      if (section.first == "path") {
+        repoConfig.localBulkInsertPath = section.second.get_value<std::string>();
+      }
+      else
+        BOOST_THROW_EXCEPTION(Repo::Error("Unrecognized '" + section.first + "' option in 'local_bulk_insert' section in "
+                                          "configuration file '"+ configPath +"'"));
+    }
+    if (repoConfig.localBulkInsertPath.empty())
+      BOOST_THROW_EXCEPTION(Repo::Error("Missing 'path' option in 'local_bulk_insert' section in "
+                                        "configuration file '"+ configPath +"'"));
+  }
+
+  auto tcpBulkRead = repoConf.get_child_optional("tcp_bulk_read");
+  if (tcpBulkRead) {
+    std::string readHost = "localhost";
+    std::string readPort = "7377";
+    for (const auto& section : *tcpBulkRead) {
+      // tcp_bulk_read {
+      //   host "localhost"  ; IP address or hostname to listen on
+      //   port 7377  ; Port number to listen on
+      //   write-size 1048576  ; Bytes of Data gathered into each write
+      // }
+      if (section.first == "host") {
+        readHost = section.second.get_value<std::string>();
+      }
+      else if (section.first == "port") {
+        readPort = section.second.get_value<std::string>();
+      }
+      else if (section.first == "write-size") {
+        repoConfig.tcpBulkReadWriteSize = section.second.get_value<size_t>();
+      }
+      else
+        BOOST_THROW_EXCEPTION(Repo::Error("Unrecognized '" + section.first + "' option in 'tcp_bulk_read' section in "
+                                          "configuration file '"+ configPath +"'"));
+    }
+    repoConfig.tcpBulkReadEndpoints.push_back(std::make_pair(readHost, readPort));
+  }
+
   if (repoConf.get<std::string>("storage.method") != "sqlite") {
     BOOST_THROW_EXCEPTION(Repo::Error("Only 'sqlite' storage method is supported"));
   }
@@ -104,6 +174,44 @@ parseConfig(const std::string& configPath)
 
   repoConfig.nMaxPackets = repoConf.get<uint64_t>("storage.max-packets");
 
+  repoConfig.groupCommitSize = repoConf.get<size_t>("storage.group-commit-size",
+                                                    repoConfig.groupCommitSize);
+  repoConfig.groupCommitWindow =
+    ndn::time::milliseconds(repoConf.get<uint64_t>("storage.group-commit-window",
+                                                   repoConfig.groupCommitWindow.count()));
+
+  repoConfig.cacheSize = repoConf.get<size_t>("storage.cache-size", repoConfig.cacheSize);
+
+  repoConfig.useIndexSnapshot = repoConf.get<bool>("storage.index-snapshot",
+                                                   repoConfig.useIndexSnapshot);
+  repoConfig.snapshotInterval =
+    ndn::time::seconds(repoConf.get<uint64_t>("storage.snapshot-interval",
+                                              repoConfig.snapshotInterval.count()));
+  repoConfig.rebuildThreads = repoConf.get<size_t>("storage.rebuild-threads",
+                                                   repoConfig.rebuildThreads);
+
+  repoConfig.evictionPolicy = repoConf.get<std::string>("storage.eviction",
+                                                        repoConfig.evictionPolicy);
+  if (repoConfig.evictionPolicy != "none" && repoConfig.evictionPolicy != "lru" &&
+      repoConfig.evictionPolicy != "fifo" && repoConfig.evictionPolicy != "quota")
+    BOOST_THROW_EXCEPTION(Repo::Error("Unrecognized eviction policy '" + repoConfig.evictionPolicy +
+                                      "' in configuration file '" + configPath + "'"));
+  repoConfig.evictionBatchSize = repoConf.get<size_t>("storage.eviction-batch",
+                                                      repoConfig.evictionBatchSize);
+
+  repoConfig.deleteChunkSize = repoConf.get<size_t>("storage.delete-chunk-size",
+                                                    repoConfig.deleteChunkSize);
+
+  // eviction-quota {
+  //   /example/a 1000  ; at most 1000 packets under /example/a
+  // }
+  auto evictionQuota = repoConf.get_child_optional("storage.eviction-quota");
+  if (evictionQuota) {
+    for (const auto& section : *evictionQuota) {
+      repoConfig.evictionQuotas[Name(section.first)] = section.second.get_value<size_t>();
+    }
+  }
+
   return repoConfig;
 }
 
@@ -118,21 +226,89 @@ Repo::Repo(boost::asio::io_service& ioService, const RepoConfig& config)
   , m_writeHandle(m_face, m_storageHandle, m_keyChain, m_scheduler, m_validator)
   , m_watchHandle(m_face, m_storageHandle, m_keyChain, m_scheduler, m_validator)
   , m_deleteHandle(m_face, m_storageHandle, m_keyChain, m_scheduler, m_validator)
-  , m_tcpBulkInsertHandle(ioService, m_storageHandle)
+  , m_tcpBulkInsertHandle(ioService, m_storageHandle, m_config.tcpBulkInsertWorkers)
+  , m_tcpBulkReadHandle(ioService, m_storageHandle)
 
 {
   this->enableValidation();
+
+  if (m_config.groupCommitSize > 1) {
+    m_storageHandle.enableGroupCommit(m_scheduler, m_config.groupCommitSize,
+                                      m_config.groupCommitWindow);
+  }
+  m_storageHandle.setCacheCapacity(m_config.cacheSize);
+  m_storageHandle.setRebuildThreads(m_config.rebuildThreads);
+  m_writeHandle.setMaxWindow(m_config.insertMaxWindow);
+  m_writeHandle.setMaxOutstanding(m_config.insertMaxOutstanding);
+  m_watchHandle.setMaxWindow(m_config.watchMaxWindow);
+  m_deleteHandle.setChunkSize(m_config.deleteChunkSize);
+  m_tcpBulkInsertHandle.setBufferSize(m_config.tcpBulkInsertBufferSize);
+  m_tcpBulkInsertHandle.setAckInterval(m_config.tcpBulkInsertAckInterval);
+  m_tcpBulkInsertHandle.setHighWatermark(m_config.tcpBulkInsertHighWatermark);
+  m_tcpBulkReadHandle.setWriteSize(m_config.tcpBulkReadWriteSize);
+  if (m_config.evictionPolicy != "none") {
+    m_storageHandle.setEvictionPolicy(EvictionPolicy::create(m_config.evictionPolicy,
+                                                             m_config.evictionQuotas),
+                                      m_config.evictionBatchSize);
+  }
+  std::string dir = m_config.dbPath.empty() ? "." : m_config.dbPath;
+  if (m_config.useIndexSnapshot) {
+    m_storageHandle.setSnapshotPath(dir + "/index.snapshot");
+  }
+  if (m_config.insertCheckpointInterval > ndn::time::milliseconds::zero()) {
+    m_writeHandle.setCheckpointPath(dir + "/insert.checkpoint", m_config.insertCheckpointInterval);
+  }
 }
 
 void
 Repo::initializeStorage()
 {
-  // Rebuild storage if storage checkpoin exists
+  // Rebuild storage, starting from the index snapshot if it exists
   ndn::time::steady_clock::TimePoint start = ndn::time::steady_clock::now();
   m_storageHandle.initialize();
   ndn::time::steady_clock::TimePoint end = ndn::time::steady_clock::now();
   ndn::time::milliseconds cost = ndn::time::duration_cast<ndn::time::milliseconds>(end - start);
   std::cerr << "initialize storage cost: " << cost << "ms" << std::endl;
+
+  // snapshots are only written once the index has been rebuilt
+  scheduleIndexSnapshot();
+
+  // interrupted inserts look up the segments they already stored in the index
+  m_writeHandle.resumeProcesses();
+}
+
+void
+Repo::saveIndexSnapshot()
+{
+  try {
+    m_storageHandle.saveSnapshot();
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: failed to save index snapshot: " << e.what() << std::endl;
+  }
+}
+
+void
+Repo::saveInsertCheckpoint()
+{
+  try {
+    m_writeHandle.saveCheckpoint();
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: failed to save insert checkpoint: " << e.what() << std::endl;
+  }
+}
+
+void
+Repo::scheduleIndexSnapshot()
+{
+  if (!m_config.useIndexSnapshot || m_config.snapshotInterval <= ndn::time::seconds::zero())
+    return;
+
+  m_scheduler.scheduleEvent(m_config.snapshotInterval, [this] {
+      saveIndexSnapshot();
+      scheduleIndexSnapshot();
+    });
 }
 
 void
@@ -157,6 +333,19 @@ Repo::enableListening()
   for (const auto& ep : m_config.tcpBulkInsertEndpoints) {
     m_tcpBulkInsertHandle.listen(ep.first, ep.second);
   }
+  if (!m_config.localBulkInsertPath.empty()) {
+    m_tcpBulkInsertHandle.listenLocal(m_config.localBulkInsertPath);
+  }
+  for (const auto& ep : m_config.tcpBulkReadEndpoints) {
+    m_tcpBulkReadHandle.listen(ep.first, ep.second);
+  }
+}
+
+void
+Repo::stopListening()
+{
+  m_tcpBulkInsertHandle.stop();
+  m_tcpBulkReadHandle.stop();
 }
 
 void
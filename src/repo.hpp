@@ -29,6 +29,7 @@
 #include "handles/watch-handle.hpp"
 #include "handles/delete-handle.hpp"
 #include "handles/tcp-bulk-insert-handle.hpp"
+#include "handles/tcp-bulk-read-handle.hpp"
 
 #include "common.hpp"
 
@@ -48,8 +49,29 @@ struct RepoConfig
   std::vector<ndn::Name> dataPrefixes;
   size_t registrationSubset = DISABLED_SUBSET_LENGTH;
   std::vector<ndn::Name> repoPrefixes;
+  size_t insertMaxWindow = 1024;
+  size_t insertMaxOutstanding = 4096;
+  ndn::time::milliseconds insertCheckpointInterval = ndn::time::milliseconds(1000);
+  size_t watchMaxWindow = 64;
   std::vector<std::pair<std::string, std::string> > tcpBulkInsertEndpoints;
+  size_t tcpBulkInsertBufferSize = 1024 * 1024;
+  size_t tcpBulkInsertWorkers = 0;
+  ndn::time::milliseconds tcpBulkInsertAckInterval = ndn::time::milliseconds(0);
+  size_t tcpBulkInsertHighWatermark = 16384;
+  std::string localBulkInsertPath;
+  std::vector<std::pair<std::string, std::string> > tcpBulkReadEndpoints;
+  size_t tcpBulkReadWriteSize = 1024 * 1024;
   uint64_t nMaxPackets;
+  size_t groupCommitSize = 1;
+  ndn::time::milliseconds groupCommitWindow = ndn::time::milliseconds(10);
+  size_t cacheSize = 0;
+  bool useIndexSnapshot = true;
+  ndn::time::seconds snapshotInterval = ndn::time::seconds(0);
+  size_t rebuildThreads = 1;
+  std::string evictionPolicy = "none";
+  size_t evictionBatchSize = 64;
+  std::map<Name, size_t> evictionQuotas;
+  size_t deleteChunkSize = 1000;
   boost::property_tree::ptree validatorNode;
 };
 
@@ -76,12 +98,42 @@ public:
   void
   initializeStorage();
 
+  /**
+   * @brief save a snapshot of the index for the next start, when the repo shuts down cleanly
+   */
+  void
+  saveIndexSnapshot();
+
+  /**
+   * @brief checkpoint the inserts in progress, so that they resume at the next start
+   */
+  void
+  saveInsertCheckpoint();
+
   void
   enableListening();
 
+  /**
+   * @brief stop accepting bulk insert and bulk read connections, when the repo shuts down
+   *
+   * The local bulk insert socket file is removed.
+   */
+  void
+  stopListening();
+
   void
   enableValidation();
 
+private:
+  /**
+   * @brief save an index snapshot every snapshot-interval
+   *
+   * Each snapshot serializes the whole index on the io thread, which serves nothing
+   * meanwhile.
+   */
+  void
+  scheduleIndexSnapshot();
+
 private:
   RepoConfig m_config;
   ndn::Scheduler m_scheduler;
@@ -95,6 +147,7 @@ private:
   WatchHandle m_watchHandle;
   DeleteHandle m_deleteHandle;
   TcpBulkInsertHandle m_tcpBulkInsertHandle;
+  TcpBulkReadHandle m_tcpBulkReadHandle;
 };
 
 } // namespace repo
@@ -0,0 +1,88 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data-cache.hpp"
+
+namespace repo {
+
+DataCache::DataCache(size_t capacity)
+  : m_capacity(capacity)
+  , m_size(0)
+{
+}
+
+Block
+DataCache::find(int64_t id)
+{
+  auto it = m_entryById.find(id);
+  if (it == m_entryById.end()) {
+    ++m_counters.nMisses;
+    return Block();
+  }
+
+  ++m_counters.nHits;
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  return it->second->second;
+}
+
+void
+DataCache::insert(int64_t id, const Block& wire)
+{
+  erase(id);
+  if (wire.size() > m_capacity)
+    return;
+
+  evict(m_capacity - wire.size());
+  m_entries.emplace_front(id, wire);
+  m_entryById[id] = m_entries.begin();
+  m_size += wire.size();
+}
+
+void
+DataCache::erase(int64_t id)
+{
+  auto it = m_entryById.find(id);
+  if (it == m_entryById.end())
+    return;
+
+  m_size -= it->second->second.size();
+  m_entries.erase(it->second);
+  m_entryById.erase(it);
+}
+
+void
+DataCache::setCapacity(size_t capacity)
+{
+  m_capacity = capacity;
+  evict(m_capacity);
+}
+
+void
+DataCache::evict(size_t capacity)
+{
+  while (m_size > capacity) {
+    BOOST_ASSERT(!m_entries.empty());
+    m_size -= m_entries.back().second.size();
+    m_entryById.erase(m_entries.back().first);
+    m_entries.pop_back();
+    ++m_counters.nEvictions;
+  }
+}
+
+} // namespace repo
@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_STORAGE_DATA_CACHE_HPP
+#define REPO_STORAGE_DATA_CACHE_HPP
+
+#include "../common.hpp"
+
+#include <unordered_map>
+
+namespace repo {
+
+/**
+ * @brief DataCache keeps the wire encoding of recently read Data in memory
+ *
+ * Entries are keyed by the id of the index entry and evicted in least-recently-used
+ * order once their total size exceeds the capacity in bytes.
+ */
+class DataCache : noncopyable
+{
+public:
+  class Counters
+  {
+  public:
+    uint64_t nHits = 0;
+    uint64_t nMisses = 0;
+    uint64_t nEvictions = 0;
+  };
+
+public:
+  /**
+   * @param capacity  maximum total size of cached blocks in bytes, 0 disables the cache
+   */
+  explicit
+  DataCache(size_t capacity = 0);
+
+  /**
+   * @brief look up the block cached for @p id, and mark it as most recently used
+   * @return the cached block, or an empty Block on a miss
+   */
+  Block
+  find(int64_t id);
+
+  /**
+   * @brief cache @p wire under @p id, evicting least recently used blocks as needed
+   *
+   * Blocks larger than the capacity are not cached.
+   */
+  void
+  insert(int64_t id, const Block& wire);
+
+  /**
+   * @brief drop the block cached for @p id, if any
+   */
+  void
+  erase(int64_t id);
+
+  void
+  setCapacity(size_t capacity);
+
+  size_t
+  getCapacity() const
+  {
+    return m_capacity;
+  }
+
+  /**
+   * @brief total size of cached blocks in bytes
+   */
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  const Counters&
+  getCounters() const
+  {
+    return m_counters;
+  }
+
+private:
+  void
+  evict(size_t capacity);
+
+private:
+  typedef std::list<std::pair<int64_t, Block>> EntryList;
+
+  EntryList m_entries; ///< most recently used first
+  std::unordered_map<int64_t, EntryList::iterator> m_entryById;
+  size_t m_capacity;
+  size_t m_size;
+  Counters m_counters;
+};
+
+} // namespace repo
+
+#endif // REPO_STORAGE_DATA_CACHE_HPP
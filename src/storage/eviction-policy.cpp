@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eviction-policy.hpp"
+
+#include <ndn-cxx/util/backports.hpp>
+
+#include <limits>
+
+namespace repo {
+
+unique_ptr<EvictionPolicy>
+EvictionPolicy::create(const std::string& policyName, const std::map<Name, size_t>& quotas)
+{
+  if (policyName == "lru")
+    return ndn::make_unique<LruEvictionPolicy>();
+  if (policyName == "fifo")
+    return ndn::make_unique<FifoEvictionPolicy>();
+  if (policyName == "quota")
+    return ndn::make_unique<QuotaEvictionPolicy>(quotas);
+  BOOST_THROW_EXCEPTION(Error("Unknown eviction policy '" + policyName + "'"));
+}
+
+void
+LruEvictionPolicy::afterInsert(int64_t id, const Name& fullName)
+{
+  afterErase(id);
+  m_entries.push_back(id);
+  m_entryById[id] = std::prev(m_entries.end());
+}
+
+void
+LruEvictionPolicy::afterRead(int64_t id)
+{
+  auto it = m_entryById.find(id);
+  if (it != m_entryById.end())
+    m_entries.splice(m_entries.end(), m_entries, it->second);
+}
+
+void
+LruEvictionPolicy::afterErase(int64_t id)
+{
+  auto it = m_entryById.find(id);
+  if (it == m_entryById.end())
+    return;
+  m_entries.erase(it->second);
+  m_entryById.erase(it);
+}
+
+std::vector<int64_t>
+LruEvictionPolicy::selectVictims(size_t nNeeded)
+{
+  std::vector<int64_t> victims;
+  for (auto it = m_entries.begin(); it != m_entries.end() && victims.size() < nNeeded; ++it) {
+    victims.push_back(*it);
+  }
+  return victims;
+}
+
+void
+FifoEvictionPolicy::afterInsert(int64_t id, const Name& fullName)
+{
+  m_entries.insert(id);
+}
+
+void
+FifoEvictionPolicy::afterErase(int64_t id)
+{
+  m_entries.erase(id);
+}
+
+std::vector<int64_t>
+FifoEvictionPolicy::selectVictims(size_t nNeeded)
+{
+  std::vector<int64_t> victims;
+  for (auto it = m_entries.begin(); it != m_entries.end() && victims.size() < nNeeded; ++it) {
+    victims.push_back(*it);
+  }
+  return victims;
+}
+
+QuotaEvictionPolicy::QuotaEvictionPolicy(const std::map<Name, size_t>& quotas)
+  : m_nOverLimit(0)
+{
+  for (const auto& quota : quotas) {
+    m_quotas[quota.first].limit = quota.second;
+    m_prefixSizes.insert(quota.first.size());
+  }
+  m_unlimited.limit = std::numeric_limits<size_t>::max();
+}
+
+QuotaEvictionPolicy::Quota&
+QuotaEvictionPolicy::findQuota(const Name& fullName)
+{
+  for (size_t prefixSize : m_prefixSizes) {
+    if (prefixSize > fullName.size())
+      continue;
+    auto quota = m_quotas.find(fullName.getPrefix(prefixSize));
+    if (quota != m_quotas.end())
+      return quota->second;
+  }
+  return m_unlimited;
+}
+
+void
+QuotaEvictionPolicy::afterInsert(int64_t id, const Name& fullName)
+{
+  afterErase(id);
+  Quota& quota = findQuota(fullName);
+  quota.entries.insert(id);
+  m_quotaById[id] = &quota;
+  if (quota.entries.size() > quota.limit)
+    ++m_nOverLimit;
+}
+
+void
+QuotaEvictionPolicy::afterErase(int64_t id)
+{
+  auto it = m_quotaById.find(id);
+  if (it == m_quotaById.end())
+    return;
+  Quota& quota = *it->second;
+  if (quota.entries.size() > quota.limit)
+    --m_nOverLimit;
+  quota.entries.erase(id);
+  m_quotaById.erase(it);
+}
+
+std::vector<int64_t>
+QuotaEvictionPolicy::selectVictims(size_t nNeeded)
+{
+  std::vector<int64_t> victims;
+
+  // the oldest entries past their quota go first
+  std::vector<std::pair<std::set<int64_t>::const_iterator,
+                        std::set<int64_t>::const_iterator>> remaining;
+  for (const auto& quota : m_quotas) {
+    auto it = quota.second.entries.begin();
+    for (size_t nOver = quota.second.entries.size() - std::min(quota.second.entries.size(),
+                                                               quota.second.limit);
+         nOver > 0; --nOver, ++it) {
+      victims.push_back(*it);
+    }
+    remaining.emplace_back(it, quota.second.entries.end());
+  }
+  remaining.emplace_back(m_unlimited.entries.begin(), m_unlimited.entries.end());
+
+  // then the oldest entries of all
+  while (victims.size() < nNeeded) {
+    auto oldest = remaining.end();
+    for (auto range = remaining.begin(); range != remaining.end(); ++range) {
+      if (range->first != range->second &&
+          (oldest == remaining.end() || *range->first < *oldest->first))
+        oldest = range;
+    }
+    if (oldest == remaining.end())
+      break;
+    victims.push_back(*oldest->first++);
+  }
+  return victims;
+}
+
+} // namespace repo
@@ -0,0 +1,197 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPO_STORAGE_EVICTION_POLICY_HPP
+#define REPO_STORAGE_EVICTION_POLICY_HPP
+
+#include "../common.hpp"
+
+#include <set>
+#include <unordered_map>
+
+namespace repo {
+
+/**
+ * @brief EvictionPolicy chooses the entries RepoStorage removes to make room for new data
+ *
+ * RepoStorage reports every entry it inserts, reads and erases, and asks for victims
+ * before inserting data.  Policies keep only the ids of the entries; RepoStorage looks
+ * the names of the victims up in its index.
+ */
+class EvictionPolicy : noncopyable
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    explicit
+    Error(const std::string& what)
+      : std::runtime_error(what)
+    {
+    }
+  };
+
+  virtual
+  ~EvictionPolicy() = default;
+
+  /**
+   * @brief create the policy called @p policyName
+   * @param quotas  maximum number of entries under each prefix, used by the "quota" policy
+   * @throw Error unknown policy name
+   */
+  static unique_ptr<EvictionPolicy>
+  create(const std::string& policyName, const std::map<Name, size_t>& quotas);
+
+  virtual void
+  afterInsert(int64_t id, const Name& fullName) = 0;
+
+  virtual void
+  afterRead(int64_t id)
+  {
+  }
+
+  /**
+   * @brief called after an entry is erased, whether or not the policy selected it
+   */
+  virtual void
+  afterErase(int64_t id) = 0;
+
+  /**
+   * @brief select the entries to evict
+   * @param nNeeded  number of entries that must go to make room for new data
+   * @return the ids of at least @p nNeeded entries if there are that many, and of any
+   *         entry the policy wants gone on its own; the entries stay tracked until
+   *         afterErase()
+   */
+  virtual std::vector<int64_t>
+  selectVictims(size_t nNeeded) = 0;
+
+  /**
+   * @brief get the number of entries the policy wants gone on its own
+   *
+   * RepoStorage asks for victims only when the repo is full or this many are due, so
+   * that the policy is not scanned on every insert.
+   */
+  virtual size_t
+  getNOverLimit() const
+  {
+    return 0;
+  }
+};
+
+/**
+ * @brief evict the entries that were read or inserted least recently
+ */
+class LruEvictionPolicy : public EvictionPolicy
+{
+public:
+  void
+  afterInsert(int64_t id, const Name& fullName) override;
+
+  void
+  afterRead(int64_t id) override;
+
+  void
+  afterErase(int64_t id) override;
+
+  std::vector<int64_t>
+  selectVictims(size_t nNeeded) override;
+
+private:
+  typedef std::list<int64_t> EntryList;
+
+  EntryList m_entries; ///< least recently used first
+  std::unordered_map<int64_t, EntryList::iterator> m_entryById;
+};
+
+/**
+ * @brief evict the entries that were inserted first, i.e. those with the lowest ids
+ */
+class FifoEvictionPolicy : public EvictionPolicy
+{
+public:
+  void
+  afterInsert(int64_t id, const Name& fullName) override;
+
+  void
+  afterErase(int64_t id) override;
+
+  std::vector<int64_t>
+  selectVictims(size_t nNeeded) override;
+
+private:
+  std::set<int64_t> m_entries;
+};
+
+/**
+ * @brief keep the number of entries under each configured prefix within its quota
+ *
+ * An entry counts against the quota of the longest configured prefix of its name.
+ * Entries over a quota are evicted oldest first, even if the repo is not full, once
+ * enough of them for an eviction batch have accumulated.  When the repo is full, the
+ * oldest entries are evicted regardless of their prefix.
+ */
+class QuotaEvictionPolicy : public EvictionPolicy
+{
+public:
+  explicit
+  QuotaEvictionPolicy(const std::map<Name, size_t>& quotas);
+
+  void
+  afterInsert(int64_t id, const Name& fullName) override;
+
+  void
+  afterErase(int64_t id) override;
+
+  std::vector<int64_t>
+  selectVictims(size_t nNeeded) override;
+
+  size_t
+  getNOverLimit() const override
+  {
+    return m_nOverLimit;
+  }
+
+private:
+  class Quota
+  {
+  public:
+    size_t limit;
+    std::set<int64_t> entries;
+  };
+
+  /**
+   * @brief find the quota of the longest configured prefix of @p fullName
+   *
+   * Only the prefixes of @p fullName as long as a configured prefix are looked up.
+   */
+  Quota&
+  findQuota(const Name& fullName);
+
+private:
+  std::map<Name, Quota> m_quotas;
+  std::set<size_t, std::greater<size_t>> m_prefixSizes; ///< sizes of the configured prefixes
+  Quota m_unlimited; ///< entries under no configured prefix
+  std::unordered_map<int64_t, Quota*> m_quotaById;
+  size_t m_nOverLimit; ///< number of entries beyond the limits of all quotas
+};
+
+} // namespace repo
+
+#endif // REPO_STORAGE_EVICTION_POLICY_HPP
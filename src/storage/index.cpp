@@ -19,17 +19,73 @@
 
 #include "index.hpp"
 
+#include <ndn-cxx/util/backports.hpp>
 #include <ndn-cxx/util/sha256.hpp>
 #include <ndn-cxx/security/signature-sha256-with-rsa.hpp>
 
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <set>
+
 namespace repo {
 
-/** @brief determines if entry can satisfy interest
- *  @param hash SHA256 hash of PublisherPublicKeyLocator if exists in interest, otherwise ignored
+/** @brief compare a component stored in the name tree with the TLV encoding of another
+ *
+ *  Comparing TLV encodings byte by byte gives the canonical order of name components,
+ *  because TLV-TYPE and TLV-LENGTH come first and VAR-NUMBER encoding preserves order.
  */
+static int
+compareComponent(const std::string& component, const Block& wire)
+{
+  size_t length = std::min(component.size(), wire.size());
+  int result = std::memcmp(component.data(), wire.wire(), length);
+  if (result != 0)
+    return result;
+  if (component.size() == wire.size())
+    return 0;
+  return component.size() < wire.size() ? -1 : 1;
+}
+
+Index::NodeContainer::const_iterator
+Index::findChild(const NodeContainer& children, const Block& wire)
+{
+  return std::lower_bound(children.begin(), children.end(), wire,
+                          [] (const unique_ptr<Node>& child, const Block& component) {
+                            return compareComponent(child->component, component) < 0;
+                          });
+}
+
+Index::NodeContainer::iterator
+Index::findChild(NodeContainer& children, const Node& child)
+{
+  // std::string compares bytes like compareComponent
+  auto it = std::lower_bound(children.begin(), children.end(), child.component,
+                             [] (const unique_ptr<Node>& node, const std::string& component) {
+                               return node->component < component;
+                             });
+  BOOST_ASSERT(it != children.end() && it->get() == &child);
+  return it;
+}
+
+Index::Node::Node()
+  : parent(nullptr)
+  , hasEntry(false)
+  , id(0)
+{
+}
+
+Index::Node::Node(const uint8_t* wire, size_t wireSize, Node* parent)
+  : component(reinterpret_cast<const char*>(wire), wireSize)
+  , parent(parent)
+  , hasEntry(false)
+  , id(0)
+{
+}
 
 Index::Index(size_t nMaxPackets)
-  : m_maxPackets(nMaxPackets)
+  : m_isFindNameEnabled(false)
+  , m_maxPackets(nMaxPackets)
   , m_size(0)
 {
 }
@@ -41,10 +97,7 @@ Index::insert(const Data& data, int64_t id)
   if (isFull())
     BOOST_THROW_EXCEPTION(Error("The Index is Full. Cannot Insert Any Data!"));
   Entry entry(data, id);
-  bool isInserted = m_indexContainer.insert(entry).second;
-  if (isInserted)
-    ++m_size;
-  return isInserted;
+  return insertEntry(entry.getName(), id, entry.getKeyLocatorHash());
 }
 
 bool
@@ -53,82 +106,829 @@ Index::insert(const Name& fullName, int64_t id,
 {
   if (isFull())
     BOOST_THROW_EXCEPTION(Error("The Index is Full. Cannot Insert Any Data!"));
-  Entry entry(fullName, keyLocatorHash, id);
-  bool isInserted = m_indexContainer.insert(entry).second;
-  if (isInserted)
-    ++m_size;
-  return isInserted;
+  return insertEntry(fullName, id, keyLocatorHash);
+}
+
+std::vector<bool>
+Index::insertBatch(const std::vector<Entry>& entries)
+{
+  std::vector<size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&entries] (size_t a, size_t b) { return entries[a] < entries[b]; });
+  return insertInOrder(entries, order);
+}
+
+std::vector<bool>
+Index::insertSorted(const std::vector<Entry>& entries)
+{
+  BOOST_ASSERT(std::is_sorted(entries.begin(), entries.end()));
+  std::vector<size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+  return insertInOrder(entries, order);
+}
+
+std::vector<bool>
+Index::insertInOrder(const std::vector<Entry>& entries, const std::vector<size_t>& order)
+{
+  std::vector<bool> results(entries.size(), false);
+
+  // nodes of the previously inserted name; the walk down the prefix it shares
+  // with the next name is skipped
+  std::vector<Node*> path{&m_root};
+  const Name* previous = nullptr;
+  for (size_t i : order) {
+    if (isFull())
+      BOOST_THROW_EXCEPTION(Error("The Index is Full. Cannot Insert Any Data!"));
+
+    const Name& fullName = entries[i].getName();
+    size_t nShared = 0;
+    if (previous != nullptr) {
+      size_t maxShared = std::min(previous->size(), fullName.size());
+      while (nShared < maxShared && previous->get(nShared) == fullName.get(nShared))
+        ++nShared;
+    }
+    path.resize(nShared + 1);
+    for (size_t c = nShared; c < fullName.size(); ++c) {
+      path.push_back(&findOrCreateChild(*path.back(), fullName.get(c).wireEncode()));
+    }
+    previous = &fullName;
+
+    results[i] = setEntry(*path.back(), fullName, entries[i].getId(),
+                          entries[i].getKeyLocatorHash());
+  }
+  return results;
+}
+
+bool
+Index::insertEntry(const Name& fullName, int64_t id, const ndn::ConstBufferPtr& keyLocatorHash)
+{
+  Node* node = &m_root;
+  for (const auto& component : fullName) {
+    node = &findOrCreateChild(*node, component.wireEncode());
+  }
+  return setEntry(*node, fullName, id, keyLocatorHash);
+}
+
+Index::Node&
+Index::findOrCreateChild(Node& node, const Block& wire)
+{
+  auto child = findChild(node.children, wire);
+  if (child == node.children.end() || compareComponent((*child)->component, wire) != 0) {
+    child = node.children.insert(child, ndn::make_unique<Node>(wire.wire(), wire.size(), &node));
+  }
+  return **child;
 }
 
+bool
+Index::setEntry(Node& node, const Name& fullName, int64_t id,
+                const ndn::ConstBufferPtr& keyLocatorHash)
+{
+  if (node.hasEntry)
+    return false;
+  node.hasEntry = true;
+  node.id = id;
+  node.keyLocatorHash = keyLocatorHash;
+  ++m_size;
+
+  Digest digest;
+  if (getDigest(fullName, digest))
+    m_digestTable[digest] = &node;
+  if (m_isFindNameEnabled)
+    m_nodeById[id] = &node;
+  return true;
+}
 
 std::pair<int64_t,Name>
 Index::find(const Interest& interest) const
 {
-  Name name = interest.getName();
-  IndexContainer::const_iterator result = m_indexContainer.lower_bound(name);
-  if (result != m_indexContainer.end())
-    {
-      // get the name of interest and match prefix
-      return findFirstEntry(name, result);
-    }
-  else
-    {
-      return std::make_pair(0, Name());
+  if (!interest.hasSelectors())
+    return find(interest.getName());
+
+  const Name& name = interest.getName();
+  const Node* node = nullptr;
+  Digest digest;
+  if (getDigest(name, digest))
+    node = findFullName(digest, name);
+  if (node == nullptr)
+    node = findNode(name);
+  if (node == nullptr)
+    return std::make_pair(0, Name());
+  return selectChild(interest, *node);
+}
+
+std::pair<int64_t,Name>
+Index::selectChild(const Interest& interest, const Node& prefixNode) const
+{
+  ndn::ConstBufferPtr keyLocatorHash;
+  if (!interest.getPublisherPublicKeyLocator().empty())
+    keyLocatorHash = computeKeyLocatorHash(interest.getPublisherPublicKeyLocator());
+
+  const Node* match = nullptr;
+  if (interest.getChildSelector() != 1) {
+    match = findLeftmostMatch(interest, keyLocatorHash, prefixNode, 0);
+  }
+  else {
+    if (interest.getMaxSuffixComponents() != 0) {
+      for (auto child = prefixNode.children.rbegin();
+           child != prefixNode.children.rend() && match == nullptr; ++child) {
+        if (!isExcluded(interest, **child))
+          match = findLeftmostMatch(interest, keyLocatorHash, **child, 1);
+      }
     }
-  
+    // an entry named exactly by the Interest has no child component, so it comes last
+    if (match == nullptr && prefixNode.hasEntry &&
+        matchesSimpleSelectors(interest, keyLocatorHash, prefixNode, 0))
+      match = &prefixNode;
+  }
+
+  if (match == nullptr)
+    return std::make_pair(0, Name());
+  return std::make_pair(match->id, getName(*match));
+}
+
+const Index::Node*
+Index::findLeftmostMatch(const Interest& interest, const ndn::ConstBufferPtr& keyLocatorHash,
+                         const Node& node, size_t depth)
+{
+  if (node.hasEntry && matchesSimpleSelectors(interest, keyLocatorHash, node, depth))
+    return &node;
+
+  int maxSuffixComponents = interest.getMaxSuffixComponents();
+  if (maxSuffixComponents >= 0 && depth >= static_cast<size_t>(maxSuffixComponents))
+    return nullptr;
+
+  for (const auto& child : node.children) {
+    if (depth == 0 && isExcluded(interest, *child))
+      continue;
+    const Node* match = findLeftmostMatch(interest, keyLocatorHash, *child, depth + 1);
+    if (match != nullptr)
+      return match;
+  }
+  return nullptr;
+}
+
+bool
+Index::matchesSimpleSelectors(const Interest& interest, const ndn::ConstBufferPtr& keyLocatorHash,
+                              const Node& node, size_t depth)
+{
+  BOOST_ASSERT(node.hasEntry);
+  if (interest.getMinSuffixComponents() >= 0 &&
+      depth < static_cast<size_t>(interest.getMinSuffixComponents()))
+    return false;
+  if (interest.getMaxSuffixComponents() >= 0 &&
+      depth > static_cast<size_t>(interest.getMaxSuffixComponents()))
+    return false;
+  if (keyLocatorHash != nullptr) {
+    if (node.keyLocatorHash == nullptr || *node.keyLocatorHash != *keyLocatorHash)
+      return false;
+  }
+  return true;
+}
+
+bool
+Index::isExcluded(const Interest& interest, const Node& child)
+{
+  if (interest.getExclude().empty())
+    return false;
+  name::Component component(Block(reinterpret_cast<const uint8_t*>(child.component.data()),
+                                  child.component.size()));
+  return interest.getExclude().isExcluded(component);
 }
 
 std::pair<int64_t,Name>
 Index::find(const Name& name) const
 {
-  IndexContainer::const_iterator result = m_indexContainer.lower_bound(name);
-  if (result != m_indexContainer.end())
-    {
-      return findFirstEntry(name, result);
+  // an entry with exactly this name comes before anything else under it
+  Digest digest;
+  if (getDigest(name, digest)) {
+    const Node* node = findFullName(digest, name);
+    if (node != nullptr)
+      return std::make_pair(node->id, name);
+  }
+
+  const Node* node = findNode(name);
+  if (node == nullptr)
+    return std::make_pair(0, Name());
+  return findFirstEntry(*node);
+}
+
+std::vector<std::pair<int64_t, Name>>
+Index::findAll(const Name& prefix, size_t limit) const
+{
+  std::vector<std::pair<int64_t, Name>> entries;
+  const Node* node = findNode(prefix);
+  if (node != nullptr)
+    collectEntries(*node, limit, entries);
+  return entries;
+}
+
+std::vector<std::pair<int64_t, Name>>
+Index::findAllAfter(const Name& prefix, const Name& after, size_t limit) const
+{
+  if (after.empty())
+    return findAll(prefix, limit);
+
+  std::vector<std::pair<int64_t, Name>> entries;
+  const Node* node = findNode(prefix);
+  if (node == nullptr || !prefix.isPrefixOf(after))
+    return entries;
+
+  // walk down to after, remembering at each level the first child that sorts after it;
+  // a child that is not on the path sorts after it with its whole subtree
+  std::vector<std::pair<const Node*, NodeContainer::const_iterator>> levels;
+  for (size_t i = prefix.size(); i < after.size() && node != nullptr; ++i) {
+    const Block& wire = after.get(i).wireEncode();
+    auto child = findChild(node->children, wire);
+    if (child != node->children.end() && compareComponent((*child)->component, wire) == 0) {
+      levels.emplace_back(node, std::next(child));
+      node = child->get();
     }
-  else
-    {
-      return std::make_pair(0, Name());
+    else {
+      levels.emplace_back(node, child);
+      node = nullptr;
+    }
+  }
+
+  // the descendants of after come right after it, then what follows each level up
+  if (node != nullptr) {
+    for (const auto& child : node->children) {
+      collectEntries(*child, limit, entries);
+    }
+  }
+  for (auto level = levels.rbegin(); level != levels.rend() && entries.size() < limit; ++level) {
+    for (auto child = level->second;
+         child != level->first->children.end() && entries.size() < limit; ++child) {
+      collectEntries(**child, limit, entries);
     }
+  }
+  return entries;
+}
+
+std::vector<name::Component>
+Index::findLastChildren(const Name& prefix, size_t limit) const
+{
+  std::vector<name::Component> children;
+  const Node* node = findNode(prefix);
+  if (node == nullptr)
+    return children;
+
+  // every child holds an entry or has children, so each one is a child of stored data
+  size_t nChildren = std::min(limit, node->children.size());
+  children.reserve(nChildren);
+  for (auto child = node->children.end() - nChildren; child != node->children.end(); ++child) {
+    children.emplace_back(Block(reinterpret_cast<const uint8_t*>((*child)->component.data()),
+                                (*child)->component.size()));
+  }
+  return children;
+}
+
+std::vector<std::pair<int64_t, Name>>
+Index::findSegments(const Name& prefix, uint64_t first, uint64_t last, size_t limit) const
+{
+  std::vector<std::pair<int64_t, Name>> entries;
+  const Node* node = findNode(prefix);
+  if (node == nullptr)
+    return entries;
+
+  // each segment child holds at least one entry
+  for (const Node* segment : findSegmentChildren(*node, first, last, limit)) {
+    collectEntries(*segment, limit, entries);
+  }
+  return entries;
+}
+
+void
+Index::collectEntries(const Node& node, size_t limit,
+                      std::vector<std::pair<int64_t, Name>>& entries)
+{
+  if (entries.size() >= limit)
+    return;
+  if (node.hasEntry)
+    entries.emplace_back(node.id, getName(node));
+  for (const auto& child : node.children) {
+    collectEntries(*child, limit, entries);
+  }
 }
 
 bool
 Index::hasData(const Data& data) const
 {
-  Index::Entry entry(data, -1); // the id number is useless
-  IndexContainer::const_iterator result = m_indexContainer.find(entry);
-  return result != m_indexContainer.end();
+  return hasData(data.getFullName());
+}
+
+bool
+Index::hasData(const Name& fullName) const
+{
+  Digest digest;
+  if (getDigest(fullName, digest))
+    return findFullName(digest, fullName) != nullptr;
+
+  const Node* node = findNode(fullName);
+  return node != nullptr && node->hasEntry;
+}
+
+const Index::Node*
+Index::findFullName(const Digest& digest, const Name& fullName) const
+{
+  auto it = m_digestTable.find(digest);
+  if (it == m_digestTable.end() || !hasName(*it->second, fullName))
+    return nullptr;
+  return it->second;
+}
+
+bool
+Index::hasName(const Node& node, const Name& name)
+{
+  const Node* n = &node;
+  for (size_t i = name.size(); i > 0; --i, n = n->parent) {
+    if (n->parent == nullptr || compareComponent(n->component, name.get(i - 1).wireEncode()) != 0)
+      return false;
+  }
+  return n->parent == nullptr;
+}
+
+bool
+Index::getDigest(const Node& node, Digest& digest)
+{
+  // TLV-TYPE and TLV-LENGTH of an implicit digest component take one octet each
+  const std::string& component = node.component;
+  if (component.size() != 2 + digest.size() ||
+      static_cast<uint8_t>(component[0]) != ndn::tlv::ImplicitSha256DigestComponent ||
+      static_cast<uint8_t>(component[1]) != digest.size())
+    return false;
+
+  std::copy_n(component.begin() + 2, digest.size(), digest.begin());
+  return true;
+}
+
+bool
+Index::getDigest(const Name& name, Digest& digest)
+{
+  if (name.empty() || !name.get(-1).isImplicitSha256Digest())
+    return false;
+
+  const name::Component& component = name.get(-1);
+  BOOST_ASSERT(component.value_size() == digest.size());
+  std::copy_n(component.value(), digest.size(), digest.begin());
+  return true;
+}
 
+const Index::Node*
+Index::findNode(const Name& name) const
+{
+  const Node* node = &m_root;
+  for (const auto& component : name) {
+    const Block& wire = component.wireEncode();
+    auto child = findChild(node->children, wire);
+    if (child == node->children.end() || compareComponent((*child)->component, wire) != 0)
+      return nullptr;
+    node = child->get();
+  }
+  return node;
 }
 
 std::pair<int64_t,Name>
-Index::findFirstEntry(const Name& prefix,
-                      IndexContainer::const_iterator startingPoint) const
+Index::findFirstEntry(const Node& node) const
 {
-  BOOST_ASSERT(startingPoint != m_indexContainer.end());
-  if (prefix.isPrefixOf(startingPoint->getName()))
-    {
-      return std::make_pair(startingPoint->getId(), startingPoint->getName());
-    }
-  else
-    {
+  // a name sorts before the names it is a prefix of, so the first entry is found
+  // by following the first child until reaching a node with an entry
+  const Node* first = &node;
+  while (!first->hasEntry) {
+    if (first->children.empty())
       return std::make_pair(0, Name());
-    }
+    first = first->children.front().get();
+  }
+  return std::make_pair(first->id, getName(*first));
+}
+
+Name
+Index::getName(const Node& node)
+{
+  ndn::EncodingBuffer encoder;
+  size_t length = 0;
+  for (const Node* n = &node; n->parent != nullptr; n = n->parent) {
+    length += encoder.prependByteArray(reinterpret_cast<const uint8_t*>(n->component.data()),
+                                       n->component.size());
+  }
+  encoder.prependVarNumber(length);
+  encoder.prependVarNumber(ndn::tlv::Name);
+  return Name(encoder.block());
+}
+
+Name
+Index::findName(int64_t id) const
+{
+  BOOST_ASSERT(m_isFindNameEnabled);
+  auto it = m_nodeById.find(id);
+  if (it == m_nodeById.end())
+    return Name();
+  return getName(*it->second);
+}
+
+void
+Index::enableFindName(bool isEnabled)
+{
+  if (isEnabled == m_isFindNameEnabled)
+    return;
+  m_isFindNameEnabled = isEnabled;
+  // swapping with an empty table also frees its buckets
+  std::unordered_map<int64_t, Node*>().swap(m_nodeById);
+  if (isEnabled) {
+    m_nodeById.reserve(m_size);
+    forEachNode(m_root, [this] (const Node& node) {
+        if (node.hasEntry)
+          m_nodeById[node.id] = const_cast<Node*>(&node);
+      });
+  }
+}
+
+void
+Index::forgetEntry(const Node& node)
+{
+  Digest digest;
+  if (getDigest(node, digest))
+    m_digestTable.erase(digest);
+  if (!m_isFindNameEnabled)
+    return;
+  auto it = m_nodeById.find(node.id);
+  // ids are unique in the database, but the index does not rely on it
+  if (it != m_nodeById.end() && it->second == &node)
+    m_nodeById.erase(it);
 }
 
 bool
 Index::erase(const Name& fullName)
 {
-  Entry entry(fullName);
-  IndexContainer::const_iterator findIterator = m_indexContainer.find(entry);
-  if (findIterator != m_indexContainer.end())
-    {
-      m_indexContainer.erase(findIterator);
-      m_size--;
-      return true;
-    }
-  else
+  Digest digest;
+  bool hasDigest = getDigest(fullName, digest);
+  Node* node = const_cast<Node*>(hasDigest ? findFullName(digest, fullName) : findNode(fullName));
+  if (node == nullptr || !node->hasEntry)
     return false;
+
+  forgetEntry(*node);
+  node->hasEntry = false;
+  node->keyLocatorHash.reset();
+  m_size--;
+  prune(node);
+  return true;
+}
+
+size_t
+Index::eraseBatch(const std::vector<Name>& fullNames)
+{
+  // emptied nodes are removed deepest first, so that removing the empty children of
+  // a node never destroys a node still waiting in the queue
+  typedef std::pair<size_t, Node*> DepthNode;
+  std::set<DepthNode, std::greater<DepthNode>> parents;
+
+  size_t nErased = 0;
+  for (const Name& fullName : fullNames) {
+    Digest digest;
+    bool hasDigest = getDigest(fullName, digest);
+    Node* node = const_cast<Node*>(hasDigest ? findFullName(digest, fullName) : findNode(fullName));
+    if (node == nullptr || !node->hasEntry)
+      continue;
+
+    forgetEntry(*node);
+    node->hasEntry = false;
+    node->keyLocatorHash.reset();
+    ++nErased;
+    if (node->parent != nullptr && node->children.empty())
+      parents.emplace(fullName.size() - 1, node->parent);
+  }
+  m_size -= nErased;
+
+  // one sweep over the children of each parent
+  while (!parents.empty()) {
+    DepthNode parent = *parents.begin();
+    parents.erase(parents.begin());
+    NodeContainer& children = parent.second->children;
+    children.erase(std::remove_if(children.begin(), children.end(),
+                                  [] (const unique_ptr<Node>& child) {
+                                    return !child->hasEntry && child->children.empty();
+                                  }),
+                   children.end());
+    if (parent.second->parent != nullptr && !parent.second->hasEntry && children.empty())
+      parents.emplace(parent.first - 1, parent.second->parent);
+  }
+  return nErased;
+}
+
+size_t
+Index::erasePrefix(const Name& prefix)
+{
+  Node* node = const_cast<Node*>(findNode(prefix));
+  if (node == nullptr)
+    return 0;
+
+  size_t nErased = forgetSubtree(*node);
+  if (node == &m_root) {
+    clear();
+    return nErased;
+  }
+
+  // the whole subtree goes with one removal from the parent
+  Node* parent = node->parent;
+  parent->children.erase(findChild(parent->children, *node));
+  prune(parent);
+  return nErased;
+}
+
+size_t
+Index::eraseSegments(const Name& prefix, uint64_t first, uint64_t last)
+{
+  Node* node = const_cast<Node*>(findNode(prefix));
+  if (node == nullptr)
+    return 0;
+
+  std::vector<const Node*> segments = findSegmentChildren(*node, first, last,
+                                                         std::numeric_limits<size_t>::max());
+  if (segments.empty())
+    return 0;
+
+  size_t nErased = 0;
+  for (const Node* segment : segments) {
+    nErased += forgetSubtree(*segment);
+  }
+
+  // the segments are in child order, so they are removed in one sweep over the children
+  auto nextSegment = segments.begin();
+  auto end = std::remove_if(node->children.begin(), node->children.end(),
+                            [&] (const unique_ptr<Node>& child) {
+                              if (nextSegment == segments.end() || child.get() != *nextSegment)
+                                return false;
+                              ++nextSegment;
+                              return true;
+                            });
+  node->children.erase(end, node->children.end());
+  prune(node);
+  return nErased;
+}
+
+std::vector<const Index::Node*>
+Index::findSegmentChildren(const Node& node, uint64_t first, uint64_t last, size_t limit)
+{
+  std::vector<const Node*> segments;
+  if (first > last)
+    return segments;
+
+  // segment components of minimal length sort by number, so the range starts at the
+  // first segment and ends at the last one; other components in between are skipped,
+  // as are longer encodings of smaller numbers, which sort among them
+  name::Component firstSegment = name::Component::fromSegment(first);
+  name::Component lastSegment = name::Component::fromSegment(last);
+  for (auto child = findChild(node.children, firstSegment.wireEncode());
+       child != node.children.end() && segments.size() < limit &&
+         compareComponent((*child)->component, lastSegment.wireEncode()) <= 0;
+       ++child) {
+    name::Component component(Block(reinterpret_cast<const uint8_t*>((*child)->component.data()),
+                                    (*child)->component.size()));
+    if (!component.isSegment())
+      continue;
+    uint64_t segment = component.toSegment();
+    if (segment >= first && segment <= last)
+      segments.push_back(child->get());
+  }
+  return segments;
+}
+
+size_t
+Index::forgetSubtree(const Node& node)
+{
+  size_t nErased = 0;
+  forEachNode(node, [this, &nErased] (const Node& n) {
+      if (!n.hasEntry)
+        return;
+      forgetEntry(n);
+      ++nErased;
+    });
+  m_size -= nErased;
+  return nErased;
+}
+
+void
+Index::prune(Node* node)
+{
+  while (node->parent != nullptr && !node->hasEntry && node->children.empty()) {
+    Node* parent = node->parent;
+    parent->children.erase(findChild(parent->children, *node));
+    node = parent;
+  }
+}
+
+void
+Index::clear()
+{
+  m_root.children.clear();
+  m_root.hasEntry = false;
+  m_root.keyLocatorHash.reset();
+  m_digestTable.clear();
+  m_nodeById.clear();
+  m_size = 0;
+}
+
+void
+Index::forEachNode(const Node& node, const std::function<void(const Node&)>& f)
+{
+  f(node);
+  for (const auto& child : node.children) {
+    forEachNode(*child, f);
+  }
+}
+
+void
+Index::forEachEntry(const std::function<void(int64_t, const Name&)>& f) const
+{
+  forEachNode(m_root, [&f] (const Node& node) {
+      if (node.hasEntry)
+        f(node.id, getName(node));
+    });
+}
+
+/** @brief snapshot layout, all integers in native byte order:
+ *
+ *  uint32 magic, uint32 version, int64 high water mark, int64 number of entries deleted
+ *  from the database, uint64 number of entries, uint32 number of keyLocator hashes, then each hash as uint32 size and bytes,
+ *  then the root node.
+ *
+ *  A node is uint8 flags, the entry as int64 id and uint32 keyLocator hash number
+ *  if flags has SNAPSHOT_NODE_HAS_ENTRY, and uint32 number of children.  Each child
+ *  follows as uint32 size and bytes of its component TLV, then the child node.
+ */
+static const uint32_t SNAPSHOT_MAGIC = 0x58444952; // "RIDX" on little-endian hosts
+static const uint32_t SNAPSHOT_VERSION = 2;
+static const uint8_t SNAPSHOT_NODE_HAS_ENTRY = 0x01;
+static const uint32_t SNAPSHOT_NO_KEY_LOCATOR_HASH = std::numeric_limits<uint32_t>::max();
+
+template<typename T>
+static void
+writeValue(std::ostream& os, const T& value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void
+Index::writeSnapshot(std::ostream& os, int64_t highWaterMark, int64_t nDeleted) const
+{
+  // most entries share a few signing keys, so each distinct hash is stored once
+  std::map<std::string, uint32_t> keyLocatorHashIds;
+  std::vector<std::string> keyLocatorHashes;
+  forEachNode(m_root, [&] (const Node& node) {
+      if (!node.hasEntry || node.keyLocatorHash == nullptr)
+        return;
+      std::string hash(node.keyLocatorHash->begin(), node.keyLocatorHash->end());
+      if (keyLocatorHashIds.emplace(hash, keyLocatorHashes.size()).second)
+        keyLocatorHashes.push_back(hash);
+    });
+
+  writeValue(os, SNAPSHOT_MAGIC);
+  writeValue(os, SNAPSHOT_VERSION);
+  writeValue(os, highWaterMark);
+  writeValue(os, nDeleted);
+  writeValue(os, static_cast<uint64_t>(m_size));
+  writeValue(os, static_cast<uint32_t>(keyLocatorHashes.size()));
+  for (const std::string& hash : keyLocatorHashes) {
+    writeValue(os, static_cast<uint32_t>(hash.size()));
+    os.write(hash.data(), hash.size());
+  }
+  writeNode(os, m_root, keyLocatorHashIds);
+}
+
+void
+Index::writeNode(std::ostream& os, const Node& node,
+                 const std::map<std::string, uint32_t>& keyLocatorHashIds) const
+{
+  writeValue(os, node.hasEntry ? SNAPSHOT_NODE_HAS_ENTRY : uint8_t(0));
+  if (node.hasEntry) {
+    uint32_t hashId = SNAPSHOT_NO_KEY_LOCATOR_HASH;
+    if (node.keyLocatorHash != nullptr) {
+      hashId = keyLocatorHashIds.at(std::string(node.keyLocatorHash->begin(),
+                                                node.keyLocatorHash->end()));
+    }
+    writeValue(os, node.id);
+    writeValue(os, hashId);
+  }
+
+  writeValue(os, static_cast<uint32_t>(node.children.size()));
+  for (const auto& child : node.children) {
+    writeValue(os, static_cast<uint32_t>(child->component.size()));
+    os.write(child->component.data(), child->component.size());
+    writeNode(os, *child, keyLocatorHashIds);
+  }
+}
+
+class Index::SnapshotReader
+{
+public:
+  SnapshotReader(const uint8_t* buffer, size_t size)
+    : m_position(buffer)
+    , m_end(buffer + size)
+  {
+  }
+
+  template<typename T>
+  T
+  read()
+  {
+    T value;
+    std::memcpy(&value, readBytes(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  const uint8_t*
+  readBytes(size_t size)
+  {
+    if (static_cast<size_t>(m_end - m_position) < size)
+      BOOST_THROW_EXCEPTION(Error("Index snapshot is truncated"));
+    const uint8_t* bytes = m_position;
+    m_position += size;
+    return bytes;
+  }
+
+  bool
+  isAtEnd() const
+  {
+    return m_position == m_end;
+  }
+
+private:
+  const uint8_t* m_position;
+  const uint8_t* m_end;
+};
+
+int64_t
+Index::readSnapshot(const uint8_t* buffer, size_t size, int64_t& nDeleted)
+{
+  clear();
+  try {
+    SnapshotReader reader(buffer, size);
+    if (reader.read<uint32_t>() != SNAPSHOT_MAGIC || reader.read<uint32_t>() != SNAPSHOT_VERSION)
+      BOOST_THROW_EXCEPTION(Error("Not an index snapshot of this version and byte order"));
+    int64_t highWaterMark = reader.read<int64_t>();
+    nDeleted = reader.read<int64_t>();
+    uint64_t nEntries = reader.read<uint64_t>();
+    if (nEntries > m_maxPackets)
+      BOOST_THROW_EXCEPTION(Error("The Index is Full. Cannot Insert Any Data!"));
+
+    uint32_t nKeyLocatorHashes = reader.read<uint32_t>();
+    std::vector<ndn::ConstBufferPtr> keyLocatorHashes;
+    for (uint32_t i = 0; i < nKeyLocatorHashes; ++i) {
+      uint32_t hashSize = reader.read<uint32_t>();
+      const uint8_t* hash = reader.readBytes(hashSize);
+      keyLocatorHashes.push_back(make_shared<ndn::Buffer>(hash, hashSize));
+    }
+
+    readNode(reader, m_root, keyLocatorHashes);
+    if (!reader.isAtEnd() || m_size != nEntries)
+      BOOST_THROW_EXCEPTION(Error("Index snapshot does not match its header"));
+    return highWaterMark;
+  }
+  catch (const Error&) {
+    clear();
+    throw;
+  }
+}
+
+void
+Index::readNode(SnapshotReader& reader, Node& node,
+                const std::vector<ndn::ConstBufferPtr>& keyLocatorHashes)
+{
+  uint8_t flags = reader.read<uint8_t>();
+  if (flags & SNAPSHOT_NODE_HAS_ENTRY) {
+    if (isFull())
+      BOOST_THROW_EXCEPTION(Error("The Index is Full. Cannot Insert Any Data!"));
+    node.hasEntry = true;
+    node.id = reader.read<int64_t>();
+    uint32_t hashId = reader.read<uint32_t>();
+    if (hashId != SNAPSHOT_NO_KEY_LOCATOR_HASH) {
+      if (hashId >= keyLocatorHashes.size())
+        BOOST_THROW_EXCEPTION(Error("Index snapshot refers to an unknown keyLocator hash"));
+      node.keyLocatorHash = keyLocatorHashes[hashId];
+    }
+    ++m_size;
+
+    Digest digest;
+    if (getDigest(node, digest))
+      m_digestTable[digest] = &node;
+    if (m_isFindNameEnabled)
+      m_nodeById[node.id] = &node;
+  }
+
+  uint32_t nChildren = reader.read<uint32_t>();
+  if (node.parent != nullptr && !node.hasEntry && nChildren == 0)
+    BOOST_THROW_EXCEPTION(Error("Index snapshot has a node without entries"));
+
+  node.children.reserve(nChildren);
+  for (uint32_t i = 0; i < nChildren; ++i) {
+    uint32_t componentSize = reader.read<uint32_t>();
+    const uint8_t* component = reader.readBytes(componentSize);
+    auto child = ndn::make_unique<Node>(component, componentSize, &node);
+    if (!node.children.empty() && !(node.children.back()->component < child->component))
+      BOOST_THROW_EXCEPTION(Error("Index snapshot children are out of order"));
+    readNode(reader, *child, keyLocatorHashes);
+    node.children.push_back(std::move(child));
+  }
 }
 
 const ndn::ConstBufferPtr
@@ -156,10 +956,9 @@ Index::Entry::Entry(const Name& fullName, const KeyLocator& keyLocator, int64_t
 {
 }
 
-Index::Entry::Entry(const Name& fullName,
-                    const ndn::ConstBufferPtr& keyLocatorHash, int64_t id)
-  : m_name(fullName)
-  , m_keyLocatorHash(keyLocatorHash)
+Index::Entry::Entry(Name fullName, ndn::ConstBufferPtr keyLocatorHash, int64_t id)
+  : m_name(std::move(fullName))
+  , m_keyLocatorHash(std::move(keyLocatorHash))
   , m_id(id)
 {
 }
@@ -21,10 +21,24 @@
 #define REPO_STORAGE_INDEX_HPP
 
 #include "common.hpp"
-#include <set>
+
+#include <array>
+#include <limits>
+#include <unordered_map>
 
 namespace repo {
 
+/**
+ * @brief Index maps the full names of stored Data to their database record IDs
+ *
+ * Entries are kept in a name tree with one node per name component, so that names
+ * sharing a prefix share the nodes of that prefix.  The children of each node are
+ * kept in canonical component order, which orders the entries like a set of Names.
+ *
+ * Full names ending with an implicit SHA-256 digest, which is how every entry is
+ * inserted by RepoStorage, are also kept in a hash table keyed by the digest.  Exact
+ * lookups of such names are answered from the table; the tree serves prefix lookups.
+ */
 class Index : noncopyable
 {
 public:
@@ -54,7 +68,7 @@ public:
   public:
 
     /**
-     * @brief used by set to construct node
+     * @brief construct an empty Entry
      */
     Entry()
     {
@@ -76,7 +90,7 @@ public:
      * @param  keyLocatorHash  keyLocator hashed by sha256
      * @param  id              record ID from database
      */
-    Entry(const Name& fullName, const ndn::ConstBufferPtr& keyLocatorHash, int64_t id);
+    Entry(Name fullName, ndn::ConstBufferPtr keyLocatorHash, int64_t id);
 
     /**
      *  @brief implicit construct Entry by full name
@@ -143,8 +157,52 @@ public:
   };
 
 private:
+  /**
+   * @brief a node of the name tree
+   *
+   * The node holds an entry when the name from the root down to the node is the
+   * full name of stored Data.  Every node other than the root holds an entry or has
+   * children; nodes that lose both are pruned.
+   */
+  class Node : noncopyable
+  {
+  public:
+    /**
+     * @brief construct the root node
+     */
+    Node();
+
+    Node(const uint8_t* wire, size_t wireSize, Node* parent);
+
+  public:
+    std::string component; ///< TLV encoding of the name component, empty at the root
+    Node* parent;
+    std::vector<unique_ptr<Node>> children; ///< in canonical order of their components
+    bool hasEntry;
+    int64_t id;
+    ndn::ConstBufferPtr keyLocatorHash;
+  };
+
+  typedef std::vector<unique_ptr<Node>> NodeContainer;
+
+  typedef std::array<uint8_t, 32> Digest;
+
+  /**
+   * @brief hash of an implicit digest, which is uniformly distributed already
+   */
+  class DigestHash
+  {
+  public:
+    size_t
+    operator()(const Digest& digest) const
+    {
+      size_t hash;
+      std::copy_n(digest.begin(), sizeof(hash), reinterpret_cast<uint8_t*>(&hash));
+      return hash;
+    }
+  };
 
-  typedef std::set<Entry> IndexContainer;
+  typedef std::unordered_map<Digest, Node*, DigestHash> DigestTable;
 
 public:
   explicit
@@ -167,12 +225,52 @@ public:
   insert(const Name& fullName, int64_t id,
          const ndn::ConstBufferPtr& keyLocatorHash);
 
+  /**
+   *  @brief insert a batch of entries into index
+   *  @param  entries  entries carrying the id obtained from database
+   *  @return whether each entry was inserted, in the order of @p entries
+   *
+   *  The entries are inserted in name order, so that each insertion starts
+   *  next to the previous one.
+   */
+  std::vector<bool>
+  insertBatch(const std::vector<Entry>& entries);
+
+  /**
+   *  @brief insert a batch of entries that is already in name order
+   *  @return whether each entry was inserted, in the order of @p entries
+   */
+  std::vector<bool>
+  insertSorted(const std::vector<Entry>& entries);
+
   /**
    *  @brief erase the entry in index by its fullname
    */
   bool
   erase(const Name& fullName);
 
+  /**
+   *  @brief erase all entries under @p prefix at once
+   *  @return the number of erased entries
+   */
+  size_t
+  erasePrefix(const Name& prefix);
+
+  /**
+   *  @brief erase the entries of @p fullNames, pruning the emptied nodes in one sweep
+   *         per parent
+   *  @return the number of erased entries; names not in the index are skipped
+   */
+  size_t
+  eraseBatch(const std::vector<Name>& fullNames);
+
+  /**
+   *  @brief erase all entries under @p prefix/seg=@p first through @p prefix/seg=@p last
+   *  @return the number of erased entries
+   */
+  size_t
+  eraseSegments(const Name& prefix, uint64_t first, uint64_t last);
+
   /** @brief find the Entry for best match of an Interest
    * @return ID and fullName of the Entry, or (0,ignored) if not found
    */
@@ -186,6 +284,60 @@ public:
   std::pair<int64_t, Name>
   find(const Name& name) const;
 
+  /** @brief find all Entries under a Name prefix, in name order
+   * @param limit  maximum number of Entries to return
+   * @return ID and fullName of each Entry
+   */
+  std::vector<std::pair<int64_t, Name>>
+  findAll(const Name& prefix,
+          size_t limit = std::numeric_limits<size_t>::max()) const;
+
+  /** @brief find the Entries under a Name prefix that sort after @p after, in name order
+   * @param after  a name under @p prefix, which need not be stored; an empty Name
+   *               starts from the first Entry
+   * @param limit  maximum number of Entries to return
+   * @return ID and fullName of each Entry
+   *
+   *  Passing the last fullName returned walks the whole subtree in steps of @p limit
+   *  Entries, each step costing only its own Entries plus the depth of the names.
+   */
+  std::vector<std::pair<int64_t, Name>>
+  findAllAfter(const Name& prefix, const Name& after, size_t limit) const;
+
+  /** @brief find the last children of the node of @p prefix, in name order
+   * @param limit  maximum number of children to return
+   * @return the name components of the children
+   *
+   *  Only the children are visited, not the Entries under them.
+   */
+  std::vector<name::Component>
+  findLastChildren(const Name& prefix, size_t limit) const;
+
+  /** @brief find the full name of the Entry with ID @p id
+   * @return the full name, or an empty Name if there is no such Entry
+   * @pre enableFindName(true)
+   */
+  Name
+  findName(int64_t id) const;
+
+  /** @brief keep a table from ID to Entry for findName() while @p isEnabled
+   *
+   *  The table costs a hash table node per Entry, so it is only kept while an eviction
+   *  policy needs it.  Enabling it fills it from the Entries already in the index.
+   */
+  void
+  enableFindName(bool isEnabled);
+
+  /** @brief find all Entries under @p prefix/seg=@p first through @p prefix/seg=@p last,
+   *         in name order
+   * @param last   std::numeric_limits<uint64_t>::max() leaves the range open-ended
+   * @param limit  maximum number of Entries to return
+   * @return ID and fullName of each Entry
+   */
+  std::vector<std::pair<int64_t, Name>>
+  findSegments(const Name& prefix, uint64_t first, uint64_t last,
+               size_t limit = std::numeric_limits<size_t>::max()) const;
+
   /**
    *  @brief determine whether same Data is already in the index
    *  @return true if identical Data exists, false otherwise
@@ -193,6 +345,46 @@ public:
   bool
   hasData(const Data& data) const;
 
+  /**
+   *  @brief determine whether Data with the given full name is already in the index
+   */
+  bool
+  hasData(const Name& fullName) const;
+
+  /**
+   *  @brief write the index as a snapshot
+   *  @param  highWaterMark  largest database id covered by the index, returned by readSnapshot()
+   *  @param  nDeleted       number of entries ever deleted from the database, also returned
+   *                         by readSnapshot()
+   *
+   *  The snapshot stores the name tree node by node in native byte order, so that it can
+   *  be read straight from a memory-mapped file.
+   */
+  void
+  writeSnapshot(std::ostream& os, int64_t highWaterMark, int64_t nDeleted) const;
+
+  /**
+   *  @brief replace the entries of the index with those of a snapshot
+   *  @param[out] nDeleted  the number of deleted entries given to writeSnapshot()
+   *  @return the high water mark given to writeSnapshot()
+   *  @throw  Error the snapshot is malformed or holds more entries than the index can;
+   *          the index is left empty
+   */
+  int64_t
+  readSnapshot(const uint8_t* buffer, size_t size, int64_t& nDeleted);
+
+  /**
+   *  @brief remove all entries
+   */
+  void
+  clear();
+
+  /**
+   *  @brief call @p f with the id and full name of each entry, in name order
+   */
+  void
+  forEachEntry(const std::function<void(int64_t, const Name&)>& f) const;
+
   /**
     *  @brief compute the hash value of keyLocator
     */
@@ -205,11 +397,50 @@ public:
     return m_size;
   }
 
+  size_t
+  getMaxPackets() const
+  {
+    return m_maxPackets;
+  }
+
 private:
 
+  /**
+   *  @brief find the entry under @p prefixNode that best satisfies the selectors of @p interest
+   *  @param  prefixNode  the node of the Interest name
+   *  @return ID and fullName of the Entry, or (0,ignored) if not found
+   *
+   *  With ChildSelector=1 the children of @p prefixNode are searched from the rightmost
+   *  one, and the leftmost matching entry of the first child holding one is selected.
+   *  Otherwise the leftmost matching entry is selected.  PublisherPublicKeyLocator is
+   *  matched against the keyLocator hash stored in the entries, so no Data is read.
+   */
   std::pair<int64_t, Name>
-  selectChild(const Interest& interest,
-              IndexContainer::const_iterator startingPoint) const;
+  selectChild(const Interest& interest, const Node& prefixNode) const;
+
+  /**
+   *  @brief find the leftmost entry in the subtree of @p node that satisfies the selectors
+   *  @param  depth           number of components from the Interest name down to @p node
+   *  @param  keyLocatorHash  hash of PublisherPublicKeyLocator if the Interest has one,
+   *                          otherwise ignored
+   */
+  static const Node*
+  findLeftmostMatch(const Interest& interest, const ndn::ConstBufferPtr& keyLocatorHash,
+                    const Node& node, size_t depth);
+
+  /**
+   *  @brief determine whether the entry of @p node satisfies the selectors of @p interest,
+   *         other than ChildSelector and Exclude
+   */
+  static bool
+  matchesSimpleSelectors(const Interest& interest, const ndn::ConstBufferPtr& keyLocatorHash,
+                         const Node& node, size_t depth);
+
+  /**
+   *  @brief determine whether a child of the Interest name is excluded by its Exclude selector
+   */
+  static bool
+  isExcluded(const Interest& interest, const Node& child);
 
 
   /**
@@ -223,18 +454,150 @@ private:
   }
 
   /**
-   *  @brief find the first entry with the prefix
-   *  @param  prefix        used to request the entries
-   *  @param  startingPoint the entry whose name is equal or larger than the interest name
+   *  @brief find the children of @p node that are segments @p first through @p last
+   *  @param limit  maximum number of children to return
+   */
+  static std::vector<const Node*>
+  findSegmentChildren(const Node& node, uint64_t first, uint64_t last, size_t limit);
+
+  /**
+   *  @brief append the entries in the subtree of @p node to @p entries, in name order,
+   *         until @p entries holds @p limit of them
+   */
+  static void
+  collectEntries(const Node& node, size_t limit,
+                 std::vector<std::pair<int64_t, Name>>& entries);
+
+  /**
+   *  @brief drop the entries in the subtree of @p node from the digest table and the size
+   *  @return the number of entries in the subtree
+   *
+   *  The caller detaches the subtree from the tree.
+   */
+  size_t
+  forgetSubtree(const Node& node);
+
+  /**
+   *  @brief find the first child whose component is not less than @p wire
+   */
+  static NodeContainer::const_iterator
+  findChild(const NodeContainer& children, const Block& wire);
+
+  /**
+   *  @brief find @p child among the children of its parent, by binary search
+   */
+  static NodeContainer::iterator
+  findChild(NodeContainer& children, const Node& child);
+
+  /**
+   *  @brief insert @p entries in the given order, sharing the walk down common prefixes
+   *         between consecutive entries
+   */
+  std::vector<bool>
+  insertInOrder(const std::vector<Entry>& entries, const std::vector<size_t>& order);
+
+  bool
+  insertEntry(const Name& fullName, int64_t id, const ndn::ConstBufferPtr& keyLocatorHash);
+
+  /**
+   *  @brief find the child of @p node with component @p wire, creating it if needed
+   */
+  Node&
+  findOrCreateChild(Node& node, const Block& wire);
+
+  /**
+   *  @brief make @p node hold the entry of @p fullName
+   *  @return false if @p node already holds an entry
+   */
+  bool
+  setEntry(Node& node, const Name& fullName, int64_t id,
+           const ndn::ConstBufferPtr& keyLocatorHash);
+
+  /**
+   *  @brief find the node of a name
+   *  @return the node, or nullptr if no entry has @p name as its name or a prefix of it
+   */
+  const Node*
+  findNode(const Name& name) const;
+
+  /**
+   *  @brief find the entry of a full name through the digest table
+   *  @param  digest    the implicit digest @p fullName ends with
+   *  @return the node holding the entry, or nullptr if there is no such entry
+   */
+  const Node*
+  findFullName(const Digest& digest, const Name& fullName) const;
+
+  /**
+   *  @brief check whether the name from the root down to @p node is @p name
+   */
+  static bool
+  hasName(const Node& node, const Name& name);
+
+  /**
+   *  @brief get the implicit digest that @p name ends with
+   *  @return false if the last component of @p name is not an implicit digest
+   */
+  static bool
+  getDigest(const Name& name, Digest& digest);
+
+  /**
+   *  @brief get the implicit digest that is the component of @p node
+   *  @return false if the component of @p node is not an implicit digest
+   */
+  static bool
+  getDigest(const Node& node, Digest& digest);
+
+  /**
+   *  @brief find the first entry in the subtree of a node
    *  @return int64_t  the id number of found entry
    *  @return Name     the name of found entry
    */
   std::pair<int64_t, Name>
-  findFirstEntry(const Name& prefix,
-                 IndexContainer::const_iterator startingPoint) const;
+  findFirstEntry(const Node& node) const;
+
+  /**
+   *  @brief rebuild the name from the root down to a node
+   */
+  static Name
+  getName(const Node& node);
+
+  /**
+   *  @brief drop the entry of @p node from the digest table and, if kept, the ID table
+   */
+  void
+  forgetEntry(const Node& node);
+
+  /**
+   *  @brief remove @p node and its ancestors as long as they hold no entry and have no children
+   */
+  void
+  prune(Node* node);
+
+  void
+  writeNode(std::ostream& os, const Node& node,
+            const std::map<std::string, uint32_t>& keyLocatorHashIds) const;
+
+  class SnapshotReader;
+
+  /**
+   *  @brief read the entry and the children of @p node from a snapshot
+   */
+  void
+  readNode(SnapshotReader& reader, Node& node,
+           const std::vector<ndn::ConstBufferPtr>& keyLocatorHashes);
+
+  /**
+   *  @brief call @p f on @p node and its descendants, in name order
+   */
+  static void
+  forEachNode(const Node& node, const std::function<void(const Node&)>& f);
 
 private:
-  IndexContainer m_indexContainer;
+  Node m_root;
+  DigestTable m_digestTable;
+  std::unordered_map<int64_t, Node*> m_nodeById; ///< only kept while findName() is enabled
+  bool m_isFindNameEnabled;
   size_t m_maxPackets;
   size_t m_size;
 };
@@ -20,10 +20,16 @@
 #include "repo-storage.hpp"
 #include "config.hpp"
 
+#include <fstream>
 #include <istream>
+#include <set>
+#include <thread>
 
 #include <ndn-cxx/util/logger.hpp>
 
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
 namespace repo {
 
 NDN_LOG_INIT(repo.RepoStorage);
@@ -31,14 +37,205 @@ NDN_LOG_INIT(repo.RepoStorage);
 RepoStorage::RepoStorage(const int64_t& nMaxPackets, Storage& store)
   : m_index(nMaxPackets)
   , m_storage(store)
+  , m_nRebuildThreads(1)
+  , m_evictionBatchSize(1)
+  , m_scheduler(nullptr)
+  , m_maxGroupSize(1)
+  , m_groupCommitWindow(0)
+  , m_isGroupOpen(false)
+{
+}
+
+RepoStorage::~RepoStorage()
+{
+  try {
+    flush();
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_ERROR("Failed to commit pending inserts: " << e.what());
+  }
+}
+
+void
+RepoStorage::enableGroupCommit(Scheduler& scheduler, size_t maxGroupSize,
+                               const ndn::time::milliseconds& window)
+{
+  flush();
+  m_scheduler = &scheduler;
+  m_maxGroupSize = std::max<size_t>(maxGroupSize, 1);
+  m_groupCommitWindow = window;
+}
+
+void
+RepoStorage::setCacheCapacity(size_t nBytes)
 {
+  m_cache.setCapacity(nBytes);
+}
+
+void
+RepoStorage::setEvictionPolicy(unique_ptr<EvictionPolicy> policy, size_t batchSize)
+{
+  m_evictionPolicy = std::move(policy);
+  m_evictionBatchSize = std::max<size_t>(batchSize, 1);
+  // the policy names its victims by id
+  m_index.enableFindName(m_evictionPolicy != nullptr);
+  if (m_evictionPolicy != nullptr) {
+    m_index.forEachEntry([this] (int64_t id, const Name& fullName) {
+        m_evictionPolicy->afterInsert(id, fullName);
+      });
+  }
+}
+
+void
+RepoStorage::flush()
+{
+  if (!m_isGroupOpen)
+    return;
+
+  m_scheduler->cancelEvent(m_groupCommitEvent);
+  m_isGroupOpen = false;
+  m_storage.commitTransaction();
+
+  NDN_LOG_DEBUG("Committed group of " << m_pendingInsertions.size() << " inserts");
+  std::vector<Name> committed;
+  committed.swap(m_pendingInsertions);
+  for (const Name& name : committed) {
+    afterDataInsertion(name);
+  }
+}
+
+void
+RepoStorage::setSnapshotPath(const std::string& path)
+{
+  m_snapshotPath = path;
+}
+
+void
+RepoStorage::setRebuildThreads(size_t nThreads)
+{
+  if (nThreads == 0)
+    nThreads = std::thread::hardware_concurrency();
+  m_nRebuildThreads = std::max<size_t>(nThreads, 1);
+}
+
+void
+RepoStorage::saveSnapshot()
+{
+  if (m_snapshotPath.empty())
+    return;
+
+  flush();
+  int64_t highWaterMark = m_storage.getMaxId();
+  int64_t nDeleted = m_storage.getNDeleted();
+
+  // write to a temporary file first, so that a crash never leaves a truncated snapshot
+  std::string tmpPath = m_snapshotPath + ".tmp";
+  {
+    std::ofstream os(tmpPath, std::ios::binary | std::ios::trunc);
+    m_index.writeSnapshot(os, highWaterMark, nDeleted);
+    os.close();
+    if (!os)
+      BOOST_THROW_EXCEPTION(Error("Failed to write index snapshot '" + tmpPath + "'"));
+  }
+  boost::filesystem::rename(tmpPath, m_snapshotPath);
+  NDN_LOG_INFO("Saved index snapshot of " << m_index.size() << " entries up to id " << highWaterMark);
 }
 
 void
 RepoStorage::initialize()
 {
   NDN_LOG_DEBUG("Initialize");
-  m_storage.fullEnumerate(bind(&RepoStorage::insertItemToIndex, this, _1));
+  int64_t highWaterMark = loadSnapshot();
+  if (highWaterMark < 0) {
+    if (m_nRebuildThreads > 1)
+      rebuildIndex();
+    else
+      m_storage.fullEnumerate(bind(&RepoStorage::insertItemToIndex, this, _1));
+    return;
+  }
+
+  // the entries in the snapshot are announced like the ones read from the database
+  m_index.forEachEntry([this] (int64_t id, const Name& fullName) {
+      if (m_evictionPolicy != nullptr)
+        m_evictionPolicy->afterInsert(id, fullName);
+      afterDataInsertion(fullName);
+    });
+  m_storage.enumerateAfter(highWaterMark, bind(&RepoStorage::insertItemToIndex, this, _1));
+}
+
+void
+RepoStorage::rebuildIndex()
+{
+  std::vector<std::vector<Storage::ItemMeta>> runs = m_storage.readSortedRuns(m_nRebuildThreads);
+
+  // merge the runs, so that the index is filled in name order
+  typedef std::pair<size_t, size_t> Cursor; // run, position in the run
+  auto isAfter = [&runs] (const Cursor& a, const Cursor& b) {
+    return runs[b.first][b.second].fullName < runs[a.first][a.second].fullName;
+  };
+  std::priority_queue<Cursor, std::vector<Cursor>, decltype(isAfter)> heads(isAfter);
+  size_t nItems = 0;
+  for (size_t i = 0; i < runs.size(); ++i) {
+    nItems += runs[i].size();
+    if (!runs[i].empty())
+      heads.push(Cursor(i, 0));
+  }
+
+  // the metadata is moved into the entries and each run is freed once merged,
+  // so that names and hashes are not held twice
+  std::vector<Index::Entry> entries;
+  entries.reserve(nItems);
+  while (!heads.empty()) {
+    Cursor head = heads.top();
+    heads.pop();
+    Storage::ItemMeta& item = runs[head.first][head.second];
+    entries.emplace_back(std::move(item.fullName), std::move(item.keyLocatorHash), item.id);
+    if (++head.second < runs[head.first].size())
+      heads.push(head);
+    else
+      std::vector<Storage::ItemMeta>().swap(runs[head.first]);
+  }
+
+  std::vector<bool> isInserted = m_index.insertSorted(entries);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (!isInserted[i])
+      continue;
+    if (m_evictionPolicy != nullptr)
+      m_evictionPolicy->afterInsert(entries[i].getId(), entries[i].getName());
+    afterDataInsertion(entries[i].getName());
+  }
+  NDN_LOG_DEBUG("Rebuilt index of " << m_index.size() << " entries on "
+                << m_nRebuildThreads << " threads");
+}
+
+int64_t
+RepoStorage::loadSnapshot()
+{
+  if (m_snapshotPath.empty() || !boost::filesystem::exists(m_snapshotPath))
+    return -1;
+
+  int64_t highWaterMark = -1;
+  int64_t nDeleted = 0;
+  try {
+    boost::iostreams::mapped_file_source file(m_snapshotPath);
+    highWaterMark = m_index.readSnapshot(reinterpret_cast<const uint8_t*>(file.data()),
+                                         file.size(), nDeleted);
+  }
+  catch (const std::exception& e) {
+    NDN_LOG_WARN("Cannot load index snapshot '" << m_snapshotPath << "': " << e.what());
+    return -1;
+  }
+
+  // ids are never reused, so the database still holds exactly the entries of the
+  // snapshot up to its high water mark unless something was deleted since
+  if (m_storage.getNDeleted() != nDeleted) {
+    NDN_LOG_WARN("Index snapshot '" << m_snapshotPath << "' is out of date");
+    m_index.clear();
+    return -1;
+  }
+
+  NDN_LOG_INFO("Loaded index snapshot of " << m_index.size() << " entries up to id " << highWaterMark);
+  return highWaterMark;
 }
 
 void
@@ -46,6 +243,8 @@ RepoStorage::insertItemToIndex(const Storage::ItemMeta& item)
 {
   NDN_LOG_DEBUG("Insert data to index " << item.fullName);
   m_index.insert(item.fullName, item.id, item.keyLocatorHash);
+  if (m_evictionPolicy != nullptr)
+    m_evictionPolicy->afterInsert(item.id, item.fullName);
   afterDataInsertion(item.fullName);
 }
 
@@ -56,39 +255,280 @@ RepoStorage::insertData(const Data& data)
    std::cout<<"data to be inserted: "<<data.getName()<<std::endl;
    if (isExist)
      BOOST_THROW_EXCEPTION(Error("The Entry Has Already In the Skiplist. Cannot be Inserted!"));
+
+   makeRoom(1);
+   // checked before writing to storage, which would otherwise keep a row the index lacks
+   if (m_index.size() >= m_index.getMaxPackets())
+     BOOST_THROW_EXCEPTION(Error("The Index is Full. Cannot Insert Any Data!"));
+   openGroup();
    int64_t id = m_storage.insert(data);
    if (id == -1)
      return false;
+   m_cache.erase(id);
    bool didInsert = m_index.insert(data, id);
-   if (didInsert)
-     afterDataInsertion(data.getName());
+   if (didInsert) {
+     if (m_evictionPolicy != nullptr)
+       m_evictionPolicy->afterInsert(id, data.getFullName());
+     notifyInsertion(data.getName());
+   }
+   if (m_isGroupOpen && m_pendingInsertions.size() >= m_maxGroupSize)
+     flush();
    return didInsert;
 }
 
-ssize_t
-RepoStorage::deleteData(const Name& name)
+Storage::ItemMeta
+RepoStorage::prepareInsert(const Data& data)
 {
-  bool hasError = false;
-  std::pair<int64_t,ndn::Name> idName = m_index.find(name);
-  if (idName.first == 0)
-    return false;
-  int64_t count = 0;
-  while (idName.first != 0) {
-    bool resultDb = m_storage.erase(idName.first);
-    bool resultIndex = m_index.erase(idName.second); //full name
-    if (resultDb && resultIndex) {
-      afterDataDeletion(idName.second);
-      count++;
-    }
-    else {
-      hasError = true;
+  Storage::ItemMeta meta;
+  meta.id = 0;
+  meta.fullName = data.getFullName();
+  const ndn::Signature& signature = data.getSignature();
+  if (signature.hasKeyLocator())
+    meta.keyLocatorHash = Index::computeKeyLocatorHash(signature.getKeyLocator());
+  return meta;
+}
+
+std::vector<bool>
+RepoStorage::insertBatch(const std::vector<shared_ptr<const Data>>& data)
+{
+  std::vector<Storage::ItemMeta> metas;
+  metas.reserve(data.size());
+  for (const auto& item : data) {
+    metas.push_back(prepareInsert(*item));
+  }
+  return insertBatch(data, metas);
+}
+
+std::vector<bool>
+RepoStorage::insertBatch(const std::vector<shared_ptr<const Data>>& data,
+                         const std::vector<Storage::ItemMeta>& metas)
+{
+  BOOST_ASSERT(data.size() == metas.size());
+  std::vector<bool> results(data.size(), false);
+
+  // one pass over the index for the whole batch
+  std::vector<shared_ptr<const Data>> newData;
+  std::vector<Storage::ItemMeta> newMetas;
+  std::vector<size_t> positions;
+  std::set<Name> batchNames;
+  for (size_t i = 0; i < data.size(); ++i) {
+    const Name& fullName = metas[i].fullName;
+    if (m_index.hasData(fullName) || !batchNames.insert(fullName).second)
+      continue;
+    newData.push_back(data[i]);
+    newMetas.push_back(metas[i]);
+    positions.push_back(i);
+  }
+  if (newData.empty())
+    return results;
+
+  makeRoom(newData.size());
+  // the index must take every row written to storage, so what does not fit is dropped first
+  size_t nRoom = m_index.getMaxPackets() - std::min(m_index.size(), m_index.getMaxPackets());
+  if (newData.size() > nRoom) {
+    NDN_LOG_WARN("Repo is full, " << newData.size() - nRoom << " data of the batch not inserted");
+    newData.resize(nRoom);
+    newMetas.resize(nRoom);
+    positions.resize(nRoom);
+    if (newData.empty())
+      return results;
+  }
+  openGroup();
+  std::vector<int64_t> ids = m_storage.insertBatch(newData, newMetas);
+
+  std::vector<Index::Entry> entries;
+  std::vector<size_t> entryPositions;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (ids[i] == -1)
+      continue;
+    m_cache.erase(ids[i]);
+    entries.emplace_back(newMetas[i].fullName, newMetas[i].keyLocatorHash, ids[i]);
+    entryPositions.push_back(positions[i]);
+  }
+
+  std::vector<bool> isInserted = m_index.insertBatch(entries);
+  for (size_t i = 0; i < isInserted.size(); ++i) {
+    if (isInserted[i]) {
+      results[entryPositions[i]] = true;
+      if (m_evictionPolicy != nullptr)
+        m_evictionPolicy->afterInsert(entries[i].getId(), entries[i].getName());
+      notifyInsertion(data[entryPositions[i]]->getName());
     }
-    idName = m_index.find(name);
   }
-  if (hasError)
+  NDN_LOG_DEBUG("Inserted batch of " << entries.size() << " out of " << data.size() << " data");
+
+  if (m_isGroupOpen && m_pendingInsertions.size() >= m_maxGroupSize)
+    flush();
+  return results;
+}
+
+void
+RepoStorage::makeRoom(size_t nNewEntries)
+{
+  if (m_evictionPolicy == nullptr)
+    return;
+
+  size_t nNeeded = 0;
+  if (m_index.size() + nNewEntries > m_index.getMaxPackets()) {
+    nNeeded = std::max(m_index.size() + nNewEntries - m_index.getMaxPackets(),
+                       m_evictionBatchSize);
+  }
+  else if (m_evictionPolicy->getNOverLimit() < m_evictionBatchSize) {
+    // entries the policy wants gone on its own wait until a whole batch of them is due
+    return;
+  }
+  std::vector<int64_t> ids = m_evictionPolicy->selectVictims(nNeeded);
+  if (ids.empty())
+    return;
+
+  // pending insertions are announced before any deletion of the same data
+  flush();
+
+  std::vector<Name> fullNames;
+  fullNames.reserve(ids.size());
+  for (int64_t id : ids) {
+    fullNames.push_back(m_index.findName(id));
+  }
+  m_storage.eraseBatch(ids);
+  m_index.eraseBatch(fullNames);
+
+  for (size_t i = 0; i < ids.size(); ++i) {
+    m_cache.erase(ids[i]);
+    m_evictionPolicy->afterErase(ids[i]);
+    afterDataDeletion(fullNames[i]);
+  }
+  NDN_LOG_DEBUG("Evicted " << ids.size() << " entries");
+}
+
+void
+RepoStorage::openGroup()
+{
+  if (m_scheduler == nullptr || m_isGroupOpen)
+    return;
+
+  m_storage.beginTransaction();
+  m_isGroupOpen = true;
+  m_groupCommitEvent = m_scheduler->scheduleEvent(m_groupCommitWindow,
+                                                  bind(&RepoStorage::flush, this));
+}
+
+void
+RepoStorage::notifyInsertion(const Name& name)
+{
+  if (m_isGroupOpen)
+    m_pendingInsertions.push_back(name);
+  else
+    afterDataInsertion(name);
+}
+
+ssize_t
+RepoStorage::deleteData(const Name& name, size_t maxEntries)
+{
+  // one scan of the index and one storage transaction for the whole prefix
+  std::vector<std::pair<int64_t, Name>> entries = m_index.findAll(name, maxEntries);
+  if (entries.size() < maxEntries)
+    return deleteEntries(entries, [this, &name] { m_index.erasePrefix(name); });
+  return deleteEntries(entries, [this, &entries] { eraseFromIndex(entries); });
+}
+
+ssize_t
+RepoStorage::deleteSegments(const Name& prefix, uint64_t first, uint64_t last,
+                            size_t maxEntries)
+{
+  std::vector<std::pair<int64_t, Name>> entries = m_index.findSegments(prefix, first, last,
+                                                                       maxEntries);
+  if (entries.size() < maxEntries)
+    return deleteEntries(entries, [&] { m_index.eraseSegments(prefix, first, last); });
+  return deleteEntries(entries, [this, &entries] { eraseFromIndex(entries); });
+}
+
+std::vector<uint64_t>
+RepoStorage::getStoredSegments(const Name& prefix, uint64_t first, uint64_t last) const
+{
+  std::vector<uint64_t> segments;
+  for (const auto& entry : m_index.findSegments(prefix, first, last)) {
+    uint64_t segment = entry.second.get(prefix.size()).toSegment();
+    // several Data may share a segment name
+    if (segments.empty() || segments.back() != segment)
+      segments.push_back(segment);
+  }
+  return segments;
+}
+
+std::vector<name::Component>
+RepoStorage::getStoredChildren(const Name& prefix, size_t limit) const
+{
+  // the full name of data named exactly prefix ends with its implicit digest
+  return m_index.findLastChildren(prefix, limit);
+}
+
+std::vector<std::pair<int64_t, Name>>
+RepoStorage::getStoredAfter(const Name& prefix, const Name& after, size_t limit) const
+{
+  return m_index.findAllAfter(prefix, after, limit);
+}
+
+Block
+RepoStorage::readWire(int64_t id) const
+{
+  return m_storage.readWire(id);
+}
+
+bool
+RepoStorage::hasData(const Data& data) const
+{
+  return m_index.hasData(data);
+}
+
+bool
+RepoStorage::hasName(const Name& prefix) const
+{
+  return m_index.find(prefix).first != 0;
+}
+
+void
+RepoStorage::eraseFromIndex(const std::vector<std::pair<int64_t, Name>>& entries)
+{
+  std::vector<Name> fullNames;
+  fullNames.reserve(entries.size());
+  for (const auto& entry : entries) {
+    fullNames.push_back(entry.second);
+  }
+  m_index.eraseBatch(fullNames);
+}
+
+ssize_t
+RepoStorage::deleteEntries(const std::vector<std::pair<int64_t, Name>>& entries,
+                           const std::function<void()>& eraseIndexEntries)
+{
+  if (entries.empty())
+    return 0;
+
+  // pending insertions are announced before any deletion of the same data
+  flush();
+
+  std::vector<int64_t> ids;
+  ids.reserve(entries.size());
+  for (const auto& entry : entries) {
+    ids.push_back(entry.first);
+  }
+  size_t nErasedFromDb = m_storage.eraseBatch(ids);
+  eraseIndexEntries();
+
+  for (const auto& entry : entries) {
+    m_cache.erase(entry.first);
+    if (m_evictionPolicy != nullptr)
+      m_evictionPolicy->afterErase(entry.first);
+  }
+  for (const auto& entry : entries) {
+    afterDataDeletion(entry.second);
+  }
+  NDN_LOG_DEBUG("Deleted " << entries.size() << " entries");
+
+  if (nErasedFromDb != entries.size())
     return -1;
   else
-    return count;
+    return entries.size();
 }
 
 ssize_t
@@ -99,8 +539,11 @@ RepoStorage::deleteData(const Interest& interest)
   bool hasError = false;
   std::pair<int64_t,ndn::Name> idName = m_index.find(interestDelete);
   while (idName.first != 0) {
+    m_cache.erase(idName.first);
     bool resultDb = m_storage.erase(idName.first);
     bool resultIndex = m_index.erase(idName.second); //full name
+    if (m_evictionPolicy != nullptr)
+      m_evictionPolicy->afterErase(idName.first);
     if (resultDb && resultIndex) {
       afterDataDeletion(idName.second);
       count++;
@@ -118,15 +561,30 @@ RepoStorage::deleteData(const Interest& interest)
 
 shared_ptr<Data>
 RepoStorage::readData(const Interest& interest) const
+{
+  Block wire = readWire(interest);
+  if (wire.empty())
+    return shared_ptr<Data>();
+  return make_shared<Data>(wire);
+}
+
+Block
+RepoStorage::readWire(const Interest& interest) const
 {
   std::pair<int64_t,ndn::Name> idName = m_index.find(interest);
-  if (idName.first != 0) {
-    shared_ptr<Data> data = m_storage.read(idName.first);
-    if (data) {
-      return data;
-    }
+  if (idName.first == 0)
+    return Block();
+
+  if (m_evictionPolicy != nullptr)
+    m_evictionPolicy->afterRead(idName.first);
+
+  Block wire = m_cache.find(idName.first);
+  if (wire.empty()) {
+    wire = m_storage.readWire(idName.first);
+    if (!wire.empty())
+      m_cache.insert(idName.first, wire);
   }
-  return shared_ptr<Data>();
+  return wire;
 }
 
 
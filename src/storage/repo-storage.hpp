@@ -23,6 +23,8 @@
 #include "../common.hpp"
 #include "storage.hpp"
 #include "index.hpp"
+#include "data-cache.hpp"
+#include "eviction-policy.hpp"
 #include "../repo-command-parameter.hpp"
 
 #include <ndn-cxx/util/signal.hpp>
@@ -51,26 +53,141 @@ public:
 public:
   RepoStorage(const int64_t& nMaxPackets, Storage& store);
 
+  ~RepoStorage();
+
+  /**
+   *  @brief  enable group commit of inserted data
+   *  @param  scheduler     used to commit a pending group once @p window has passed
+   *  @param  maxGroupSize  a group is committed as soon as it holds this many packets
+   *  @param  window        maximum time an inserted packet waits for its group to be committed
+   *
+   *  Inserts are collected into one storage transaction.  afterDataInsertion is emitted
+   *  only after the group containing the data has been committed.
+   */
+  void
+  enableGroupCommit(Scheduler& scheduler, size_t maxGroupSize,
+                    const ndn::time::milliseconds& window);
+
+  /**
+   *  @brief  set the size of the cache of recently read data
+   *  @param  nBytes  maximum total size of cached Data wire blocks, 0 disables the cache
+   */
+  void
+  setCacheCapacity(size_t nBytes);
+
+  /**
+   *  @brief  get the cache of recently read data, e.g. to inspect its counters
+   */
+  const DataCache&
+  getCache() const
+  {
+    return m_cache;
+  }
+
+  /**
+   *  @brief  evict entries chosen by @p policy instead of failing inserts when the repo is full
+   *  @param  batchSize  minimum number of entries evicted at once, so that the deletions
+   *                     are written to storage in batches rather than one per insert
+   *
+   *  Entries already in the index are reported to @p policy.  A null @p policy restores
+   *  the default, where inserting into a full repo throws.
+   */
+  void
+  setEvictionPolicy(unique_ptr<EvictionPolicy> policy, size_t batchSize);
+
+  /**
+   *  @brief  commit the pending group of inserts, if any
+   */
+  void
+  flush();
+
+  /**
+   *  @brief  keep snapshots of the index in @p path
+   *
+   *  initialize() loads the snapshot, if present and consistent with the database,
+   *  instead of enumerating the whole database.
+   */
+  void
+  setSnapshotPath(const std::string& path);
+
   /**
-   *  @brief  rebuild index from database
+   *  @brief  set the number of threads reading the database when the index is rebuilt
+   *  @param  nThreads  0 uses one thread per hardware thread; 1, the default, enumerates
+   *                    the database on the calling thread
+   *
+   *  With more than one thread, each thread reads part of the database into a run sorted
+   *  by name.  The runs are merged into the index on the calling thread, so only the
+   *  reading, decoding and sorting of the names run in parallel.
+   */
+  void
+  setRebuildThreads(size_t nThreads);
+
+  /**
+   *  @brief  write a snapshot of the index, after committing the pending group of inserts
+   *
+   *  The snapshot records the largest database id it covers, so that the next
+   *  initialize() only reads the entries inserted after it was written, and the number
+   *  of entries deleted so far, so that any deletion since makes it out of date.
+   *
+   *  The whole index is written by the calling thread.
+   */
+  void
+  saveSnapshot();
+
+  /**
+   *  @brief  rebuild index from database, starting from the index snapshot if there is one
    */
   void
   initialize();
 
   /**
    *  @brief  insert data into repo
+   *  @throw  Error the repo is full and no eviction policy makes room
    */
   bool
   insertData(const Data& data);
 
   /**
-   *  @brief   delete data from repo
-   *  @param   name     used to find entry needed to be erased in repo
-   *  @return  if deletion in either index or database fail, return -1,
+   *  @brief  insert a batch of data into repo
+   *  @return whether each data was inserted, in the order of @p data
+   *
+   *  Data already in the repo, or repeated within the batch, is reported as not inserted,
+   *  and so is the data that does not fit in a full repo once eviction has made room.
+   *  The remaining data is written to storage in one transaction and added to the index in bulk.
+   */
+  std::vector<bool>
+  insertBatch(const std::vector<shared_ptr<const Data>>& data);
+
+  /**
+   *  @brief  insert a batch of data whose full names and keyLocator hashes are already computed
+   *  @param  metas  the result of prepareInsert() for each data, in the order of @p data
+   */
+  std::vector<bool>
+  insertBatch(const std::vector<shared_ptr<const Data>>& data,
+              const std::vector<Storage::ItemMeta>& metas);
+
+  /**
+   *  @brief  compute the full name and keyLocator hash that inserting @p data needs
+   *
+   *  It only touches @p data, so it can run on another thread than the one inserting.
+   */
+  static Storage::ItemMeta
+  prepareInsert(const Data& data);
+
+  /**
+   *  @brief   delete all data under a prefix from repo
+   *  @param   name        prefix of the entries to erase
+   *  @param   maxEntries  erase at most this many entries, the first ones in name order;
+   *                       fewer erased entries mean nothing is left under @p name
+   *  @return  if deletion in the database fails, return -1,
    *           otherwise return the number of erased entries
+   *
+   *  The entries are found with one scan of the index, erased from storage in one
+   *  transaction and from the index at once.  afterDataDeletion is emitted for each
+   *  of them once they are all gone.
    */
   ssize_t
-  deleteData(const Name& name);
+  deleteData(const Name& name, size_t maxEntries = std::numeric_limits<size_t>::max());
 
   /**
    *  @brief   delete data from repo
@@ -81,6 +198,75 @@ public:
   ssize_t
   deleteData(const Interest& interest);
 
+  /**
+   *  @brief   delete the data under segments @p first through @p last of @p prefix
+   *  @param   last        std::numeric_limits<uint64_t>::max() deletes every segment from
+   *                       @p first on
+   *  @param   maxEntries  erase at most this many entries, the first ones in name order
+   *  @return  if deletion in the database fails, return -1,
+   *           otherwise return the number of erased entries
+   *
+   *  The segments are found with one range scan of the children of @p prefix in the index,
+   *  and erased like deleteData(const Name&, size_t).
+   */
+  ssize_t
+  deleteSegments(const Name& prefix, uint64_t first, uint64_t last,
+                 size_t maxEntries = std::numeric_limits<size_t>::max());
+
+  /**
+   *  @brief   find which of segments @p first through @p last of @p prefix are stored
+   *  @param   last  std::numeric_limits<uint64_t>::max() leaves the range open-ended
+   *  @return  the stored segment numbers in increasing order
+   *
+   *  The segments are found with one range scan of the index; storage is not read.
+   */
+  std::vector<uint64_t>
+  getStoredSegments(const Name& prefix, uint64_t first, uint64_t last) const;
+
+  /**
+   *  @brief   find the components that follow @p prefix in the names of the stored data
+   *  @param   limit  maximum number of components to return
+   *  @return  each distinct component once, in name order; the greatest ones if there
+   *           are more than @p limit
+   *
+   *  Only the children of @p prefix in the index are visited, from the greatest one.
+   */
+  std::vector<name::Component>
+  getStoredChildren(const Name& prefix,
+                    size_t limit = std::numeric_limits<size_t>::max()) const;
+
+  /**
+   *  @brief   find the data under @p prefix whose full names sort after @p after,
+   *           looking only at the index
+   *  @param   after  the last full name seen, or an empty Name to start from the first
+   *  @param   limit  maximum number of data to return
+   *  @return  database id and full name of each data, in name order
+   */
+  std::vector<std::pair<int64_t, Name>>
+  getStoredAfter(const Name& prefix, const Name& after, size_t limit) const;
+
+  /**
+   *  @brief   read the wire encoding of the data with database id @p id straight from storage
+   *  @return  an empty Block if there is no such data anymore
+   *
+   *  Unlike readWire(const Interest&), it neither goes through nor fills the cache, so that
+   *  reading large parts of the repo does not evict the data being served.
+   */
+  Block
+  readWire(int64_t id) const;
+
+  /**
+   *  @brief   determine whether the same Data is stored
+   */
+  bool
+  hasData(const Data& data) const;
+
+  /**
+   *  @brief   determine whether any data under @p prefix is stored, looking only at the index
+   */
+  bool
+  hasName(const Name& prefix) const;
+
   /**
    *  @brief  read data from repo
    *  @param   interest  used to request data
@@ -89,10 +275,69 @@ public:
   std::shared_ptr<Data>
   readData(const Interest& interest) const;
 
+  /**
+   *  @brief  read the stored wire encoding of data from repo
+   *  @param   interest  used to request data
+   *  @return  the Data TLV block as stored, or an empty Block if no data matches
+   *
+   *  Unlike readData(), the stored block is not decoded, so it can be handed to
+   *  the face as-is.  Blocks are served from the data cache when present.
+   */
+  Block
+  readWire(const Interest& interest) const;
+
 private:
+  /**
+   *  @brief  erase @p entries from storage in one transaction, then from the index
+   *          with @p eraseIndexEntries, then emit afterDataDeletion for each of them
+   */
+  ssize_t
+  deleteEntries(const std::vector<std::pair<int64_t, Name>>& entries,
+                const std::function<void()>& eraseIndexEntries);
+
+  void
+  eraseFromIndex(const std::vector<std::pair<int64_t, Name>>& entries);
+
   void
   insertItemToIndex(const Storage::ItemMeta& item);
 
+  /**
+   *  @brief  rebuild the whole index from the sorted runs read by m_nRebuildThreads threads
+   *
+   *  The merge and the insertion into the index run on the calling thread.
+   */
+  void
+  rebuildIndex();
+
+  /**
+   *  @brief  load the index snapshot and check that it still matches the database
+   *  @return the largest database id covered by the snapshot, or -1 if it cannot be used
+   */
+  int64_t
+  loadSnapshot();
+
+  /**
+   *  @brief  evict entries so that @p nNewEntries more fit in the index
+   *
+   *  Does nothing without an eviction policy.  Entries the policy wants gone on its own,
+   *  e.g. over a prefix quota, are evicted even if there is room, once there are enough
+   *  of them for an eviction batch.
+   */
+  void
+  makeRoom(size_t nNewEntries);
+
+  /**
+   *  @brief  open a group of inserts if group commit is enabled and no group is open
+   */
+  void
+  openGroup();
+
+  /**
+   *  @brief  emit afterDataInsertion now, or once the open group is committed
+   */
+  void
+  notifyInsertion(const Name& name);
+
 public:
   ndn::util::Signal<RepoStorage, ndn::Name> afterDataInsertion;
   ndn::util::Signal<RepoStorage, ndn::Name> afterDataDeletion;
@@ -100,6 +345,18 @@ public:
 private:
   Index m_index;
   Storage& m_storage;
+  mutable DataCache m_cache;
+  std::string m_snapshotPath;
+  size_t m_nRebuildThreads;
+  unique_ptr<EvictionPolicy> m_evictionPolicy;
+  size_t m_evictionBatchSize;
+
+  Scheduler* m_scheduler;
+  size_t m_maxGroupSize;
+  ndn::time::milliseconds m_groupCommitWindow;
+  bool m_isGroupOpen;
+  std::vector<Name> m_pendingInsertions;
+  ndn::EventId m_groupCommitEvent;
 };
 
 } // namespace repo
@@ -24,13 +24,24 @@
 #include <ndn-cxx/util/sha256.hpp>
 #include <boost/filesystem.hpp>
 #include <istream>
+#include <thread>
 
 namespace repo {
 
 using std::string;
 
+const size_t SqliteStorage::ERASE_BATCH_SIZE;
+
 SqliteStorage::SqliteStorage(const string& dbPath)
   : m_size(0)
+  , m_insertStmt(nullptr)
+  , m_deleteStmt(nullptr)
+  , m_deleteBatchStmt(nullptr)
+  , m_readStmt(nullptr)
+  , m_sizeStmt(nullptr)
+  , m_beginStmt(nullptr)
+  , m_commitStmt(nullptr)
+  , m_transactionDepth(0)
 {
   if (dbPath.empty()) {
     std::cerr << "Create db file in local location [" << dbPath << "]. " << std::endl
@@ -81,218 +92,513 @@ SqliteStorage::initializeRepo()
   }
   sqlite3_exec(m_db, "PRAGMA synchronous = OFF", 0, 0, &errMsg);
   sqlite3_exec(m_db, "PRAGMA journal_mode = WAL", 0, 0, &errMsg);
+
+  prepareStatements();
+  initializeDeletionCount();
+
+  // the index may be loaded from a snapshot without enumerating the database, and ids
+  // are given out in order and never reused, so the size follows from the two counts
+  m_size = getNInserted() - getNDeleted();
+}
+
+void
+SqliteStorage::initializeDeletionCount()
+{
+  // the trigger runs in the transaction of each deletion, so the count is rolled back
+  // along with it
+  executeSql("BEGIN TRANSACTION;");
+  if (sqlite3_exec(m_db, "CREATE TABLE NDN_REPO_STATS (deleted INTEGER NOT NULL);",
+                   0, 0, 0) != SQLITE_OK) {
+    // the database has them already
+    executeSql("ROLLBACK TRANSACTION;");
+    return;
+  }
+  try {
+    executeSql("INSERT INTO NDN_REPO_STATS (deleted) SELECT "
+               "coalesce((SELECT seq FROM sqlite_sequence WHERE name = 'NDN_REPO'), 0) - "
+               "(SELECT count(*) FROM NDN_REPO);");
+    executeSql("CREATE TRIGGER NDN_REPO_COUNT_DELETED AFTER DELETE ON NDN_REPO "
+               "BEGIN UPDATE NDN_REPO_STATS SET deleted = deleted + 1; END;");
+    executeSql("COMMIT TRANSACTION;");
+  }
+  catch (...) {
+    sqlite3_exec(m_db, "ROLLBACK TRANSACTION;", 0, 0, 0);
+    throw;
+  }
+}
+
+void
+SqliteStorage::prepareStatements()
+{
+  m_insertStmt = prepareStatement("INSERT INTO NDN_REPO (id, name, data, keylocatorHash) "
+                                  "VALUES (?, ?, ?, ?);");
+  m_deleteStmt = prepareStatement("DELETE FROM NDN_REPO WHERE id = ?;");
+  m_deleteBatchStmt = prepareStatement(makeEraseBatchSql(ERASE_BATCH_SIZE));
+  m_readStmt = prepareStatement("SELECT data FROM NDN_REPO WHERE id = ?;");
+  m_sizeStmt = prepareStatement("SELECT count(*) FROM NDN_REPO;");
+  m_beginStmt = prepareStatement("BEGIN TRANSACTION;");
+  m_commitStmt = prepareStatement("COMMIT TRANSACTION;");
+}
+
+sqlite3_stmt*
+SqliteStorage::prepareStatement(const string& sql)
+{
+  sqlite3_stmt* stmt = 0;
+  int rc = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &stmt, 0);
+  if (rc != SQLITE_OK) {
+    sqlite3_finalize(stmt);
+    std::cerr << "statement prepare failure rc:" << rc << " [" << sql << "]" << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Statement prepare failure: " + sql));
+  }
+  return stmt;
 }
 
 SqliteStorage::~SqliteStorage()
 {
+  // sqlite3_finalize is a no-op on a null statement
+  sqlite3_finalize(m_insertStmt);
+  sqlite3_finalize(m_deleteStmt);
+  sqlite3_finalize(m_deleteBatchStmt);
+  sqlite3_finalize(m_readStmt);
+  sqlite3_finalize(m_sizeStmt);
+  sqlite3_finalize(m_beginStmt);
+  sqlite3_finalize(m_commitStmt);
   sqlite3_close(m_db);
 }
 
 void
 SqliteStorage::fullEnumerate(const std::function<void(const Storage::ItemMeta)>& f)
 {
-  sqlite3_stmt* m_stmt = 0;
-  int rc = SQLITE_DONE;
-  string sql = string("SELECT id, name, keylocatorHash FROM NDN_REPO;");
-  rc = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &m_stmt, 0);
-  if (rc != SQLITE_OK)
-    BOOST_THROW_EXCEPTION(Error("Initiation Read Entries from Database Prepare error"));
-  int entryNumber = 0;
+  int64_t entryNumber = 0;
+  enumerateAfter(0, [&f, &entryNumber] (const ItemMeta& item) {
+      f(item);
+      entryNumber++;
+    });
+  m_size = entryNumber;
+}
+
+void
+SqliteStorage::enumerateAfter(int64_t lastId,
+                              const std::function<void(const Storage::ItemMeta)>& f)
+{
+  sqlite3_stmt* stmt = prepareStatement("SELECT id, name, keylocatorHash FROM NDN_REPO "
+                                        "WHERE id > ? ORDER BY id;");
+  sqlite3_bind_int64(stmt, 1, lastId);
   while (true) {
-    rc = sqlite3_step(m_stmt);
+    int rc = sqlite3_step(stmt);
     if (rc == SQLITE_ROW) {
-
       ItemMeta item;
-      item.fullName.wireDecode(Block(reinterpret_cast<const uint8_t*>(sqlite3_column_blob(m_stmt, 1)),
-                                     sqlite3_column_bytes(m_stmt, 1)));
-      item.id = sqlite3_column_int(m_stmt, 0);
-      item.keyLocatorHash = make_shared<const ndn::Buffer>(sqlite3_column_blob(m_stmt, 3),
-                                                           sqlite3_column_bytes(m_stmt, 3));
-
       try {
+        item.fullName.wireDecode(Block(reinterpret_cast<const uint8_t*>(sqlite3_column_blob(stmt, 1)),
+                                       sqlite3_column_bytes(stmt, 1)));
+        item.id = sqlite3_column_int64(stmt, 0);
+        item.keyLocatorHash = make_shared<const ndn::Buffer>(sqlite3_column_blob(stmt, 2),
+                                                             sqlite3_column_bytes(stmt, 2));
         f(item);
       }
       catch (...) {
-        sqlite3_finalize(m_stmt);
+        sqlite3_finalize(stmt);
         throw;
       }
-      entryNumber++;
     }
     else if (rc == SQLITE_DONE) {
-      sqlite3_finalize(m_stmt);
+      sqlite3_finalize(stmt);
       break;
     }
     else {
       std::cerr << "Initiation Read Entries rc:" << rc << std::endl;
-      sqlite3_finalize(m_stmt);
+      sqlite3_finalize(stmt);
       BOOST_THROW_EXCEPTION(Error("Initiation Read Entries error"));
     }
   }
-  m_size = entryNumber;
+}
+
+std::vector<std::vector<Storage::ItemMeta>>
+SqliteStorage::readSortedRuns(size_t nThreads)
+{
+  nThreads = std::max<size_t>(nThreads, 1);
+  sqlite3_stmt* stmt = prepareStatement("SELECT min(id), max(id) FROM NDN_REPO;");
+  int rc = sqlite3_step(stmt);
+  int64_t minId = sqlite3_column_int64(stmt, 0);
+  int64_t maxId = sqlite3_column_int64(stmt, 1);
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_ROW) {
+    std::cerr << "Database query failure rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Database query failure"));
+  }
+
+  std::vector<std::vector<ItemMeta>> runs(nThreads);
+  std::vector<std::exception_ptr> errors(nThreads);
+  std::vector<std::thread> threads;
+  int64_t runLength = (maxId - minId) / static_cast<int64_t>(nThreads) + 1;
+  for (size_t i = 0; i < nThreads; ++i) {
+    int64_t firstId = minId + runLength * static_cast<int64_t>(i);
+    threads.emplace_back([this, firstId, runLength, &runs, &errors, i] {
+        try {
+          readRun(firstId, firstId + runLength, runs[i]);
+        }
+        catch (...) {
+          errors[i] = std::current_exception();
+        }
+      });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  m_size = 0;
+  for (const auto& run : runs) {
+    m_size += run.size();
+  }
+  return runs;
+}
+
+void
+SqliteStorage::readRun(int64_t firstId, int64_t endId, std::vector<ItemMeta>& run) const
+{
+  sqlite3* db = nullptr;
+  int rc = sqlite3_open_v2(m_dbPath.c_str(), &db, SQLITE_OPEN_READONLY,
+#ifdef DISABLE_SQLITE3_FS_LOCKING
+                           "unix-dotfile"
+#else
+                           0
+#endif
+                           );
+  sqlite3_stmt* stmt = nullptr;
+  if (rc == SQLITE_OK) {
+    rc = sqlite3_prepare_v2(db, "SELECT id, name, keylocatorHash FROM NDN_REPO "
+                                "WHERE id >= ? AND id < ?;", -1, &stmt, 0);
+  }
+  if (rc != SQLITE_OK) {
+    std::cerr << "Database read connection failure rc:" << rc << std::endl;
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    BOOST_THROW_EXCEPTION(Error("Database read connection failure"));
+  }
+
+  sqlite3_bind_int64(stmt, 1, firstId);
+  sqlite3_bind_int64(stmt, 2, endId);
+  try {
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+      run.emplace_back();
+      ItemMeta& item = run.back();
+      item.fullName.wireDecode(Block(reinterpret_cast<const uint8_t*>(sqlite3_column_blob(stmt, 1)),
+                                     sqlite3_column_bytes(stmt, 1)));
+      item.id = sqlite3_column_int64(stmt, 0);
+      item.keyLocatorHash = make_shared<const ndn::Buffer>(sqlite3_column_blob(stmt, 2),
+                                                           sqlite3_column_bytes(stmt, 2));
+    }
+  }
+  catch (...) {
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    throw;
+  }
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+  if (rc != SQLITE_DONE) {
+    std::cerr << "Initiation Read Entries rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Initiation Read Entries error"));
+  }
+
+  std::sort(run.begin(), run.end(),
+            [] (const ItemMeta& a, const ItemMeta& b) { return a.fullName < b.fullName; });
 }
 
 int64_t
-SqliteStorage::insert(const Data& data)
+SqliteStorage::getMaxId()
 {
-  Name name = data.getName();
+  sqlite3_stmt* stmt = prepareStatement("SELECT max(id) FROM NDN_REPO;");
+  int rc = sqlite3_step(stmt);
+  // max() of an empty table is NULL, which reads as 0
+  int64_t maxId = sqlite3_column_int64(stmt, 0);
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_ROW) {
+    std::cerr << "Database query failure rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Database query failure"));
+  }
+  return maxId;
+}
 
+int64_t
+SqliteStorage::getNInserted()
+{
+  // AUTOINCREMENT records the last id given out; there is no row before the first insert
+  sqlite3_stmt* stmt = prepareStatement("SELECT seq FROM sqlite_sequence WHERE name = 'NDN_REPO';");
+  int rc = sqlite3_step(stmt);
+  int64_t nInserted = rc == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+    std::cerr << "Database query failure rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Database query failure"));
+  }
+  return nInserted;
+}
+
+int64_t
+SqliteStorage::getNDeleted()
+{
+  sqlite3_stmt* stmt = prepareStatement("SELECT deleted FROM NDN_REPO_STATS;");
+  int rc = sqlite3_step(stmt);
+  int64_t nDeleted = sqlite3_column_int64(stmt, 0);
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_ROW) {
+    std::cerr << "Database query failure rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Database query failure"));
+  }
+  return nDeleted;
+}
+
+int64_t
+SqliteStorage::insert(const Data& data)
+{
   Index::Entry entry(data, 0); //the id is not used
+  return insert(data, entry.getName(), entry.getKeyLocatorHash());
+}
+
+int64_t
+SqliteStorage::insert(const Data& data, const Name& fullName,
+                      const ndn::ConstBufferPtr& keyLocatorHash)
+{
+  const Name& name = data.getName();
+
   int64_t id = -1;
   if (name.empty()) {
     std::cerr << "name is empty" << std::endl;
     return -1;
   }
 
-  int rc = 0;
-
-  sqlite3_stmt* insertStmt = 0;
-
-  string insertSql = string("INSERT INTO NDN_REPO (id, name, data, keylocatorHash) "
-                            "VALUES (?, ?, ?, ?)");
-
-  if (sqlite3_prepare_v2(m_db, insertSql.c_str(), -1, &insertStmt, 0) != SQLITE_OK) {
-    sqlite3_finalize(insertStmt);
-    std::cerr << "insert sql not prepared" << std::endl;
-  }
   //Insert
-  auto result = sqlite3_bind_null(insertStmt, 1);
+  auto result = sqlite3_bind_null(m_insertStmt, 1);
   if (result == SQLITE_OK) {
-    result = sqlite3_bind_blob(insertStmt, 2,
-                               entry.getName().wireEncode().wire(),
-                               entry.getName().wireEncode().size(), SQLITE_STATIC);
+    result = sqlite3_bind_blob(m_insertStmt, 2,
+                               fullName.wireEncode().wire(),
+                               fullName.wireEncode().size(), SQLITE_STATIC);
   }
   if (result == SQLITE_OK) {
-    result = sqlite3_bind_blob(insertStmt, 3,
+    result = sqlite3_bind_blob(m_insertStmt, 3,
                                data.wireEncode().wire(),
                                data.wireEncode().size(), SQLITE_STATIC);
   }
   if (result == SQLITE_OK) {
-    BOOST_ASSERT(entry.getKeyLocatorHash()->size() == ndn::util::Sha256::DIGEST_SIZE);
-    result = sqlite3_bind_blob(insertStmt, 4,
-                               entry.getKeyLocatorHash()->data(),
-                               entry.getKeyLocatorHash()->size(), SQLITE_STATIC);
+    BOOST_ASSERT(keyLocatorHash->size() == ndn::util::Sha256::DIGEST_SIZE);
+    result = sqlite3_bind_blob(m_insertStmt, 4,
+                               keyLocatorHash->data(),
+                               keyLocatorHash->size(), SQLITE_STATIC);
   }
 
   if (result == SQLITE_OK) {
-    rc = sqlite3_step(insertStmt);
+    int rc = sqlite3_step(m_insertStmt);
+    // the bound blobs point into data and entry, so drop them before returning
+    sqlite3_reset(m_insertStmt);
+    sqlite3_clear_bindings(m_insertStmt);
     if (rc == SQLITE_CONSTRAINT) {
       std::cerr << "Insert failed" << std::endl;
-      sqlite3_finalize(insertStmt);
       BOOST_THROW_EXCEPTION(Error("Insert failed"));
-     }
-    sqlite3_reset(insertStmt);
-     m_size++;
-     id = sqlite3_last_insert_rowid(m_db);
+    }
+    m_size++;
+    id = sqlite3_last_insert_rowid(m_db);
   }
   else {
+    sqlite3_reset(m_insertStmt);
+    sqlite3_clear_bindings(m_insertStmt);
     BOOST_THROW_EXCEPTION(Error("Some error with insert"));
   }
 
-  sqlite3_finalize(insertStmt);
   return id;
 }
 
+std::vector<int64_t>
+SqliteStorage::insertBatch(const std::vector<shared_ptr<const Data>>& data,
+                           const std::vector<ItemMeta>& metas)
+{
+  BOOST_ASSERT(data.size() == metas.size());
+  std::vector<int64_t> ids;
+  ids.reserve(data.size());
+
+  beginTransaction();
+  for (size_t i = 0; i < data.size(); ++i) {
+    int64_t id = -1;
+    try {
+      id = insert(*data[i], metas[i].fullName, metas[i].keyLocatorHash);
+    }
+    catch (const std::runtime_error& e) {
+      std::cerr << "Batch insert of " << data[i]->getName() << " failed: " << e.what() << std::endl;
+    }
+    ids.push_back(id);
+  }
+  commitTransaction();
+
+  return ids;
+}
 
 bool
 SqliteStorage::erase(const int64_t id)
 {
-  sqlite3_stmt* deleteStmt = 0;
-
-  string deleteSql = string("DELETE from NDN_REPO where id = ?;");
+  if (sqlite3_bind_int64(m_deleteStmt, 1, id) != SQLITE_OK) {
+    std::cerr << "delete bind error" << std::endl;
+    sqlite3_reset(m_deleteStmt);
+    BOOST_THROW_EXCEPTION(Error("delete bind error"));
+  }
 
-  if (sqlite3_prepare_v2(m_db, deleteSql.c_str(), -1, &deleteStmt, 0) != SQLITE_OK) {
-    sqlite3_finalize(deleteStmt);
-    std::cerr << "delete statement prepared failed" << std::endl;
-    BOOST_THROW_EXCEPTION(Error("delete statement prepared failed"));
+  int rc = sqlite3_step(m_deleteStmt);
+  sqlite3_reset(m_deleteStmt);
+  if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+    std::cerr << " node delete error rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error(" node delete error"));
   }
+  if (sqlite3_changes(m_db) != 1)
+    return false;
 
-  if (sqlite3_bind_int64(deleteStmt, 1, id) == SQLITE_OK) {
-    int rc = sqlite3_step(deleteStmt);
-    if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
-      std::cerr << " node delete error rc:" << rc << std::endl;
-      sqlite3_finalize(deleteStmt);
-      BOOST_THROW_EXCEPTION(Error(" node delete error"));
+  m_size--;
+  return true;
+}
+
+
+size_t
+SqliteStorage::eraseBatch(const std::vector<int64_t>& ids)
+{
+  // a savepoint nests inside an open group commit, and on failure undoes only this batch
+  size_t nErased = 0;
+  executeSql("SAVEPOINT erase_batch;");
+  try {
+    for (size_t first = 0; first < ids.size(); first += ERASE_BATCH_SIZE) {
+      size_t nIds = std::min(ids.size() - first, ERASE_BATCH_SIZE);
+      // the last, shorter chunk gets a statement of its own
+      sqlite3_stmt* stmt = nIds == ERASE_BATCH_SIZE ? m_deleteBatchStmt :
+                                                      prepareStatement(makeEraseBatchSql(nIds));
+      for (size_t i = 0; i < nIds; ++i) {
+        sqlite3_bind_int64(stmt, i + 1, ids[first + i]);
+      }
+      int rc = sqlite3_step(stmt);
+      if (stmt == m_deleteBatchStmt)
+        sqlite3_reset(stmt);
+      else
+        sqlite3_finalize(stmt);
+      if (rc != SQLITE_DONE) {
+        std::cerr << " node delete error rc:" << rc << std::endl;
+        BOOST_THROW_EXCEPTION(Error(" node delete error"));
+      }
+      nErased += sqlite3_changes(m_db);
     }
-    if (sqlite3_changes(m_db) != 1)
-      return false;
-    m_size--;
   }
-  else {
-    std::cerr << "delete bind error" << std::endl;
-    sqlite3_finalize(deleteStmt);
-    BOOST_THROW_EXCEPTION(Error("delete bind error"));
+  catch (...) {
+    // the rows deleted so far are restored, so the index still matches the database
+    sqlite3_exec(m_db, "ROLLBACK TO erase_batch; RELEASE erase_batch;", 0, 0, 0);
+    throw;
   }
-  sqlite3_finalize(deleteStmt);
-  return true;
+  executeSql("RELEASE erase_batch;");
+
+  m_size -= nErased;
+  return nErased;
 }
 
+void
+SqliteStorage::executeSql(const char* sql)
+{
+  int rc = sqlite3_exec(m_db, sql, 0, 0, 0);
+  if (rc != SQLITE_OK) {
+    std::cerr << "statement failure rc:" << rc << " [" << sql << "]" << std::endl;
+    BOOST_THROW_EXCEPTION(Error(string("Statement failure: ") + sql));
+  }
+}
+
+string
+SqliteStorage::makeEraseBatchSql(size_t nIds)
+{
+  string sql = "DELETE FROM NDN_REPO WHERE id IN (?";
+  for (size_t i = 1; i < nIds; ++i) {
+    sql += ",?";
+  }
+  return sql + ");";
+}
 
 shared_ptr<Data>
 SqliteStorage::read(const int64_t id)
 {
-  sqlite3_stmt* queryStmt = 0;
-  string sql = string("SELECT * FROM NDN_REPO WHERE id = ? ;");
-  int rc = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &queryStmt, 0);
-  if (rc == SQLITE_OK) {
-    if (sqlite3_bind_int64(queryStmt, 1, id) == SQLITE_OK) {
-      rc = sqlite3_step(queryStmt);
-      if (rc == SQLITE_ROW) {
-        auto data = make_shared<Data>();
-        data->wireDecode(Block(reinterpret_cast<const uint8_t*>(sqlite3_column_blob(queryStmt, 2)),
-                               sqlite3_column_bytes(queryStmt, 2)));
-        sqlite3_finalize(queryStmt);
-        return data;
-      }
-      else if (rc == SQLITE_DONE) {
-        return nullptr;
-      }
-      else {
-        std::cerr << "Database query failure rc:" << rc << std::endl;
-        sqlite3_finalize(queryStmt);
-        BOOST_THROW_EXCEPTION(Error("Database query failure"));
-      }
-    }
-    else {
-      std::cerr << "select bind error" << std::endl;
-      sqlite3_finalize(queryStmt);
-      BOOST_THROW_EXCEPTION(Error("select bind error"));
-    }
-    sqlite3_finalize(queryStmt);
+  Block wire = readWire(id);
+  if (wire.empty())
+    return nullptr;
+  return make_shared<Data>(wire);
+}
+
+Block
+SqliteStorage::readWire(const int64_t id)
+{
+  if (sqlite3_bind_int64(m_readStmt, 1, id) != SQLITE_OK) {
+    std::cerr << "select bind error" << std::endl;
+    sqlite3_reset(m_readStmt);
+    BOOST_THROW_EXCEPTION(Error("select bind error"));
   }
-  else {
-    sqlite3_finalize(queryStmt);
-    std::cerr << "select statement prepared failed" << std::endl;
-    BOOST_THROW_EXCEPTION(Error("select statement prepared failed"));
+
+  int rc = sqlite3_step(m_readStmt);
+  if (rc == SQLITE_ROW) {
+    // the blob is only valid until the statement is reset, so copy it out first
+    auto buffer = make_shared<ndn::Buffer>(sqlite3_column_blob(m_readStmt, 0),
+                                           sqlite3_column_bytes(m_readStmt, 0));
+    sqlite3_reset(m_readStmt);
+    return Block(buffer);
   }
-  return nullptr;
+
+  sqlite3_reset(m_readStmt);
+  if (rc != SQLITE_DONE) {
+    std::cerr << "Database query failure rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Database query failure"));
+  }
+  return Block();
 }
 
 int64_t
 SqliteStorage::size()
 {
-  sqlite3_stmt* queryStmt = 0;
-  string sql("SELECT count(*) FROM NDN_REPO ");
-  int rc = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &queryStmt, 0);
-  if (rc != SQLITE_OK)
-    {
-      std::cerr << "Database query failure rc:" << rc << std::endl;
-      sqlite3_finalize(queryStmt);
-      BOOST_THROW_EXCEPTION(Error("Database query failure"));
-    }
-
-  rc = sqlite3_step(queryStmt);
+  int rc = sqlite3_step(m_sizeStmt);
   if (rc != SQLITE_ROW)
     {
       std::cerr << "Database query failure rc:" << rc << std::endl;
-      sqlite3_finalize(queryStmt);
+      sqlite3_reset(m_sizeStmt);
       BOOST_THROW_EXCEPTION(Error("Database query failure"));
     }
 
-  int64_t nDatas = sqlite3_column_int64(queryStmt, 0);
+  int64_t nDatas = sqlite3_column_int64(m_sizeStmt, 0);
+  sqlite3_reset(m_sizeStmt);
   if (m_size != nDatas) {
     std::cerr << "The size of database is not correct! " << std::endl;
   }
   return nDatas;
 }
 
+void
+SqliteStorage::beginTransaction()
+{
+  if (m_transactionDepth++ > 0)
+    return;
+
+  int rc = sqlite3_step(m_beginStmt);
+  sqlite3_reset(m_beginStmt);
+  if (rc != SQLITE_DONE) {
+    m_transactionDepth = 0;
+    std::cerr << "Begin transaction failure rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Begin transaction failure"));
+  }
+}
+
+void
+SqliteStorage::commitTransaction()
+{
+  BOOST_ASSERT(m_transactionDepth > 0);
+  if (--m_transactionDepth > 0)
+    return;
+
+  int rc = sqlite3_step(m_commitStmt);
+  sqlite3_reset(m_commitStmt);
+  if (rc != SQLITE_DONE) {
+    std::cerr << "Commit transaction failure rc:" << rc << std::endl;
+    BOOST_THROW_EXCEPTION(Error("Commit transaction failure"));
+  }
+}
+
 } // namespace repo
@@ -61,6 +61,14 @@ public:
   virtual int64_t
   insert(const Data& data);
 
+  /**
+   *  @brief  put a batch of data into database in one transaction
+   *  @return the id number of each entry in the order of @p data, or -1 for data not inserted
+   */
+  virtual std::vector<int64_t>
+  insertBatch(const std::vector<shared_ptr<const Data>>& data,
+              const std::vector<ItemMeta>& metas);
+
   /**
    *  @brief  remove the entry in the database by using id
    *  @param  id   id number of each entry in the database
@@ -68,6 +76,16 @@ public:
   virtual bool
   erase(const int64_t id);
 
+  /**
+   *  @brief  remove the entries with the given ids in one transaction
+   *  @return the number of entries removed
+   *
+   *  The ids are deleted with one statement per ERASE_BATCH_SIZE ids. On error no entry
+   *  is removed and Error is thrown.
+   */
+  virtual size_t
+  eraseBatch(const std::vector<int64_t>& ids);
+
   /**
    *  @brief  get the data from database
    *  @para   id   id number of each entry in the database, used to find the data
@@ -75,6 +93,13 @@ public:
   virtual std::shared_ptr<Data>
   read(const int64_t id);
 
+  /**
+   *  @brief  get the stored wire encoding of data from database
+   *  @return the Data TLV block, or an empty Block if there is no such entry
+   */
+  virtual Block
+  readWire(const int64_t id);
+
   /**
    *  @brief  return the size of database
    */
@@ -88,14 +113,122 @@ public:
   void
   fullEnumerate(const std::function<void(const Storage::ItemMeta)>& f);
 
+  /**
+   *  @brief enumerate the entries whose id is greater than @p lastId, in the order of their ids
+   */
+  virtual void
+  enumerateAfter(int64_t lastId, const std::function<void(const Storage::ItemMeta)>& f);
+
+  /**
+   *  @brief read every entry in database on @p nThreads threads
+   *
+   *  The id range is split evenly between the threads.  Each thread reads its part
+   *  through its own read-only connection and sorts it by name.
+   */
+  virtual std::vector<std::vector<ItemMeta>>
+  readSortedRuns(size_t nThreads);
+
+  /**
+   *  @brief  return the largest id in the database, or 0 if it is empty
+   */
+  virtual int64_t
+  getMaxId();
+
+  /**
+   *  @brief  return the number of entries ever deleted from the database
+   *
+   *  The count is kept in the database along with the deletions, so it is read without
+   *  scanning the entries.
+   */
+  virtual int64_t
+  getNDeleted();
+
+  /**
+   *  @brief  start grouping the following operations into one transaction
+   *
+   *  Nested calls only increase the nesting depth.
+   */
+  virtual void
+  beginTransaction();
+
+  /**
+   *  @brief  commit the transaction when the outermost transaction ends
+   */
+  virtual void
+  commitTransaction();
+
 private:
   void
   initializeRepo();
 
+  /**
+   *  @brief  create the table counting the deleted entries and the trigger maintaining it,
+   *          unless the database has them already
+   *
+   *  A database from before the count was kept has its entries counted once.
+   */
+  void
+  initializeDeletionCount();
+
+  /**
+   *  @brief  return the number of entries ever inserted, i.e. the last id given out
+   */
+  int64_t
+  getNInserted();
+
+  /**
+   *  @brief  put the data into database, with its full name and keyLocator hash already computed
+   */
+  int64_t
+  insert(const Data& data, const Name& fullName, const ndn::ConstBufferPtr& keyLocatorHash);
+
+  /**
+   *  @brief prepare the statements used by insert, erase, read and size
+   *
+   *  The statements are prepared once per connection, and reset and rebound on each call.
+   */
+  void
+  prepareStatements();
+
+  sqlite3_stmt*
+  prepareStatement(const std::string& sql);
+
+  /**
+   *  @brief run a statement that returns no rows, throwing Error on failure
+   */
+  void
+  executeSql(const char* sql);
+
+  static std::string
+  makeEraseBatchSql(size_t nIds);
+
+  /**
+   *  @brief read the entries with ids in [@p firstId, @p endId) through a new read-only
+   *         connection, and sort them by name
+   */
+  void
+  readRun(int64_t firstId, int64_t endId, std::vector<ItemMeta>& run) const;
+
+public:
+  /**
+   *  @brief number of ids deleted by one statement in eraseBatch
+   */
+  static const size_t ERASE_BATCH_SIZE = 256;
+
 private:
   sqlite3* m_db;
   std::string m_dbPath;
   int64_t m_size;
+
+  sqlite3_stmt* m_insertStmt;
+  sqlite3_stmt* m_deleteStmt;
+  sqlite3_stmt* m_deleteBatchStmt;
+  sqlite3_stmt* m_readStmt;
+  sqlite3_stmt* m_sizeStmt;
+  sqlite3_stmt* m_beginStmt;
+  sqlite3_stmt* m_commitStmt;
+
+  int m_transactionDepth;
 };
 
 
@@ -65,6 +65,17 @@ public :
   virtual int64_t
   insert(const Data& data) = 0;
 
+  /**
+   *  @brief  put a batch of data into database in one transaction
+   *  @param  data     the data should be inserted into database
+   *  @param  metas    the full name and keyLocator hash of each data, in the order of @p data;
+   *                   their ids are ignored
+   *  @return the id number of each entry in the order of @p data, or -1 for data not inserted
+   */
+  virtual std::vector<int64_t>
+  insertBatch(const std::vector<shared_ptr<const Data>>& data,
+              const std::vector<ItemMeta>& metas) = 0;
+
   /**
    *  @brief  remove the entry in the database by using id
    *  @param  id   id number of entry in the database
@@ -72,6 +83,13 @@ public :
   virtual bool
   erase(const int64_t id) = 0;
 
+  /**
+   *  @brief  remove the entries with the given ids in one transaction
+   *  @return the number of entries removed
+   */
+  virtual size_t
+  eraseBatch(const std::vector<int64_t>& ids) = 0;
+
   /**
    *  @brief  get the data from database
    *  @param  id   id number of each entry in the database, used to find the data
@@ -79,6 +97,14 @@ public :
   virtual std::shared_ptr<Data>
   read(const int64_t id) = 0;
 
+  /**
+   *  @brief  get the stored wire encoding of data from database
+   *  @param  id   id number of each entry in the database, used to find the data
+   *  @return the Data TLV block, or an empty Block if there is no such entry
+   */
+  virtual Block
+  readWire(const int64_t id) = 0;
+
   /**
    *  @brief  return the size of database
    */
@@ -92,6 +118,49 @@ public :
   virtual void
   fullEnumerate(const std::function<void(const Storage::ItemMeta)>& f) = 0;
 
+  /**
+   *  @brief enumerate the entries whose id is greater than @p lastId, in the order of
+   *         their ids, and call the function on each of them
+   */
+  virtual void
+  enumerateAfter(int64_t lastId, const std::function<void(const Storage::ItemMeta)>& f) = 0;
+
+  /**
+   *  @brief read every entry in database, splitting the work across @p nThreads threads
+   *  @return one run of entries per thread, each run sorted by name
+   */
+  virtual std::vector<std::vector<ItemMeta>>
+  readSortedRuns(size_t nThreads) = 0;
+
+  /**
+   *  @brief  return the largest id in the database, or 0 if it is empty
+   */
+  virtual int64_t
+  getMaxId() = 0;
+
+  /**
+   *  @brief  return the number of entries ever deleted from the database
+   *
+   *  The count is kept in the database along with the deletions, so it is read without
+   *  scanning the entries.
+   */
+  virtual int64_t
+  getNDeleted() = 0;
+
+  /**
+   *  @brief  start grouping the following operations into one transaction
+   *
+   *  Transactions nest: only the outermost commitTransaction() ends the transaction.
+   */
+  virtual void
+  beginTransaction() = 0;
+
+  /**
+   *  @brief  commit the operations issued since the matching beginTransaction()
+   */
+  virtual void
+  commitTransaction() = 0;
+
 };
 
 } // namespace repo
@@ -0,0 +1,267 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Throughput of segmented fetch in WriteHandle over a simulated link with configurable
+// delay and loss, with the congestion window capped at the fixed credit WriteHandle
+// used to have versus the adaptive window; then the aggregate throughput of concurrent
+// inserts sharing the outstanding Interest budget, and how fairly they share it.
+//
+// A link without a capacity never congests, so there the larger window always wins and
+// only random loss makes it back off.  A link with a capacity sends one Data at a time
+// through a drop-tail queue: a window beyond the bandwidth-delay product only fills the
+// queue, and overflowing it loses Data, as a bottleneck does.
+
+#include "handles/write-handle.hpp"
+#include "storage/repo-storage.hpp"
+#include "storage/sqlite-storage.hpp"
+
+#include <ndn-cxx/security/validator-null.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+#include <random>
+
+using namespace ndn::time;
+
+namespace repo {
+namespace tests {
+
+static const size_t N_SEGMENTS = 2000;
+static const size_t N_CONCURRENT = 8;
+static const size_t FIXED_WINDOW = 12;
+static const size_t ADAPTIVE_MAX_WINDOW = 1024;
+static const size_t UNLIMITED_OUTSTANDING = 1000000;
+static const char BENCHMARK_DB_PATH[] = "fetch-benchmark-db";
+static const char BENCHMARK_IDENTITY[] = "/benchmark/identity";
+
+struct Link
+{
+  milliseconds delay;
+  double lossRate;
+  size_t capacity;   ///< Data per second, or 0 for no bottleneck
+  size_t queueSize;  ///< Data that may wait for the link
+};
+
+typedef std::vector<shared_ptr<Data>> Dataset;
+
+static Dataset
+makeDataset(const Name& prefix, size_t nSegments, KeyChain& keyChain)
+{
+  std::vector<uint8_t> content(1000, '-');
+  Dataset dataset;
+  for (size_t i = 0; i < nSegments; ++i) {
+    auto data = make_shared<Data>(Name(prefix).appendSegment(i));
+    data->setContent(content.data(), content.size());
+    data->setFinalBlockId(name::Component::fromSegment(nSegments - 1));
+    keyChain.sign(*data, ndn::signingByIdentity(Name(BENCHMARK_IDENTITY)));
+    dataset.push_back(data);
+  }
+  return dataset;
+}
+
+/**
+ * @brief insert every dataset concurrently
+ * @return the time each insert took to complete, or zero if it did not
+ */
+static std::vector<milliseconds>
+runFetches(const Link& link, size_t maxWindow, size_t maxOutstanding,
+           const std::vector<Dataset>& datasets, KeyChain& keyChain, size_t& nInterests)
+{
+  boost::filesystem::remove_all(BENCHMARK_DB_PATH);
+  boost::asio::io_service ioService;
+  ndn::util::DummyClientFace face(ioService, keyChain, {false, true});
+  Scheduler scheduler(ioService);
+  SqliteStorage store(BENCHMARK_DB_PATH);
+  size_t nTotal = 0;
+  for (const Dataset& dataset : datasets) {
+    nTotal += dataset.size();
+  }
+  RepoStorage repoStorage(nTotal, store);
+  ndn::security::v2::ValidatorNull validator;
+  WriteHandle writeHandle(face, repoStorage, keyChain, scheduler, validator);
+  writeHandle.setMaxWindow(maxWindow);
+  writeHandle.setMaxOutstanding(maxOutstanding);
+  writeHandle.listen("/repo/command");
+
+  // the producer answers after the link delay, unless the Interest or Data is lost; with a
+  // capacity, the Data also waits for the ones queued before it, or is dropped if the
+  // queue is full
+  std::mt19937 generator(1);
+  std::bernoulli_distribution isLost(link.lossRate);
+  nanoseconds transmissionTime = link.capacity > 0 ?
+                                 nanoseconds(seconds(1)) / static_cast<int64_t>(link.capacity) :
+                                 nanoseconds::zero();
+  steady_clock::TimePoint linkFreeTime = steady_clock::now();
+  nInterests = 0;
+  face.onSendInterest.connect([&] (const Interest& interest) {
+      for (const Dataset& dataset : datasets) {
+        if (!dataset.front()->getName().getPrefix(-1).isPrefixOf(interest.getName()))
+          continue;
+        ++nInterests;
+        SegmentNo segment = interest.getName().get(-1).toSegment();
+        if (segment >= dataset.size() || isLost(generator))
+          return;
+
+        steady_clock::TimePoint now = steady_clock::now();
+        nanoseconds queueingTime = std::max(linkFreeTime - now, nanoseconds::zero());
+        if (transmissionTime > nanoseconds::zero() &&
+            queueingTime >= transmissionTime * static_cast<int64_t>(link.queueSize))
+          return;
+        linkFreeTime = now + queueingTime + transmissionTime;
+
+        shared_ptr<Data> data = dataset[segment];
+        scheduler.scheduleEvent(duration_cast<nanoseconds>(link.delay) + queueingTime +
+                                transmissionTime,
+                                [&face, data] { face.receive(*data); });
+        return;
+      }
+    });
+
+  steady_clock::TimePoint start = steady_clock::now();
+  std::vector<milliseconds> durations(datasets.size(), milliseconds::zero());
+  std::vector<size_t> nInserted(datasets.size(), 0);
+  size_t nCompleted = 0;
+  repoStorage.afterDataInsertion.connect([&] (const Name& name) {
+      for (size_t i = 0; i < datasets.size(); ++i) {
+        if (!datasets[i].front()->getName().getPrefix(-1).isPrefixOf(name))
+          continue;
+        if (++nInserted[i] == datasets[i].size()) {
+          durations[i] = duration_cast<milliseconds>(steady_clock::now() - start);
+          if (++nCompleted == datasets.size())
+            ioService.stop();
+        }
+        return;
+      }
+    });
+  scheduler.scheduleEvent(seconds(300), [&ioService] { ioService.stop(); });
+
+  for (const Dataset& dataset : datasets) {
+    RepoCommandParameter parameter;
+    parameter.setName(dataset.front()->getName().getPrefix(-1));
+    parameter.setStartBlockId(0);
+    parameter.setEndBlockId(dataset.size() - 1);
+    Interest command(Name("/repo/command/insert").append(parameter.wireEncode()));
+    keyChain.sign(command);
+    face.receive(command);
+  }
+  ioService.run();
+
+  boost::filesystem::remove_all(BENCHMARK_DB_PATH);
+  return durations;
+}
+
+static double
+getRate(size_t nSegments, milliseconds duration)
+{
+  return nSegments * 1000.0 / std::max<int64_t>(duration.count(), 1);
+}
+
+static void
+runFetch(const std::string& label, const Link& link, size_t maxWindow,
+         const Dataset& dataset, KeyChain& keyChain)
+{
+  size_t nInterests = 0;
+  milliseconds duration = runFetches(link, maxWindow, UNLIMITED_OUTSTANDING, {dataset},
+                                     keyChain, nInterests).front();
+
+  std::cout << label << ": " << dataset.size() << " segments in " << duration.count() << "ms, "
+            << static_cast<uint64_t>(getRate(dataset.size(), duration)) << " segments/s, "
+            << nInterests << " Interests" << std::endl;
+}
+
+/**
+ * @brief report the aggregate throughput of concurrent inserts of the same size, and
+ *        Jain's fairness index of their throughputs (1 when they are all equal)
+ */
+static void
+runConcurrentFetches(const std::string& label, const Link& link, size_t maxOutstanding,
+                     const std::vector<Dataset>& datasets, KeyChain& keyChain)
+{
+  size_t nInterests = 0;
+  std::vector<milliseconds> durations = runFetches(link, ADAPTIVE_MAX_WINDOW, maxOutstanding,
+                                                   datasets, keyChain, nInterests);
+
+  size_t nSegments = 0;
+  milliseconds total = milliseconds::zero();
+  double sum = 0;
+  double sumOfSquares = 0;
+  for (size_t i = 0; i < datasets.size(); ++i) {
+    nSegments += datasets[i].size();
+    total = std::max(total, durations[i]);
+    double rate = durations[i] > milliseconds::zero() ? getRate(datasets[i].size(), durations[i]) : 0;
+    sum += rate;
+    sumOfSquares += rate * rate;
+  }
+  double fairness = sumOfSquares > 0 ? sum * sum / (datasets.size() * sumOfSquares) : 0;
+
+  std::cout << label << ": " << nSegments << " segments in " << total.count() << "ms, "
+            << static_cast<uint64_t>(getRate(nSegments, total)) << " segments/s, "
+            << nInterests << " Interests, fairness " << fairness << std::endl;
+}
+
+void
+runBenchmarks()
+{
+  KeyChain keyChain("pib-memory:", "tpm-memory:");
+  // storage needs a KeyLocator to hash, which a bare SHA-256 digest signature lacks
+  keyChain.createIdentity(BENCHMARK_IDENTITY);
+  Dataset dataset = makeDataset("/benchmark/fetch", N_SEGMENTS, keyChain);
+
+  // the bottleneck has a bandwidth-delay product of 100 Data
+  std::vector<Link> links{{milliseconds(10), 0.0, 0, 0}, {milliseconds(50), 0.0, 0, 0},
+                          {milliseconds(50), 0.01, 0, 0}, {milliseconds(50), 0.05, 0, 0},
+                          {milliseconds(50), 0.0, 2000, 50}};
+  auto printLink = [] (const Link& link) {
+    std::cout << "delay " << link.delay.count() << "ms, loss " << link.lossRate * 100 << "%";
+    if (link.capacity > 0)
+      std::cout << ", bottleneck of " << link.capacity << " Data/s with a queue of "
+                << link.queueSize;
+    std::cout << std::endl;
+  };
+  for (const Link& link : links) {
+    printLink(link);
+    runFetch("  window capped at 12", link, FIXED_WINDOW, dataset, keyChain);
+    runFetch("  adaptive window", link, ADAPTIVE_MAX_WINDOW, dataset, keyChain);
+  }
+
+  std::vector<Dataset> datasets;
+  for (size_t i = 0; i < N_CONCURRENT; ++i) {
+    datasets.push_back(makeDataset(Name("/benchmark/concurrent").appendNumber(i),
+                                   N_SEGMENTS / 4, keyChain));
+  }
+  for (const Link& link : links) {
+    std::cout << N_CONCURRENT << " concurrent inserts, ";
+    printLink(link);
+    runConcurrentFetches("  unlimited budget", link, UNLIMITED_OUTSTANDING, datasets, keyChain);
+    runConcurrentFetches("  budget of 64 Interests", link, 64, datasets, keyChain);
+  }
+}
+
+} // namespace tests
+} // namespace repo
+
+int
+main(int argc, char** argv)
+{
+  repo::tests::runBenchmarks();
+
+  return 0;
+}
@@ -0,0 +1,203 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Memory use and operation cost of Index, compared with the std::set<Index::Entry>
+// container Index used before it was changed to a name tree.
+//
+// usage: index-benchmark [nEntries...]   (default: 1000000 10000000)
+
+#include "storage/index.hpp"
+
+#include <ndn-cxx/encoding/buffer.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <set>
+
+using namespace ndn::time;
+
+// heap usage is tracked by replacing the global allocation functions
+static size_t g_nAllocatedBytes = 0;
+
+void*
+operator new(size_t size)
+{
+  void* block = std::malloc(size + sizeof(std::max_align_t));
+  if (block == nullptr)
+    throw std::bad_alloc();
+  *static_cast<size_t*>(block) = size;
+  g_nAllocatedBytes += size;
+  return static_cast<char*>(block) + sizeof(std::max_align_t);
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  if (ptr == nullptr)
+    return;
+  void* block = static_cast<char*>(ptr) - sizeof(std::max_align_t);
+  g_nAllocatedBytes -= *static_cast<size_t*>(block);
+  std::free(block);
+}
+
+namespace repo {
+namespace tests {
+
+/**
+ * @brief the std::set based index, kept as the baseline to compare against
+ */
+class SetIndex : noncopyable
+{
+public:
+  bool
+  insert(const Name& fullName, int64_t id, const ndn::ConstBufferPtr& keyLocatorHash)
+  {
+    return m_entries.insert(Index::Entry(fullName, keyLocatorHash, id)).second;
+  }
+
+  std::pair<int64_t, Name>
+  find(const Name& name) const
+  {
+    auto it = m_entries.lower_bound(name);
+    if (it == m_entries.end() || !name.isPrefixOf(it->getName()))
+      return std::make_pair(0, Name());
+    return std::make_pair(it->getId(), it->getName());
+  }
+
+  bool
+  hasData(const Name& fullName) const
+  {
+    return m_entries.find(fullName) != m_entries.end();
+  }
+
+  bool
+  erase(const Name& fullName)
+  {
+    return m_entries.erase(fullName) > 0;
+  }
+
+private:
+  std::set<Index::Entry> m_entries;
+};
+
+/**
+ * @return the name of the i-th segment of the dataset, e.g. /benchmark/index/stream7/%FD%01/%00%05
+ *
+ * The dataset consists of 1000-segment versioned objects under a few hundred streams,
+ * which is how a repo is typically filled by ndnputfile.
+ */
+static Name
+makePrefix(size_t i)
+{
+  return Name("/benchmark/index")
+    .append(name::Component("stream" + std::to_string(i / 1000 % 256)))
+    .appendVersion(i / 1000)
+    .appendSegment(i % 1000);
+}
+
+static Name
+makeFullName(size_t i)
+{
+  auto digest = make_shared<ndn::Buffer>(32);
+  std::copy_n(reinterpret_cast<const uint8_t*>(&i), sizeof(i), digest->begin());
+  return makePrefix(i).append(name::Component::fromImplicitSha256Digest(digest));
+}
+
+static void
+report(const std::string& what, steady_clock::TimePoint start, size_t nOperations)
+{
+  microseconds duration = duration_cast<microseconds>(steady_clock::now() - start);
+  std::cout << "  " << what << ": " << nOperations << " ops cost " << duration.count() / 1000
+            << "ms, " << static_cast<double>(duration.count()) / nOperations << "us/op"
+            << std::endl;
+}
+
+template<class IndexType>
+void
+runOperations(const std::string& label, IndexType& index, size_t nEntries)
+{
+  std::cout << label << std::endl;
+  auto keyLocatorHash = make_shared<ndn::Buffer>(32);
+
+  size_t nBytesBefore = g_nAllocatedBytes;
+  steady_clock::TimePoint start = steady_clock::now();
+  for (size_t i = 0; i < nEntries; ++i) {
+    index.insert(makeFullName(i), i + 1, keyLocatorHash);
+  }
+  report("insert", start, nEntries);
+  std::cout << "  memory: " << (g_nAllocatedBytes - nBytesBefore) / 1024 / 1024 << " MiB, "
+            << (g_nAllocatedBytes - nBytesBefore) / nEntries << " bytes/entry" << std::endl;
+
+  start = steady_clock::now();
+  for (size_t i = 0; i < nEntries; ++i) {
+    index.hasData(makeFullName(i));
+  }
+  report("exact lookup", start, nEntries);
+
+  start = steady_clock::now();
+  for (size_t i = 0; i < nEntries; ++i) {
+    index.find(makePrefix(i));
+  }
+  report("prefix lookup", start, nEntries);
+
+  start = steady_clock::now();
+  for (size_t i = 0; i < nEntries; ++i) {
+    index.erase(makeFullName(i));
+  }
+  report("erase", start, nEntries);
+}
+
+void
+runBenchmarks(const std::vector<size_t>& sizes)
+{
+  for (size_t nEntries : sizes) {
+    std::cout << "=== " << nEntries << " entries ===" << std::endl;
+    {
+      SetIndex index;
+      runOperations("std::set<Index::Entry>", index, nEntries);
+    }
+    {
+      Index index(nEntries);
+      runOperations("Index", index, nEntries);
+    }
+  }
+}
+
+} // namespace tests
+} // namespace repo
+
+int
+main(int argc, char** argv)
+{
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(boost::lexical_cast<size_t>(argv[i]));
+  }
+  if (sizes.empty()) {
+    sizes = {1000000, 10000000};
+  }
+
+  repo::tests::runBenchmarks(sizes);
+
+  return 0;
+}
@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Read throughput of RepoStorage when serving Interests: decoding the stored Data
+// and taking its wire encoding (what the face used to be given) versus handing out
+// the stored wire block directly; then the decode of the stored wire alone, which
+// Face::put still needs a Data for, and ReadHandle end to end through a face.
+
+#include "handles/read-handle.hpp"
+#include "repo.hpp"
+#include "storage/repo-storage.hpp"
+#include "storage/sqlite-storage.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+
+using namespace ndn::time;
+
+namespace repo {
+namespace tests {
+
+static const size_t N_PACKETS = 10000;
+static const size_t N_ROUNDS = 10;
+static const char BENCHMARK_DB_PATH[] = "read-benchmark-db";
+
+static void
+report(const std::string& what, steady_clock::TimePoint start, size_t nReads, size_t nBytes)
+{
+  microseconds duration = duration_cast<microseconds>(steady_clock::now() - start);
+  double seconds = static_cast<double>(duration.count()) / 1000000;
+  std::cout << what << ": " << nReads << " reads cost " << duration.count() / 1000 << "ms, "
+            << static_cast<uint64_t>(nReads / seconds) << " packets/s, "
+            << static_cast<uint64_t>(nBytes / seconds / 1024 / 1024) << " MiB/s" << std::endl;
+}
+
+void
+runBenchmarks()
+{
+  boost::filesystem::remove_all(BENCHMARK_DB_PATH);
+  {
+    SqliteStorage store(BENCHMARK_DB_PATH);
+    RepoStorage repoStorage(N_PACKETS, store);
+
+    KeyChain keyChain("pib-memory:", "tpm-memory:");
+    Name identity("/benchmark/identity");
+    keyChain.createIdentity(identity);
+
+    std::vector<uint8_t> content(4000, '-');
+    std::vector<Interest> interests;
+    for (size_t i = 0; i < N_PACKETS; ++i) {
+      Data data(Name("/benchmark/read").appendSegment(i));
+      data.setContent(content.data(), content.size());
+      keyChain.sign(data, ndn::signingByIdentity(identity));
+      repoStorage.insertData(data);
+      interests.push_back(Interest(data.getName()));
+    }
+
+    size_t nBytes = 0;
+    steady_clock::TimePoint start = steady_clock::now();
+    for (size_t round = 0; round < N_ROUNDS; ++round) {
+      for (const Interest& interest : interests) {
+        shared_ptr<Data> data = repoStorage.readData(interest);
+        nBytes += data->wireEncode().size();
+      }
+    }
+    report("decoded Data", start, N_ROUNDS * interests.size(), nBytes);
+
+    nBytes = 0;
+    start = steady_clock::now();
+    for (size_t round = 0; round < N_ROUNDS; ++round) {
+      for (const Interest& interest : interests) {
+        nBytes += repoStorage.readWire(interest).size();
+      }
+    }
+    report("stored wire", start, N_ROUNDS * interests.size(), nBytes);
+
+    nBytes = 0;
+    start = steady_clock::now();
+    for (size_t round = 0; round < N_ROUNDS; ++round) {
+      for (const Interest& interest : interests) {
+        Data data(repoStorage.readWire(interest));
+        nBytes += data.wireEncode().size();
+      }
+    }
+    report("stored wire decoded for Face::put", start, N_ROUNDS * interests.size(), nBytes);
+
+    boost::asio::io_service ioService;
+    ndn::util::DummyClientFace face(ioService, keyChain, {false, true});
+    Scheduler scheduler(ioService);
+    ReadHandle readHandle(face, repoStorage, keyChain, scheduler,
+                          RepoConfig::DISABLED_SUBSET_LENGTH);
+    readHandle.listen("/benchmark/read");
+    ioService.poll();
+    size_t nData = 0;
+    nBytes = 0;
+    face.onSendData.connect([&] (const Data& data) {
+        ++nData;
+        nBytes += data.wireEncode().size();
+      });
+    start = steady_clock::now();
+    for (size_t round = 0; round < N_ROUNDS; ++round) {
+      for (const Interest& interest : interests) {
+        face.receive(interest);
+      }
+      ioService.poll();
+    }
+    report("ReadHandle through a face", start, nData, nBytes);
+  }
+  boost::filesystem::remove_all(BENCHMARK_DB_PATH);
+}
+
+} // namespace tests
+} // namespace repo
+
+int
+main(int argc, char** argv)
+{
+  repo::tests::runBenchmarks();
+
+  return 0;
+}
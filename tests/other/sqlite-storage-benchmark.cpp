@@ -0,0 +1,227 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Per-operation cost of SqliteStorage insert/read/erase/size, compared with the
+// prepare-per-call pattern SqliteStorage used before statements were cached; then the
+// time to rebuild the index from the database on different numbers of threads.
+
+#include "storage/index.hpp"
+#include "storage/repo-storage.hpp"
+#include "storage/sqlite-storage.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+
+using namespace ndn::time;
+
+namespace repo {
+namespace tests {
+
+static const size_t N_PACKETS = 10000;
+static const char BENCHMARK_DB_PATH[] = "sqlite-storage-benchmark-db";
+
+static std::vector<shared_ptr<Data>>
+makeDataset(size_t nPackets)
+{
+  KeyChain keyChain("pib-memory:", "tpm-memory:");
+  Name identity("/benchmark/identity");
+  keyChain.createIdentity(identity);
+
+  std::vector<uint8_t> content(1500, '-');
+  std::vector<shared_ptr<Data>> dataset;
+  for (size_t i = 0; i < nPackets; ++i) {
+    auto data = make_shared<Data>(Name("/benchmark/sqlite").appendSegment(i));
+    data->setContent(content.data(), content.size());
+    keyChain.sign(*data, ndn::signingByIdentity(identity));
+    data->wireEncode();
+    dataset.push_back(data);
+  }
+  return dataset;
+}
+
+static void
+report(const std::string& what, steady_clock::TimePoint start, size_t nOperations)
+{
+  microseconds duration = duration_cast<microseconds>(steady_clock::now() - start);
+  std::cout << what << ": " << nOperations << " ops cost " << duration.count() / 1000 << "ms, "
+            << static_cast<double>(duration.count()) / nOperations << "us/op" << std::endl;
+}
+
+/**
+ * @brief the per-call prepare/finalize pattern, kept as the baseline to compare against
+ */
+class OneShotStatements : noncopyable
+{
+public:
+  explicit
+  OneShotStatements(const std::string& dbPath)
+  {
+    sqlite3_open_v2(dbPath.c_str(), &m_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, 0);
+    sqlite3_exec(m_db, "CREATE TABLE NDN_REPO ("
+                       "id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+                       "name BLOB, "
+                       "data BLOB, "
+                       "keylocatorHash BLOB);", 0, 0, 0);
+    sqlite3_exec(m_db, "PRAGMA synchronous = OFF", 0, 0, 0);
+    sqlite3_exec(m_db, "PRAGMA journal_mode = WAL", 0, 0, 0);
+  }
+
+  ~OneShotStatements()
+  {
+    sqlite3_close(m_db);
+  }
+
+  int64_t
+  insert(const Data& data)
+  {
+    Index::Entry entry(data, 0);
+    sqlite3_stmt* stmt = 0;
+    sqlite3_prepare_v2(m_db, "INSERT INTO NDN_REPO (id, name, data, keylocatorHash) "
+                             "VALUES (?, ?, ?, ?)", -1, &stmt, 0);
+    sqlite3_bind_null(stmt, 1);
+    sqlite3_bind_blob(stmt, 2, entry.getName().wireEncode().wire(),
+                      entry.getName().wireEncode().size(), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 3, data.wireEncode().wire(), data.wireEncode().size(), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 4, entry.getKeyLocatorHash()->data(),
+                      entry.getKeyLocatorHash()->size(), SQLITE_STATIC);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return sqlite3_last_insert_rowid(m_db);
+  }
+
+  shared_ptr<Data>
+  read(int64_t id)
+  {
+    shared_ptr<Data> data;
+    sqlite3_stmt* stmt = 0;
+    sqlite3_prepare_v2(m_db, "SELECT * FROM NDN_REPO WHERE id = ? ;", -1, &stmt, 0);
+    sqlite3_bind_int64(stmt, 1, id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      data = make_shared<Data>();
+      data->wireDecode(Block(reinterpret_cast<const uint8_t*>(sqlite3_column_blob(stmt, 2)),
+                             sqlite3_column_bytes(stmt, 2)));
+    }
+    sqlite3_finalize(stmt);
+    return data;
+  }
+
+  int64_t
+  size()
+  {
+    sqlite3_stmt* stmt = 0;
+    sqlite3_prepare_v2(m_db, "SELECT count(*) FROM NDN_REPO ", -1, &stmt, 0);
+    sqlite3_step(stmt);
+    int64_t nDatas = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+    return nDatas;
+  }
+
+  bool
+  erase(int64_t id)
+  {
+    sqlite3_stmt* stmt = 0;
+    sqlite3_prepare_v2(m_db, "DELETE from NDN_REPO where id = ?;", -1, &stmt, 0);
+    sqlite3_bind_int64(stmt, 1, id);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    return sqlite3_changes(m_db) == 1;
+  }
+
+private:
+  sqlite3* m_db;
+};
+
+template<class Store>
+void
+runOperations(const std::string& label, Store& store,
+              const std::vector<shared_ptr<Data>>& dataset)
+{
+  std::vector<int64_t> ids;
+  ids.reserve(dataset.size());
+
+  steady_clock::TimePoint start = steady_clock::now();
+  for (const auto& data : dataset) {
+    ids.push_back(store.insert(*data));
+  }
+  report(label + " insert", start, dataset.size());
+
+  start = steady_clock::now();
+  for (int64_t id : ids) {
+    store.read(id);
+  }
+  report(label + " read", start, ids.size());
+
+  start = steady_clock::now();
+  for (size_t i = 0; i < ids.size(); ++i) {
+    store.size();
+  }
+  report(label + " size", start, ids.size());
+
+  start = steady_clock::now();
+  for (int64_t id : ids) {
+    store.erase(id);
+  }
+  report(label + " erase", start, ids.size());
+}
+
+void
+runBenchmarks()
+{
+  std::vector<shared_ptr<Data>> dataset = makeDataset(N_PACKETS);
+
+  boost::filesystem::remove_all(BENCHMARK_DB_PATH);
+  boost::filesystem::create_directory(BENCHMARK_DB_PATH);
+  {
+    OneShotStatements store(std::string(BENCHMARK_DB_PATH) + "/one-shot.db");
+    runOperations("one-shot statements", store, dataset);
+  }
+  {
+    SqliteStorage store(BENCHMARK_DB_PATH);
+    runOperations("cached statements", store, dataset);
+  }
+  {
+    SqliteStorage store(BENCHMARK_DB_PATH);
+    for (const auto& data : dataset) {
+      store.insert(*data);
+    }
+    // one thread enumerates the database; more read sorted runs that one thread merges
+    for (size_t nThreads : {1, 2, 4, 8}) {
+      RepoStorage repoStorage(dataset.size(), store);
+      repoStorage.setRebuildThreads(nThreads);
+      steady_clock::TimePoint start = steady_clock::now();
+      repoStorage.initialize();
+      report("index rebuild on " + std::to_string(nThreads) + " threads", start, dataset.size());
+    }
+  }
+  boost::filesystem::remove_all(BENCHMARK_DB_PATH);
+}
+
+} // namespace tests
+} // namespace repo
+
+int
+main(int argc, char** argv)
+{
+  repo::tests::runBenchmarks();
+
+  return 0;
+}
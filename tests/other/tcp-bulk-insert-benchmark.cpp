@@ -0,0 +1,168 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Throughput of TCP bulk insert over loopback: the sender writes the whole dataset in
+// large writes, and the repo receives it with the smallest buffer the handle accepts
+// (about the single-packet buffer it used to have) versus large receive buffers that
+// decode many packets per read in place; then decoding on one worker thread versus one
+// per hardware thread, and TCP loopback versus a Unix stream socket.
+
+#include "handles/tcp-bulk-insert-handle.hpp"
+#include "storage/repo-storage.hpp"
+#include "storage/sqlite-storage.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <iostream>
+
+using namespace ndn::time;
+
+namespace repo {
+namespace tests {
+
+static const size_t N_PACKETS = 20000;
+static const size_t GROUP_COMMIT_SIZE = 512;
+static const char BENCHMARK_DB_PATH[] = "tcp-bulk-insert-benchmark-db";
+static const char BENCHMARK_HOST[] = "127.0.0.1";
+static const char BENCHMARK_PORT[] = "17377";
+static const char BENCHMARK_SOCKET_PATH[] = "tcp-bulk-insert-benchmark.sock";
+
+/**
+ * @brief the wire encodings of the dataset, back to back as the sender writes them
+ */
+static std::vector<uint8_t>
+makeStream(size_t nPackets)
+{
+  KeyChain keyChain("pib-memory:", "tpm-memory:");
+  Name identity("/benchmark/identity");
+  keyChain.createIdentity(identity);
+
+  std::vector<uint8_t> content(1000, '-');
+  std::vector<uint8_t> stream;
+  for (size_t i = 0; i < nPackets; ++i) {
+    Data data(Name("/benchmark/tcp-bulk-insert").appendSegment(i));
+    data.setContent(content.data(), content.size());
+    keyChain.sign(data, ndn::signingByIdentity(identity));
+    const Block& wire = data.wireEncode();
+    stream.insert(stream.end(), wire.begin(), wire.end());
+  }
+  return stream;
+}
+
+static void
+listenOn(TcpBulkInsertHandle& handle, const boost::asio::ip::tcp::endpoint& endpoint)
+{
+  handle.listen(endpoint.address().to_string(), std::to_string(endpoint.port()));
+}
+
+static void
+listenOn(TcpBulkInsertHandle& handle, const boost::asio::local::stream_protocol::endpoint& endpoint)
+{
+  handle.listenLocal(endpoint.path());
+}
+
+template<class Protocol>
+void
+runInsert(const std::string& label, const typename Protocol::endpoint& endpoint,
+          size_t bufferSize, size_t nWorkers, const std::vector<uint8_t>& stream, size_t nPackets)
+{
+  using namespace boost::asio;
+
+  boost::filesystem::remove_all(BENCHMARK_DB_PATH);
+  {
+    io_service ioService;
+    Scheduler scheduler(ioService);
+    SqliteStorage store(BENCHMARK_DB_PATH);
+    RepoStorage repoStorage(nPackets, store);
+    repoStorage.enableGroupCommit(scheduler, GROUP_COMMIT_SIZE, milliseconds(10));
+
+    TcpBulkInsertHandle handle(ioService, repoStorage, nWorkers);
+    handle.setBufferSize(bufferSize);
+    listenOn(handle, endpoint);
+
+    size_t nInserted = 0;
+    repoStorage.afterDataInsertion.connect([&] (const Name&) {
+        if (++nInserted == nPackets)
+          ioService.stop();
+      });
+
+    typename Protocol::socket socket(ioService);
+    steady_clock::TimePoint start = steady_clock::now();
+    socket.async_connect(endpoint, [&] (const boost::system::error_code& error) {
+        if (error) {
+          std::cerr << "Cannot connect: " << error.message() << std::endl;
+          ioService.stop();
+          return;
+        }
+        async_write(socket, buffer(stream), [] (const boost::system::error_code&, size_t) {});
+      });
+    scheduler.scheduleEvent(seconds(60), [&] {
+        std::cerr << label << ": timed out" << std::endl;
+        ioService.stop();
+      });
+    ioService.run();
+
+    microseconds duration = duration_cast<microseconds>(steady_clock::now() - start);
+    double seconds = static_cast<double>(duration.count()) / 1000000;
+    std::cout << label << " (" << handle.getBufferSize() << " byte buffer, "
+              << handle.getPipeline().getNWorkers() << " workers): "
+              << nInserted << " packets cost " << duration.count() / 1000 << "ms, "
+              << static_cast<uint64_t>(nInserted / seconds) << " packets/s, "
+              << static_cast<uint64_t>(stream.size() / seconds / 1024 / 1024) << " MiB/s"
+              << std::endl;
+
+    boost::system::error_code error;
+    socket.close(error);
+    handle.stop();
+  }
+  boost::filesystem::remove_all(BENCHMARK_DB_PATH);
+}
+
+void
+runBenchmarks()
+{
+  std::vector<uint8_t> stream = makeStream(N_PACKETS);
+  std::cout << N_PACKETS << " packets, " << stream.size() << " bytes" << std::endl;
+
+  using namespace boost::asio;
+  ip::tcp::endpoint tcpEndpoint(ip::address::from_string(BENCHMARK_HOST),
+                                static_cast<unsigned short>(std::stoi(BENCHMARK_PORT)));
+  local::stream_protocol::endpoint localEndpoint(BENCHMARK_SOCKET_PATH);
+
+  runInsert<ip::tcp>("smallest buffer", tcpEndpoint, 0, 1, stream, N_PACKETS);
+  runInsert<ip::tcp>("large buffer", tcpEndpoint, 1024 * 1024, 1, stream, N_PACKETS);
+  runInsert<ip::tcp>("large buffer", tcpEndpoint, 8 * 1024 * 1024, 1, stream, N_PACKETS);
+  runInsert<ip::tcp>("large buffer, worker pool", tcpEndpoint, 1024 * 1024, 0, stream, N_PACKETS);
+  runInsert<local::stream_protocol>("Unix socket, worker pool", localEndpoint, 1024 * 1024, 0,
+                                    stream, N_PACKETS);
+}
+
+} // namespace tests
+} // namespace repo
+
+int
+main(int argc, char** argv)
+{
+  repo::tests::runBenchmarks();
+
+  return 0;
+}
@@ -0,0 +1,136 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "handles/block-stream-buffer.hpp"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestBlockStreamBuffer)
+
+static Block
+makeElement(size_t valueSize)
+{
+  std::vector<uint8_t> value(valueSize, 'x');
+  return ndn::makeBinaryBlock(ndn::tlv::Content, value.data(), value.size());
+}
+
+static void
+receive(BlockStreamBuffer& buffer, const uint8_t* bytes, size_t nBytes)
+{
+  buffer.prepare();
+  BOOST_REQUIRE_GE(buffer.getFreeSize(), nBytes);
+  std::memcpy(buffer.getFreeSpace(), bytes, nBytes);
+  buffer.commit(nBytes);
+}
+
+BOOST_AUTO_TEST_CASE(SeveralElementsPerReceive)
+{
+  BlockStreamBuffer buffer(0);
+  BOOST_CHECK_EQUAL(buffer.getChunkSize(), BlockStreamBuffer::MIN_CHUNK_SIZE);
+
+  Block first = makeElement(100);
+  Block second = makeElement(2000);
+  std::vector<uint8_t> stream(first.begin(), first.end());
+  stream.insert(stream.end(), second.begin(), second.end());
+
+  // the second element is split across two receives
+  receive(buffer, stream.data(), first.size() + 10);
+  Block element;
+  BOOST_REQUIRE(buffer.next(element));
+  BOOST_CHECK(element == first);
+  BOOST_CHECK(!buffer.next(element));
+  BOOST_CHECK_EQUAL(buffer.getPendingSize(), 10);
+
+  receive(buffer, stream.data() + first.size() + 10, second.size() - 10);
+  BOOST_REQUIRE(buffer.next(element));
+  BOOST_CHECK(element == second);
+  BOOST_CHECK_EQUAL(buffer.getPendingSize(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SharedChunk)
+{
+  BlockStreamBuffer buffer(0);
+  Block packet = makeElement(1000);
+  std::vector<uint8_t> stream;
+  for (int i = 0; i < 3; ++i) {
+    stream.insert(stream.end(), packet.begin(), packet.end());
+  }
+  receive(buffer, stream.data(), stream.size());
+
+  Block a, b;
+  BOOST_REQUIRE(buffer.next(a));
+  BOOST_REQUIRE(buffer.next(b));
+  // both elements point into the same receive chunk
+  BOOST_CHECK_EQUAL(b.wire(), a.wire() + a.size());
+}
+
+BOOST_AUTO_TEST_CASE(RecycleOrReplace)
+{
+  BlockStreamBuffer buffer(0);
+  Block packet = makeElement(BlockStreamBuffer::MAX_ELEMENT_SIZE - 4);
+  BOOST_REQUIRE_EQUAL(packet.size(), BlockStreamBuffer::MAX_ELEMENT_SIZE);
+
+  // the chunk holds two maximum size packets; the third one starts a new chunk
+  receive(buffer, packet.wire(), packet.size());
+  receive(buffer, packet.wire(), packet.size());
+  Block held;
+  BOOST_REQUIRE(buffer.next(held));
+  Block element;
+  BOOST_REQUIRE(buffer.next(element));
+  element = Block();
+
+  // a held element keeps its bytes while the rest of the stream moves to a new chunk
+  receive(buffer, packet.wire(), 100);
+  BOOST_CHECK(held == packet);
+  receive(buffer, packet.wire() + 100, packet.size() - 100);
+  BOOST_REQUIRE(buffer.next(element));
+  BOOST_CHECK(element == packet);
+  BOOST_CHECK(held.wire() != element.wire());
+
+  // once nothing references the chunk, it is reused from the start
+  const uint8_t* start = element.wire();
+  held = Block();
+  element = Block();
+  buffer.prepare();
+  BOOST_CHECK_EQUAL(buffer.getFreeSpace(), start);
+  BOOST_CHECK_EQUAL(buffer.getFreeSize(), buffer.getChunkSize());
+}
+
+BOOST_AUTO_TEST_CASE(Oversized)
+{
+  BlockStreamBuffer buffer(0);
+  Block packet = makeElement(BlockStreamBuffer::MAX_ELEMENT_SIZE);
+  receive(buffer, packet.wire(), 10);
+
+  Block element;
+  BOOST_CHECK_THROW(buffer.next(element), BlockStreamBuffer::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "handles/bulk-insert-pipeline.hpp"
+#include "storage/sqlite-storage.hpp"
+#include "../repo-storage-fixture.hpp"
+#include "../dataset-fixtures.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestBulkInsertPipeline)
+
+template<class Dataset>
+class Fixture : public Dataset, public RepoStorageFixture
+{
+public:
+  Fixture()
+    : work(new boost::asio::io_service::work(ioService))
+    , pipeline(ioService, *handle, 3)
+    , nInserted(0)
+    , nFailed(0)
+    , nElements(0)
+  {
+  }
+
+  void
+  onInserted(const std::vector<shared_ptr<const Data>>& data, const std::vector<bool>& isInserted,
+             size_t nBatchElements)
+  {
+    BOOST_REQUIRE_EQUAL(data.size(), isInserted.size());
+    nInserted += std::count(isInserted.begin(), isInserted.end(), true);
+    nFailed += std::count(isInserted.begin(), isInserted.end(), false);
+    nElements += nBatchElements;
+    if (pipeline.getNPending() == 0)
+      work.reset();
+  }
+
+public:
+  boost::asio::io_service ioService;
+  unique_ptr<boost::asio::io_service::work> work;
+  BulkInsertPipeline pipeline;
+  size_t nInserted;
+  size_t nFailed;
+  size_t nElements;
+};
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(InsertAndRead, T, CommonDatasets, Fixture<T>)
+{
+  BOOST_TEST_MESSAGE(T::getName());
+
+  auto callback = bind(&Fixture<T>::onInserted, this, _1, _2, std::placeholders::_3);
+  std::vector<Block> batch;
+  for (const auto& data : this->data) {
+    batch.push_back(data->wireEncode());
+    if (batch.size() == 3) {
+      this->pipeline.submit(std::move(batch), callback);
+      batch.clear();
+    }
+  }
+  // the rest, an element that is not a valid Data, and a repeated one
+  batch.push_back(ndn::makeEmptyBlock(ndn::tlv::Data));
+  batch.push_back(this->data.front()->wireEncode());
+  this->pipeline.submit(std::move(batch), callback);
+  BOOST_CHECK_EQUAL(this->pipeline.getNPending(), this->data.size() + 2);
+
+  this->ioService.run();
+
+  BOOST_CHECK_EQUAL(this->pipeline.getNPending(), 0);
+  BOOST_CHECK_EQUAL(this->nElements, this->data.size() + 2);
+  BOOST_CHECK_EQUAL(this->nInserted, this->data.size());
+  BOOST_CHECK_EQUAL(this->nFailed, 1);
+  for (const auto& interest : this->interests) {
+    BOOST_CHECK_EQUAL(*this->handle->readData(interest.first), *interest.second);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(StorageError, Fixture<SamePrefixDataset<10>>)
+{
+  // a full repo without eviction policy fails what does not fit, and stores nothing more
+  RepoStorage bounded(4, *store);
+  BulkInsertPipeline boundedPipeline(ioService, bounded, 1);
+  size_t nBoundedInserted = 0;
+  size_t nBoundedElements = 0;
+  std::vector<Block> batch;
+  for (const auto& data : this->data) {
+    batch.push_back(data->wireEncode());
+  }
+  boundedPipeline.submit(std::move(batch),
+    [&] (const std::vector<shared_ptr<const Data>>&, const std::vector<bool>& isInserted,
+         size_t nBatchElements) {
+      nBoundedInserted += std::count(isInserted.begin(), isInserted.end(), true);
+      nBoundedElements += nBatchElements;
+      if (boundedPipeline.getNPending() == 0)
+        work.reset();
+    });
+
+  ioService.run();
+
+  BOOST_CHECK_EQUAL(boundedPipeline.getNPending(), 0);
+  BOOST_CHECK_EQUAL(nBoundedElements, this->data.size());
+  BOOST_CHECK_EQUAL(nBoundedInserted, 4);
+  BOOST_CHECK_EQUAL(store->size(), 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
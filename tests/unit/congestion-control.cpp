@@ -0,0 +1,183 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "handles/congestion-control.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+using ndn::time::milliseconds;
+
+BOOST_AUTO_TEST_SUITE(TestCongestionControl)
+
+BOOST_AUTO_TEST_CASE(RttEstimatorRto)
+{
+  RttEstimator estimator(milliseconds(1000), milliseconds(200), milliseconds(4000));
+  BOOST_CHECK_EQUAL(estimator.getRto().count(), 1000);
+
+  // the first sample sets SRTT = R and RTTVAR = R/2
+  estimator.addMeasurement(milliseconds(100));
+  BOOST_CHECK(estimator.getSmoothedRtt() == milliseconds(100));
+  BOOST_CHECK(estimator.getRttVariation() == milliseconds(50));
+  BOOST_CHECK_EQUAL(estimator.getRto().count(), 300);
+
+  // RTTVAR = 3/4 * 50 + 1/4 * |100 - 140|, SRTT = 7/8 * 100 + 1/8 * 140
+  estimator.addMeasurement(milliseconds(140));
+  BOOST_CHECK(estimator.getRttVariation() == milliseconds(47) + ndn::time::microseconds(500));
+  BOOST_CHECK(estimator.getSmoothedRtt() == milliseconds(105));
+  BOOST_CHECK_EQUAL(estimator.getRto().count(), 295);
+
+  // a steady RTT brings RTO down to its minimum
+  for (int i = 0; i < 50; ++i) {
+    estimator.addMeasurement(milliseconds(10));
+  }
+  BOOST_CHECK_EQUAL(estimator.getRto().count(), 200);
+}
+
+BOOST_AUTO_TEST_CASE(RttEstimatorBackoff)
+{
+  RttEstimator estimator(milliseconds(1000), milliseconds(200), milliseconds(4000));
+  estimator.backoffRto();
+  BOOST_CHECK_EQUAL(estimator.getRto().count(), 2000);
+  estimator.backoffRto();
+  estimator.backoffRto();
+  BOOST_CHECK_EQUAL(estimator.getRto().count(), 4000);
+}
+
+BOOST_AUTO_TEST_CASE(AimdIncrease)
+{
+  AimdWindow window(2, 100);
+  BOOST_CHECK_EQUAL(window.getSize(), 2);
+
+  // slow start adds one segment per Data
+  window.increase();
+  window.increase();
+  BOOST_CHECK_EQUAL(window.getSize(), 4);
+
+  window.increase();
+  window.increase();
+  window.decrease(10, 20);
+  BOOST_CHECK_EQUAL(window.getSize(), 3);
+
+  // congestion avoidance adds about one segment per window of Data
+  window.increase();
+  window.increase();
+  window.increase();
+  BOOST_CHECK_EQUAL(window.getSize(), 3);
+  window.increase();
+  BOOST_CHECK_EQUAL(window.getSize(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(AimdDecrease)
+{
+  AimdWindow window(16, 100);
+  window.decrease(5, 20);
+  BOOST_CHECK_EQUAL(window.getSize(), 8);
+
+  // losses in the window sent before the decrease are the same congestion event
+  window.decrease(6, 25);
+  window.decrease(20, 30);
+  BOOST_CHECK_EQUAL(window.getSize(), 8);
+
+  window.decrease(21, 30);
+  BOOST_CHECK_EQUAL(window.getSize(), 4);
+
+  for (int i = 0; i < 10; ++i) {
+    window.decrease(31 + i, 31 + i);
+  }
+  BOOST_CHECK_EQUAL(window.getSize(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(AimdMaxWindow)
+{
+  AimdWindow window(12, 12);
+  for (int i = 0; i < 100; ++i) {
+    window.increase();
+  }
+  BOOST_CHECK_EQUAL(window.getSize(), 12);
+}
+
+BOOST_AUTO_TEST_CASE(DrrSharesBudget)
+{
+  DeficitRoundRobin round;
+  std::map<ProcessId, size_t> nSent;
+  auto send = [&nSent] (ProcessId processId) {
+    ++nSent[processId];
+    return true;
+  };
+  round.activate(1);
+  round.activate(2);
+  round.activate(3);
+  round.activate(2);
+  BOOST_CHECK_EQUAL(round.size(), 3);
+
+  BOOST_CHECK_EQUAL(round.serve(30, send), 30);
+  BOOST_CHECK_EQUAL(nSent[1], 10);
+  BOOST_CHECK_EQUAL(nSent[2], 10);
+  BOOST_CHECK_EQUAL(nSent[3], 10);
+
+  // the turn goes on where the budget ran out
+  BOOST_CHECK_EQUAL(round.serve(2, send), 2);
+  BOOST_CHECK_EQUAL(round.serve(1, send), 1);
+  BOOST_CHECK_EQUAL(nSent[1], 11);
+  BOOST_CHECK_EQUAL(nSent[2], 11);
+  BOOST_CHECK_EQUAL(nSent[3], 11);
+}
+
+BOOST_AUTO_TEST_CASE(DrrIdleProcess)
+{
+  DeficitRoundRobin round(4);
+  std::map<ProcessId, size_t> credit{{1, 3}, {2, 100}};
+  std::map<ProcessId, size_t> nSent;
+  auto send = [&] (ProcessId processId) {
+    if (credit[processId] == 0)
+      return false;
+    --credit[processId];
+    ++nSent[processId];
+    return true;
+  };
+  round.activate(1);
+  round.activate(2);
+
+  // a process that runs out of window leaves the round, and the others use the budget
+  BOOST_CHECK_EQUAL(round.serve(20, send), 20);
+  BOOST_CHECK_EQUAL(nSent[1], 3);
+  BOOST_CHECK_EQUAL(nSent[2], 17);
+  BOOST_CHECK(!round.isActive(1));
+  BOOST_CHECK(round.isActive(2));
+
+  credit[1] = 100;
+  round.activate(1);
+  BOOST_CHECK_EQUAL(round.serve(8, send), 8);
+  BOOST_CHECK_EQUAL(nSent[1], 7);
+  BOOST_CHECK_EQUAL(nSent[2], 21);
+
+  round.deactivate(2);
+  BOOST_CHECK_EQUAL(round.size(), 1);
+  BOOST_CHECK_EQUAL(round.serve(4, send), 4);
+  BOOST_CHECK_EQUAL(nSent[1], 11);
+  BOOST_CHECK_EQUAL(round.serve(0, send), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -0,0 +1,115 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "storage/data-cache.hpp"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestDataCache)
+
+/**
+ * @return a block of exactly @p size bytes
+ */
+static Block
+makeBlock(size_t size)
+{
+  std::vector<uint8_t> value(size - 2, 0xBB);
+  return ndn::makeBinaryBlock(ndn::tlv::Content, value.data(), value.size());
+}
+
+BOOST_AUTO_TEST_CASE(FindAndEvict)
+{
+  DataCache cache(300);
+
+  BOOST_CHECK(cache.find(1).empty());
+  cache.insert(1, makeBlock(100));
+  cache.insert(2, makeBlock(100));
+  cache.insert(3, makeBlock(100));
+  BOOST_CHECK_EQUAL(cache.size(), 300);
+
+  // touching 1 makes 2 the least recently used block
+  BOOST_CHECK_EQUAL(cache.find(1).size(), 100);
+  cache.insert(4, makeBlock(100));
+  BOOST_CHECK(cache.find(2).empty());
+  BOOST_CHECK(!cache.find(1).empty());
+  BOOST_CHECK(!cache.find(3).empty());
+  BOOST_CHECK(!cache.find(4).empty());
+  BOOST_CHECK_EQUAL(cache.size(), 300);
+
+  BOOST_CHECK_EQUAL(cache.getCounters().nHits, 4);
+  BOOST_CHECK_EQUAL(cache.getCounters().nMisses, 2);
+  BOOST_CHECK_EQUAL(cache.getCounters().nEvictions, 1);
+}
+
+BOOST_AUTO_TEST_CASE(Capacity)
+{
+  DataCache cache(300);
+
+  // blocks larger than the whole cache are not kept
+  cache.insert(1, makeBlock(301));
+  BOOST_CHECK(cache.find(1).empty());
+  BOOST_CHECK_EQUAL(cache.size(), 0);
+
+  // a large block evicts as many blocks as needed
+  cache.insert(1, makeBlock(100));
+  cache.insert(2, makeBlock(100));
+  cache.insert(3, makeBlock(250));
+  BOOST_CHECK(cache.find(1).empty());
+  BOOST_CHECK(cache.find(2).empty());
+  BOOST_CHECK_EQUAL(cache.size(), 250);
+  BOOST_CHECK_EQUAL(cache.getCounters().nEvictions, 2);
+
+  // shrinking the cache evicts immediately
+  cache.setCapacity(200);
+  BOOST_CHECK_EQUAL(cache.size(), 0);
+  BOOST_CHECK(cache.find(3).empty());
+
+  // a disabled cache keeps nothing
+  cache.setCapacity(0);
+  cache.insert(4, makeBlock(10));
+  BOOST_CHECK(cache.find(4).empty());
+}
+
+BOOST_AUTO_TEST_CASE(Erase)
+{
+  DataCache cache(300);
+  cache.insert(1, makeBlock(100));
+  cache.insert(2, makeBlock(100));
+
+  cache.erase(1);
+  cache.erase(3);
+  BOOST_CHECK(cache.find(1).empty());
+  BOOST_CHECK(!cache.find(2).empty());
+  BOOST_CHECK_EQUAL(cache.size(), 100);
+
+  // replacing a block accounts for the new size only
+  cache.insert(2, makeBlock(50));
+  BOOST_CHECK_EQUAL(cache.size(), 50);
+  BOOST_CHECK_EQUAL(cache.getCounters().nEvictions, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
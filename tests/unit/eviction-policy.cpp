@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "storage/eviction-policy.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestEvictionPolicy)
+
+BOOST_AUTO_TEST_CASE(Lru)
+{
+  LruEvictionPolicy policy;
+  policy.afterInsert(1, "/a/1");
+  policy.afterInsert(2, "/a/2");
+  policy.afterInsert(3, "/a/3");
+  BOOST_CHECK(policy.selectVictims(0).empty());
+
+  // reading 1 makes 2 the least recently used entry
+  policy.afterRead(1);
+  std::vector<int64_t> expected{2, 3};
+  std::vector<int64_t> ids = policy.selectVictims(2);
+  BOOST_CHECK_EQUAL_COLLECTIONS(ids.begin(), ids.end(), expected.begin(), expected.end());
+
+  policy.afterErase(2);
+  expected = {3, 1};
+  ids = policy.selectVictims(5);
+  BOOST_CHECK_EQUAL_COLLECTIONS(ids.begin(), ids.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(Fifo)
+{
+  FifoEvictionPolicy policy;
+  policy.afterInsert(3, "/a/3");
+  policy.afterInsert(1, "/a/1");
+  policy.afterInsert(2, "/a/2");
+
+  // reads do not matter, the lowest ids go first
+  policy.afterRead(1);
+  std::vector<int64_t> expected{1, 2};
+  std::vector<int64_t> ids = policy.selectVictims(2);
+  BOOST_CHECK_EQUAL_COLLECTIONS(ids.begin(), ids.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(Quota)
+{
+  std::map<Name, size_t> quotas{{"/a", 2}, {"/a/b", 1}};
+  QuotaEvictionPolicy policy(quotas);
+  policy.afterInsert(1, "/a/1");
+  policy.afterInsert(2, "/a/b/1");
+  policy.afterInsert(3, "/c/1");
+  policy.afterInsert(4, "/a/2");
+  BOOST_CHECK(policy.selectVictims(0).empty());
+  BOOST_CHECK_EQUAL(policy.getNOverLimit(), 0);
+
+  // /a/b/2 counts against the quota of /a/b only
+  policy.afterInsert(5, "/a/b/2");
+  BOOST_CHECK_EQUAL(policy.getNOverLimit(), 1);
+  std::vector<int64_t> expected{2};
+  std::vector<int64_t> ids = policy.selectVictims(0);
+  BOOST_CHECK_EQUAL_COLLECTIONS(ids.begin(), ids.end(), expected.begin(), expected.end());
+
+  // entries over quota go first, then the oldest entries of all
+  expected = {2, 1, 3};
+  ids = policy.selectVictims(3);
+  BOOST_CHECK_EQUAL_COLLECTIONS(ids.begin(), ids.end(), expected.begin(), expected.end());
+
+  policy.afterErase(2);
+  BOOST_CHECK(policy.selectVictims(0).empty());
+  BOOST_CHECK_EQUAL(policy.getNOverLimit(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Create)
+{
+  BOOST_CHECK(dynamic_cast<LruEvictionPolicy*>(EvictionPolicy::create("lru", {}).get()) != nullptr);
+  BOOST_CHECK(dynamic_cast<FifoEvictionPolicy*>(EvictionPolicy::create("fifo", {}).get()) != nullptr);
+  BOOST_CHECK(dynamic_cast<QuotaEvictionPolicy*>(EvictionPolicy::create("quota", {}).get()) != nullptr);
+  BOOST_CHECK_THROW(EvictionPolicy::create("random", {}), EvictionPolicy::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -23,6 +23,7 @@
 #include "../dataset-fixtures.hpp"
 
 #include <iostream>
+#include <sstream>
 
 #include <ndn-cxx/security/signing-helpers.hpp>
 #include <ndn-cxx/util/sha256.hpp>
@@ -116,6 +117,400 @@ BOOST_AUTO_TEST_CASE(FullName)
   BOOST_CHECK_EQUAL(find(), 2);
 }
 
+BOOST_AUTO_TEST_CASE(DigestOfOtherName)
+{
+  Name n1 = insert(1, "ndn:/A");
+
+  // the implicit digest of /A under another prefix does not name any entry
+  Name other = Name("ndn:/B").append(n1.get(-1));
+  BOOST_CHECK_EQUAL(m_index.hasData(n1), true);
+  BOOST_CHECK_EQUAL(m_index.hasData(other), false);
+  BOOST_CHECK_EQUAL(m_index.erase(other), false);
+
+  startInterest(other);
+  BOOST_CHECK_EQUAL(find(), 0);
+
+  startInterest(n1);
+  BOOST_CHECK_EQUAL(find(), 1);
+  BOOST_CHECK_EQUAL(m_index.find(n1).second, n1);
+
+  BOOST_CHECK_EQUAL(m_index.erase(n1), true);
+  BOOST_CHECK_EQUAL(m_index.hasData(n1), false);
+  startInterest(n1);
+  BOOST_CHECK_EQUAL(find(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(CanonicalOrder)
+{
+  // shorter components come first in canonical order, regardless of their bytes
+  insert(1, "ndn:/A/ZZ");
+  insert(2, "ndn:/A/B/C");
+  insert(3, "ndn:/A/B");
+  insert(4, "ndn:/A/Y");
+
+  startInterest("ndn:/A");
+  BOOST_CHECK_EQUAL(find(), 3);
+
+  startInterest("ndn:/A/B");
+  BOOST_CHECK_EQUAL(find(), 3);
+
+  startInterest("ndn:/A/B/C");
+  BOOST_CHECK_EQUAL(find(), 2);
+
+  startInterest("ndn:/A/Z");
+  BOOST_CHECK_EQUAL(find(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Erase)
+{
+  Name n1 = insert(1, "ndn:/A/B");
+  Name n2 = insert(2, "ndn:/A/C");
+  // the ID table is filled from the entries already there, then kept up to date
+  m_index.enableFindName(true);
+  Name n3 = insert(3, "ndn:/A/B/D");
+  BOOST_CHECK_EQUAL(m_index.size(), 3);
+  BOOST_CHECK_EQUAL(m_index.findName(1), n1);
+  BOOST_CHECK_EQUAL(m_index.findName(3), n3);
+
+  BOOST_CHECK_EQUAL(m_index.erase(n1), true);
+  BOOST_CHECK_EQUAL(m_index.findName(1), Name());
+  BOOST_CHECK_EQUAL(m_index.erase(n1), false);
+  BOOST_CHECK_EQUAL(m_index.erase("ndn:/A/B"), false);
+  BOOST_CHECK_EQUAL(m_index.hasData(n1), false);
+  BOOST_CHECK_EQUAL(m_index.size(), 2);
+
+  startInterest("ndn:/A");
+  BOOST_CHECK_EQUAL(find(), 3);
+
+  BOOST_CHECK_EQUAL(m_index.erase(n3), true);
+  startInterest("ndn:/A");
+  BOOST_CHECK_EQUAL(find(), 2);
+  startInterest("ndn:/A/B");
+  BOOST_CHECK_EQUAL(find(), 0);
+
+  BOOST_CHECK_EQUAL(m_index.erase(n2), true);
+  startInterest("ndn:/");
+  BOOST_CHECK_EQUAL(find(), 0);
+  BOOST_CHECK_EQUAL(m_index.size(), 0);
+
+  // the pruned prefix can be inserted again
+  Name n4 = insert(4, "ndn:/A/B");
+  startInterest("ndn:/A");
+  BOOST_CHECK_EQUAL(find(), 4);
+  BOOST_CHECK_EQUAL(m_index.hasData(n4), true);
+}
+
+BOOST_AUTO_TEST_CASE(ErasePrefix)
+{
+  Name n1 = insert(1, "ndn:/A/B");
+  Name n2 = insert(2, "ndn:/A/C");
+  Name n3 = insert(3, "ndn:/A/B/D");
+  Name n4 = insert(4, "ndn:/E");
+
+  auto entries = m_index.findAll("ndn:/A/B");
+  BOOST_REQUIRE_EQUAL(entries.size(), 2);
+  BOOST_CHECK_EQUAL(entries[0].first, 1);
+  BOOST_CHECK_EQUAL(entries[0].second, n1);
+  BOOST_CHECK_EQUAL(entries[1].first, 3);
+  BOOST_CHECK_EQUAL(entries[1].second, n3);
+  BOOST_CHECK(m_index.findAll("ndn:/A/X").empty());
+
+  BOOST_CHECK_EQUAL(m_index.erasePrefix("ndn:/A/B"), 2);
+  BOOST_CHECK_EQUAL(m_index.erasePrefix("ndn:/A/B"), 0);
+  BOOST_CHECK_EQUAL(m_index.size(), 2);
+  BOOST_CHECK_EQUAL(m_index.hasData(n1), false);
+  BOOST_CHECK_EQUAL(m_index.hasData(n3), false);
+  BOOST_CHECK_EQUAL(m_index.hasData(n2), true);
+
+  // a full name erases just its entry
+  BOOST_CHECK_EQUAL(m_index.erasePrefix(n2), 1);
+  startInterest("ndn:/A");
+  BOOST_CHECK_EQUAL(find(), 0);
+
+  BOOST_CHECK_EQUAL(m_index.erasePrefix("ndn:/"), 1);
+  BOOST_CHECK_EQUAL(m_index.size(), 0);
+  BOOST_CHECK_EQUAL(m_index.hasData(n4), false);
+}
+
+BOOST_AUTO_TEST_CASE(EraseBatch)
+{
+  Name n1 = insert(1, "ndn:/A/B");
+  Name n2 = insert(2, "ndn:/A/C");
+  Name n3 = insert(3, "ndn:/A/B/D");
+  Name n4 = insert(4, "ndn:/E");
+
+  BOOST_CHECK_EQUAL(m_index.eraseBatch({n3, n1, n4, n4, "ndn:/X"}), 3);
+  BOOST_CHECK_EQUAL(m_index.size(), 1);
+  startInterest("ndn:/A/B");
+  BOOST_CHECK_EQUAL(find(), 0);
+  startInterest("ndn:/");
+  BOOST_CHECK_EQUAL(find(), 2);
+
+  // the pruned prefixes can be inserted again
+  insert(5, "ndn:/A/B/D");
+  startInterest("ndn:/A/B");
+  BOOST_CHECK_EQUAL(find(), 5);
+
+  auto entries = m_index.findAll("ndn:/", 1);
+  BOOST_REQUIRE_EQUAL(entries.size(), 1);
+  BOOST_CHECK_EQUAL(entries.front().first, 5);
+}
+
+BOOST_AUTO_TEST_CASE(FindAllAfter)
+{
+  Name n1 = insert(1, "ndn:/A/B");
+  Name n2 = insert(2, "ndn:/A/C");
+  Name n3 = insert(3, "ndn:/A/B/D");
+  Name n4 = insert(4, "ndn:/E");
+
+  // walking in steps from the last name returned visits every entry once, in order
+  std::vector<int64_t> ids;
+  Name after;
+  for (auto entries = m_index.findAllAfter("ndn:/", after, 1); !entries.empty();
+       entries = m_index.findAllAfter("ndn:/", after, 1)) {
+    BOOST_REQUIRE_EQUAL(entries.size(), 1);
+    ids.push_back(entries.front().first);
+    after = entries.front().second;
+  }
+  std::vector<int64_t> expected{1, 3, 2, 4};
+  BOOST_CHECK_EQUAL_COLLECTIONS(ids.begin(), ids.end(), expected.begin(), expected.end());
+
+  auto entries = m_index.findAllAfter("ndn:/A", n1, 10);
+  BOOST_REQUIRE_EQUAL(entries.size(), 2);
+  BOOST_CHECK_EQUAL(entries[0].second, n3);
+  BOOST_CHECK_EQUAL(entries[1].second, n2);
+  BOOST_CHECK(m_index.findAllAfter("ndn:/A", n2, 10).empty());
+
+  // the name to start after need not be stored
+  entries = m_index.findAllAfter("ndn:/A", "ndn:/A/B/D", 10);
+  BOOST_REQUIRE_EQUAL(entries.size(), 2);
+  BOOST_CHECK_EQUAL(entries[0].second, n3);
+  entries = m_index.findAllAfter("ndn:/A", "ndn:/A/A", 10);
+  BOOST_REQUIRE_EQUAL(entries.size(), 3);
+  BOOST_CHECK_EQUAL(entries[0].second, n1);
+  BOOST_CHECK(m_index.findAllAfter("ndn:/A", n4, 10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(EraseSegments)
+{
+  for (int i = 0; i < 300; ++i) {
+    insert(i + 1, Name("ndn:/A").appendSegment(i));
+  }
+  insert(1000, "ndn:/A/B");
+  insert(1001, Name("ndn:/C").appendSegment(5));
+
+  // segments 200 and 255 are encoded in one octet and 256 in two
+  auto entries = m_index.findSegments("ndn:/A", 200, 256);
+  BOOST_REQUIRE_EQUAL(entries.size(), 57);
+  BOOST_CHECK_EQUAL(entries.front().first, 201);
+  BOOST_CHECK_EQUAL(entries.back().first, 257);
+  BOOST_CHECK(m_index.findSegments("ndn:/A", 10, 9).empty());
+  BOOST_CHECK(m_index.findSegments("ndn:/X", 0, 9).empty());
+
+  BOOST_CHECK_EQUAL(m_index.eraseSegments("ndn:/A", 200, 256), 57);
+  BOOST_CHECK_EQUAL(m_index.size(), 302 - 57);
+  startInterest(Name("ndn:/A").appendSegment(200));
+  BOOST_CHECK_EQUAL(find(), 0);
+  startInterest(Name("ndn:/A").appendSegment(257));
+  BOOST_CHECK_EQUAL(find(), 258);
+
+  // an open-ended range leaves other components alone
+  BOOST_CHECK_EQUAL(m_index.eraseSegments("ndn:/A", 0, std::numeric_limits<uint64_t>::max()),
+                    300 - 57);
+  BOOST_CHECK_EQUAL(m_index.size(), 2);
+  startInterest("ndn:/A");
+  BOOST_CHECK_EQUAL(find(), 1000);
+  startInterest("ndn:/C");
+  BOOST_CHECK_EQUAL(find(), 1001);
+}
+
+BOOST_AUTO_TEST_CASE(NonMinimalSegment)
+{
+  // segment 1 encoded in two octets sorts between segments 3 and 300
+  static const uint8_t NON_MINIMAL_ONE[] = {0x00, 0x00, 0x01};
+  insert(1, Name("ndn:/A").append(NON_MINIMAL_ONE, sizeof(NON_MINIMAL_ONE)));
+  insert(3, Name("ndn:/A").appendSegment(3));
+  insert(300, Name("ndn:/A").appendSegment(300));
+
+  auto entries = m_index.findSegments("ndn:/A", 3, 300);
+  BOOST_REQUIRE_EQUAL(entries.size(), 2);
+  BOOST_CHECK_EQUAL(entries[0].first, 3);
+  BOOST_CHECK_EQUAL(entries[1].first, 300);
+
+  BOOST_CHECK_EQUAL(m_index.eraseSegments("ndn:/A", 3, 300), 2);
+  BOOST_CHECK_EQUAL(m_index.size(), 1);
+  startInterest("ndn:/A");
+  BOOST_CHECK_EQUAL(find(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(Leftmost)
+{
+  insert(1, "ndn:/A");
+  insert(2, "ndn:/B/p/1");
+  insert(3, "ndn:/B/p/2");
+  insert(4, "ndn:/B/q/1");
+  insert(5, "ndn:/B/q/2");
+  insert(6, "ndn:/C");
+
+  startInterest("ndn:/B")
+    .setChildSelector(0);
+  BOOST_CHECK_EQUAL(find(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(Rightmost)
+{
+  insert(1, "ndn:/A");
+  insert(2, "ndn:/B/p/1");
+  insert(3, "ndn:/B/p/2");
+  insert(4, "ndn:/B/q/1");
+  insert(5, "ndn:/B/q/2");
+  insert(6, "ndn:/C");
+
+  // the leftmost entry of the rightmost child
+  startInterest("ndn:/B")
+    .setChildSelector(1);
+  BOOST_CHECK_EQUAL(find(), 4);
+
+  startInterest("ndn:/B/p")
+    .setChildSelector(1);
+  BOOST_CHECK_EQUAL(find(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(RightmostSkipsNonMatchingChildren)
+{
+  insert(1, "ndn:/A/1");
+  insert(2, "ndn:/A/2/x");
+  insert(3, "ndn:/A/3/x/y");
+
+  // /A/3 holds no entry with at most 3 suffix components, /A/2 does
+  startInterest("ndn:/A")
+    .setChildSelector(1)
+    .setMaxSuffixComponents(3);
+  BOOST_CHECK_EQUAL(find(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(MinSuffixComponents)
+{
+  insert(1, "ndn:/A/1/x");
+  insert(2, "ndn:/A/2/x/y");
+  insert(3, "ndn:/A/3/x/y/z");
+
+  // suffix components include the implicit digest
+  startInterest("ndn:/A")
+    .setMinSuffixComponents(4);
+  BOOST_CHECK_EQUAL(find(), 2);
+
+  startInterest("ndn:/A")
+    .setMinSuffixComponents(5);
+  BOOST_CHECK_EQUAL(find(), 3);
+
+  startInterest("ndn:/A")
+    .setMinSuffixComponents(6);
+  BOOST_CHECK_EQUAL(find(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(MaxSuffixComponents)
+{
+  insert(1, "ndn:/A/1/x/y");
+  insert(2, "ndn:/A/2/x");
+  insert(3, "ndn:/A/3");
+
+  startInterest("ndn:/A")
+    .setMaxSuffixComponents(3);
+  BOOST_CHECK_EQUAL(find(), 2);
+
+  startInterest("ndn:/A")
+    .setMaxSuffixComponents(2);
+  BOOST_CHECK_EQUAL(find(), 3);
+
+  startInterest("ndn:/A")
+    .setMaxSuffixComponents(1);
+  BOOST_CHECK_EQUAL(find(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Exclude)
+{
+  insert(1, "ndn:/A/1");
+  insert(2, "ndn:/A/2");
+  insert(3, "ndn:/A/3");
+
+  ndn::Exclude exclude;
+  exclude.excludeBefore(name::Component("2"));
+  startInterest("ndn:/A")
+    .setExclude(exclude);
+  BOOST_CHECK_EQUAL(find(), 3);
+
+  exclude.clear();
+  exclude.excludeOne(name::Component("3"));
+  startInterest("ndn:/A")
+    .setChildSelector(1)
+    .setExclude(exclude);
+  BOOST_CHECK_EQUAL(find(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(PublisherPublicKeyLocator)
+{
+  KeyLocator k1(Name("ndn:/K/1"));
+  KeyLocator k2(Name("ndn:/K/2"));
+  m_index.insert(Name("ndn:/A/1"), 1, repo::Index::computeKeyLocatorHash(k1));
+  m_index.insert(Name("ndn:/A/2"), 2, repo::Index::computeKeyLocatorHash(k2));
+  m_index.insert(Name("ndn:/A/3"), 3, ndn::ConstBufferPtr());
+
+  startInterest("ndn:/A")
+    .setPublisherPublicKeyLocator(k2);
+  BOOST_CHECK_EQUAL(find(), 2);
+
+  startInterest("ndn:/A")
+    .setPublisherPublicKeyLocator(KeyLocator(Name("ndn:/K/3")));
+  BOOST_CHECK_EQUAL(find(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Snapshot)
+{
+  Name n1 = insert(1, "ndn:/A/B");
+  Name n2 = insert(2, "ndn:/A/C");
+  Name n3 = insert(3, "ndn:/A/B/D");
+  m_index.insert(Name("ndn:/E"), 4, repo::Index::computeKeyLocatorHash(KeyLocator(Name("/K"))));
+
+  std::ostringstream os;
+  m_index.writeSnapshot(os, 42, 7);
+  std::string snapshot = os.str();
+
+  repo::Index loaded(std::numeric_limits<size_t>::max());
+  loaded.enableFindName(true);
+  int64_t nDeleted = 0;
+  BOOST_CHECK_EQUAL(loaded.readSnapshot(reinterpret_cast<const uint8_t*>(snapshot.data()),
+                                        snapshot.size(), nDeleted), 42);
+  BOOST_CHECK_EQUAL(nDeleted, 7);
+  BOOST_CHECK_EQUAL(loaded.size(), 4);
+  BOOST_CHECK_EQUAL(loaded.hasData(n1), true);
+  BOOST_CHECK_EQUAL(loaded.hasData(n2), true);
+  BOOST_CHECK_EQUAL(loaded.hasData(n3), true);
+  BOOST_CHECK_EQUAL(loaded.find(Name("ndn:/A")).first, 1);
+  BOOST_CHECK_EQUAL(loaded.find(n3).second, n3);
+  BOOST_CHECK_EQUAL(loaded.findName(2), n2);
+
+  Interest interest("ndn:/");
+  interest.setPublisherPublicKeyLocator(KeyLocator(Name("/K")));
+  BOOST_CHECK_EQUAL(loaded.find(interest).first, 4);
+
+  std::vector<int64_t> ids;
+  loaded.forEachEntry([&ids] (int64_t id, const Name&) { ids.push_back(id); });
+  BOOST_CHECK_EQUAL(ids.size(), 4);
+
+  // a truncated snapshot is rejected and leaves the index empty
+  BOOST_CHECK_THROW(loaded.readSnapshot(reinterpret_cast<const uint8_t*>(snapshot.data()),
+                                        snapshot.size() - 1, nDeleted),
+                    repo::Index::Error);
+  BOOST_CHECK_EQUAL(loaded.size(), 0);
+  BOOST_CHECK_EQUAL(loaded.hasData(n1), false);
+
+  // so is a snapshot larger than the index
+  repo::Index small(3);
+  BOOST_CHECK_THROW(small.readSnapshot(reinterpret_cast<const uint8_t*>(snapshot.data()),
+                                       snapshot.size(), nDeleted),
+                    repo::Index::Error);
+}
 
 BOOST_AUTO_TEST_SUITE_END() // Find
 
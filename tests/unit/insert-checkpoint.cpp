@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "handles/insert-checkpoint.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestInsertCheckpoint)
+
+static std::vector<InsertCheckpoint>
+makeCheckpoints()
+{
+  std::vector<InsertCheckpoint> checkpoints(2);
+  checkpoints[0].processId = 42;
+  checkpoints[0].prefix = Name("/example/file");
+  checkpoints[0].startBlockId = 0;
+  checkpoints[0].hasEndBlockId = true;
+  checkpoints[0].endBlockId = 999;
+  checkpoints[0].interestLifetime = ndn::time::milliseconds(2000);
+  checkpoints[0].insertNum = 130;
+  checkpoints[0].base = 128;
+  checkpoints[0].received = {0x5, 0x8000000000000000};
+
+  checkpoints[1].processId = 7;
+  checkpoints[1].prefix = Name("/example/stream");
+  checkpoints[1].startBlockId = 10;
+  checkpoints[1].hasEndBlockId = false;
+  checkpoints[1].endBlockId = 0;
+  checkpoints[1].interestLifetime = ndn::time::milliseconds(4000);
+  checkpoints[1].insertNum = 0;
+  checkpoints[1].base = 10;
+  return checkpoints;
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+  std::vector<InsertCheckpoint> checkpoints = makeCheckpoints();
+  std::ostringstream os;
+  writeInsertCheckpoints(os, checkpoints);
+  std::string file = os.str();
+
+  std::vector<InsertCheckpoint> read =
+    readInsertCheckpoints(reinterpret_cast<const uint8_t*>(file.data()), file.size());
+  BOOST_REQUIRE_EQUAL(read.size(), 2);
+  for (size_t i = 0; i < read.size(); ++i) {
+    BOOST_CHECK_EQUAL(read[i].processId, checkpoints[i].processId);
+    BOOST_CHECK_EQUAL(read[i].prefix, checkpoints[i].prefix);
+    BOOST_CHECK_EQUAL(read[i].startBlockId, checkpoints[i].startBlockId);
+    BOOST_CHECK_EQUAL(read[i].hasEndBlockId, checkpoints[i].hasEndBlockId);
+    BOOST_CHECK_EQUAL(read[i].endBlockId, checkpoints[i].endBlockId);
+    BOOST_CHECK(read[i].interestLifetime == checkpoints[i].interestLifetime);
+    BOOST_CHECK_EQUAL(read[i].insertNum, checkpoints[i].insertNum);
+    BOOST_CHECK_EQUAL(read[i].base, checkpoints[i].base);
+    BOOST_CHECK_EQUAL_COLLECTIONS(read[i].received.begin(), read[i].received.end(),
+                                  checkpoints[i].received.begin(), checkpoints[i].received.end());
+  }
+
+  std::ostringstream empty;
+  writeInsertCheckpoints(empty, {});
+  file = empty.str();
+  BOOST_CHECK(readInsertCheckpoints(reinterpret_cast<const uint8_t*>(file.data()),
+                                    file.size()).empty());
+}
+
+BOOST_AUTO_TEST_CASE(Corrupted)
+{
+  std::ostringstream os;
+  writeInsertCheckpoints(os, makeCheckpoints());
+  std::string file = os.str();
+
+  BOOST_CHECK_THROW(readInsertCheckpoints(reinterpret_cast<const uint8_t*>(file.data()),
+                                          file.size() - 1),
+                    InsertCheckpoint::Error);
+  std::string extended = file + "x";
+  BOOST_CHECK_THROW(readInsertCheckpoints(reinterpret_cast<const uint8_t*>(extended.data()),
+                                          extended.size()),
+                    InsertCheckpoint::Error);
+  std::string notCheckpoint(file.size(), '\0');
+  BOOST_CHECK_THROW(readInsertCheckpoints(reinterpret_cast<const uint8_t*>(notCheckpoint.data()),
+                                          notCheckpoint.size()),
+                    InsertCheckpoint::Error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
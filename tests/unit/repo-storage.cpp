@@ -22,6 +22,8 @@
 #include "../dataset-fixtures.hpp"
 #include "../repo-storage-fixture.hpp"
 
+#include <ndn-cxx/util/backports.hpp>
+
 #include <boost/mpl/push_back.hpp>
 #include <boost/test/unit_test.hpp>
 #include <iostream>
@@ -58,6 +60,7 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(Bulk, T, CommonDatasets, Fixture<T>)
   {
       shared_ptr<ndn::Data> dataTest = this->handle->readData(i->first);
       BOOST_CHECK_EQUAL(*this->handle->readData(i->first), *i->second);
+      BOOST_CHECK(this->handle->readWire(i->first) == i->second->wireEncode());
     }
 
   // Remove items
@@ -70,6 +73,275 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(Bulk, T, CommonDatasets, Fixture<T>)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(InsertBatch, T, CommonDatasets, Fixture<T>)
+{
+  BOOST_TEST_MESSAGE(T::getName());
+
+  std::vector<shared_ptr<const Data>> batch(this->data.begin(), this->data.end());
+  // repeated data within a batch is inserted only once
+  batch.push_back(this->data.front());
+
+  std::vector<bool> isInserted = this->handle->insertBatch(batch);
+  BOOST_REQUIRE_EQUAL(isInserted.size(), batch.size());
+  BOOST_CHECK_EQUAL(std::count(isInserted.begin(), isInserted.end(), true),
+                    static_cast<ptrdiff_t>(this->data.size()));
+  BOOST_CHECK_EQUAL(isInserted.back(), false);
+  BOOST_CHECK_EQUAL(this->store->size(), static_cast<int64_t>(this->data.size()));
+
+  for (const auto& interest : this->interests) {
+    BOOST_CHECK_EQUAL(*this->handle->readData(interest.first), *interest.second);
+  }
+
+  // data already in the repo is not inserted again
+  isInserted = this->handle->insertBatch(batch);
+  BOOST_CHECK_EQUAL(std::count(isInserted.begin(), isInserted.end(), true), 0);
+  BOOST_CHECK_EQUAL(this->store->size(), static_cast<int64_t>(this->data.size()));
+}
+
+BOOST_FIXTURE_TEST_CASE(InsertBatchIntoFullRepo, Fixture<SamePrefixDataset<10>>)
+{
+  repo::RepoStorage bounded(4, *store);
+  std::vector<shared_ptr<const Data>> batch(data.begin(), data.end());
+
+  // what does not fit is neither indexed nor written to storage
+  std::vector<bool> isInserted = bounded.insertBatch(batch);
+  std::vector<bool> expected{true, true, true, true, false, false, false, false, false, false};
+  BOOST_CHECK_EQUAL_COLLECTIONS(isInserted.begin(), isInserted.end(),
+                                expected.begin(), expected.end());
+  BOOST_CHECK_EQUAL(store->size(), 4);
+
+  BOOST_CHECK_THROW(bounded.insertData(*data.back()), repo::RepoStorage::Error);
+  BOOST_CHECK_EQUAL(store->size(), 4);
+}
+
+BOOST_FIXTURE_TEST_CASE(GroupCommit, Fixture<SamePrefixDataset<10>>)
+{
+  boost::asio::io_service ioService;
+  Scheduler scheduler(ioService);
+  handle->enableGroupCommit(scheduler, 4, ndn::time::seconds(10));
+
+  size_t nInsertions = 0;
+  handle->afterDataInsertion.connect([&nInsertions] (const Name&) { ++nInsertions; });
+
+  auto i = this->data.begin();
+  for (size_t n = 0; n < 3; ++n, ++i) {
+    BOOST_CHECK_EQUAL(handle->insertData(**i), true);
+  }
+  // the group is not full yet, so nothing has been committed
+  BOOST_CHECK_EQUAL(nInsertions, 0);
+
+  BOOST_CHECK_EQUAL(handle->insertData(**i++), true);
+  BOOST_CHECK_EQUAL(nInsertions, 4);
+
+  for (; i != this->data.end(); ++i) {
+    BOOST_CHECK_EQUAL(handle->insertData(**i), true);
+  }
+  BOOST_CHECK_EQUAL(nInsertions, 8);
+
+  handle->flush();
+  BOOST_CHECK_EQUAL(nInsertions, 10);
+  BOOST_CHECK_EQUAL(store->size(), 10);
+
+  for (const auto& interest : this->interests) {
+    BOOST_CHECK_EQUAL(*handle->readData(interest.first), *interest.second);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(ReadCache, Fixture<SamePrefixDataset<10>>)
+{
+  handle->setCacheCapacity(1024 * 1024);
+
+  for (const auto& data : this->data) {
+    BOOST_CHECK_EQUAL(handle->insertData(*data), true);
+  }
+
+  for (size_t round = 0; round < 2; ++round) {
+    for (const auto& interest : this->interests) {
+      BOOST_CHECK(handle->readWire(interest.first) == interest.second->wireEncode());
+    }
+  }
+  BOOST_CHECK_EQUAL(handle->getCache().getCounters().nMisses, this->interests.size());
+  BOOST_CHECK_EQUAL(handle->getCache().getCounters().nHits, this->interests.size());
+
+  // deleted data is no longer served from the cache
+  const auto& deleted = this->interests.front();
+  BOOST_CHECK_EQUAL(handle->deleteData(deleted.second->getFullName()), 1);
+  BOOST_CHECK(handle->readWire(deleted.first).empty());
+
+  // a disabled cache serves every read from storage
+  handle->setCacheCapacity(0);
+  BOOST_CHECK_EQUAL(handle->getCache().size(), 0);
+  const auto& kept = this->interests.back();
+  BOOST_CHECK(handle->readWire(kept.first) == kept.second->wireEncode());
+  BOOST_CHECK_EQUAL(handle->getCache().size(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(ParallelRebuild, T, CommonDatasets, Fixture<T>)
+{
+  BOOST_TEST_MESSAGE(T::getName());
+
+  for (const auto& data : this->data) {
+    BOOST_CHECK_EQUAL(this->handle->insertData(*data), true);
+  }
+
+  repo::RepoStorage restarted(65535, *this->store);
+  restarted.setRebuildThreads(3);
+  size_t nInsertions = 0;
+  restarted.afterDataInsertion.connect([&nInsertions] (const Name&) { ++nInsertions; });
+  restarted.initialize();
+
+  BOOST_CHECK_EQUAL(nInsertions, this->data.size());
+  for (const auto& interest : this->interests) {
+    BOOST_CHECK_EQUAL(*restarted.readData(interest.first), *interest.second);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(IndexSnapshot, Fixture<SamePrefixDataset<10>>)
+{
+  const std::string snapshotPath = "unittestdb/index.snapshot";
+  handle->setSnapshotPath(snapshotPath);
+
+  auto i = this->data.begin();
+  for (size_t n = 0; n < 6; ++n, ++i) {
+    BOOST_CHECK_EQUAL(handle->insertData(**i), true);
+  }
+  handle->saveSnapshot();
+  BOOST_CHECK(boost::filesystem::exists(snapshotPath));
+  for (; i != this->data.end(); ++i) {
+    BOOST_CHECK_EQUAL(handle->insertData(**i), true);
+  }
+
+  // entries in the snapshot and entries inserted after it are both found
+  {
+    repo::RepoStorage restarted(65535, *store);
+    restarted.setSnapshotPath(snapshotPath);
+    size_t nInsertions = 0;
+    restarted.afterDataInsertion.connect([&nInsertions] (const Name&) { ++nInsertions; });
+    restarted.initialize();
+    BOOST_CHECK_EQUAL(nInsertions, this->data.size());
+    for (const auto& interest : this->interests) {
+      BOOST_CHECK_EQUAL(*restarted.readData(interest.first), *interest.second);
+    }
+  }
+
+  // an entry deleted after the snapshot was written makes it out of date
+  const auto& deleted = this->interests.front();
+  BOOST_CHECK_EQUAL(handle->deleteData(deleted.second->getFullName()), 1);
+  {
+    repo::RepoStorage restarted(65535, *store);
+    restarted.setSnapshotPath(snapshotPath);
+    restarted.initialize();
+    BOOST_CHECK(restarted.readData(deleted.first) == nullptr);
+    BOOST_CHECK_EQUAL(*restarted.readData(this->interests.back().first),
+                      *this->interests.back().second);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(DeleteSegments, Fixture<SamePrefixDataset<10>>)
+{
+  for (const auto& data : this->data) {
+    BOOST_CHECK_EQUAL(handle->insertData(*data), true);
+  }
+  Name prefix = this->data.front()->getName().getPrefix(-1);
+  size_t nDeletions = 0;
+  handle->afterDataDeletion.connect([&nDeletions] (const Name&) { ++nDeletions; });
+
+  BOOST_CHECK_EQUAL(handle->deleteSegments(prefix, 2, 4), 3);
+  BOOST_CHECK_EQUAL(handle->deleteSegments(prefix, 2, 4), 0);
+  BOOST_CHECK_EQUAL(nDeletions, 3);
+  BOOST_CHECK_EQUAL(store->size(), 7);
+
+  // an open-ended range deletes the rest from the first segment on
+  BOOST_CHECK_EQUAL(handle->deleteSegments(prefix, 6, std::numeric_limits<uint64_t>::max()), 4);
+  BOOST_CHECK_EQUAL(store->size(), 3);
+  BOOST_CHECK(handle->readData(Interest(Name(prefix).appendSegment(5))) != nullptr);
+  BOOST_CHECK(handle->readData(Interest(Name(prefix).appendSegment(9))) == nullptr);
+}
+
+BOOST_FIXTURE_TEST_CASE(StoredSegments, Fixture<SamePrefixDataset<10>>)
+{
+  for (const auto& data : this->data) {
+    BOOST_CHECK_EQUAL(handle->insertData(*data), true);
+  }
+  Name prefix = this->data.front()->getName().getPrefix(-1);
+  BOOST_CHECK_EQUAL(handle->deleteSegments(prefix, 3, 5), 3);
+
+  std::vector<uint64_t> expected{1, 2, 6, 7};
+  std::vector<uint64_t> segments = handle->getStoredSegments(prefix, 1, 7);
+  BOOST_CHECK_EQUAL_COLLECTIONS(segments.begin(), segments.end(), expected.begin(), expected.end());
+
+  segments = handle->getStoredSegments(prefix, 7, std::numeric_limits<uint64_t>::max());
+  BOOST_CHECK_EQUAL(segments.size(), 3);
+  BOOST_CHECK(handle->getStoredSegments(Name("/no/such/prefix"), 0, 10).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(StoredChildren, Fixture<SamePrefixDataset<10>>)
+{
+  for (const auto& data : this->data) {
+    BOOST_CHECK_EQUAL(handle->insertData(*data), true);
+  }
+  Name prefix = this->data.front()->getName().getPrefix(-1);
+  BOOST_CHECK_EQUAL(handle->deleteSegments(prefix, 0, 7), 8);
+
+  std::vector<name::Component> children = handle->getStoredChildren(prefix);
+  BOOST_REQUIRE_EQUAL(children.size(), 2);
+  BOOST_CHECK_EQUAL(children[0], name::Component::fromSegment(8));
+  BOOST_CHECK_EQUAL(children[1], name::Component::fromSegment(9));
+  children = handle->getStoredChildren(prefix, 1);
+  BOOST_REQUIRE_EQUAL(children.size(), 1);
+  BOOST_CHECK_EQUAL(children[0], name::Component::fromSegment(9));
+  BOOST_CHECK(handle->getStoredChildren(Name("/no/such/prefix")).empty());
+
+  BOOST_CHECK(handle->hasName(prefix));
+  BOOST_CHECK(handle->hasName(Name(prefix).appendSegment(9)));
+  BOOST_CHECK(!handle->hasName(Name(prefix).appendSegment(7)));
+  BOOST_CHECK(handle->hasData(*this->data.back()));
+  BOOST_CHECK(!handle->hasData(*this->data.front()));
+}
+
+BOOST_FIXTURE_TEST_CASE(ChunkedDelete, Fixture<SamePrefixDataset<10>>)
+{
+  for (const auto& data : this->data) {
+    BOOST_CHECK_EQUAL(handle->insertData(*data), true);
+  }
+  Name prefix = this->data.front()->getName().getPrefix(-1);
+
+  // a chunk as large as the limit means there may be more to delete
+  BOOST_CHECK_EQUAL(handle->deleteData(prefix, 4), 4);
+  BOOST_CHECK_EQUAL(store->size(), 6);
+  BOOST_CHECK(handle->readData(Interest(Name(prefix).appendSegment(3))) == nullptr);
+  BOOST_CHECK(handle->readData(Interest(Name(prefix).appendSegment(4))) != nullptr);
+
+  BOOST_CHECK_EQUAL(handle->deleteSegments(prefix, 0, 7, 2), 2);
+  BOOST_CHECK_EQUAL(handle->deleteSegments(prefix, 0, 7, 2), 2);
+  BOOST_CHECK_EQUAL(handle->deleteSegments(prefix, 0, 7, 2), 0);
+  BOOST_CHECK_EQUAL(handle->deleteData(prefix, 4), 2);
+  BOOST_CHECK_EQUAL(store->size(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(Eviction, Fixture<SamePrefixDataset<10>>)
+{
+  repo::RepoStorage bounded(4, *store);
+  bounded.setEvictionPolicy(ndn::make_unique<FifoEvictionPolicy>(), 2);
+  size_t nDeletions = 0;
+  bounded.afterDataDeletion.connect([&nDeletions] (const Name&) { ++nDeletions; });
+
+  // a full repo evicts the oldest two entries instead of failing the insert
+  for (const auto& data : this->data) {
+    BOOST_CHECK_EQUAL(bounded.insertData(*data), true);
+  }
+  BOOST_CHECK_EQUAL(nDeletions, 6);
+  BOOST_CHECK_EQUAL(store->size(), 4);
+  size_t nInserted = 0;
+  for (const auto& data : this->data) {
+    shared_ptr<Data> found = bounded.readData(Interest(data->getFullName()));
+    if (nInserted++ < 6)
+      BOOST_CHECK(found == nullptr);
+    else
+      BOOST_CHECK_EQUAL(*found, *data);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace tests
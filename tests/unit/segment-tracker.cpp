@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "handles/segment-tracker.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+using ndn::time::milliseconds;
+using ndn::time::nanoseconds;
+using ndn::time::steady_clock;
+
+BOOST_AUTO_TEST_SUITE(TestSegmentTracker)
+
+BOOST_AUTO_TEST_CASE(OutOfOrder)
+{
+  SegmentTracker tracker(10);
+  steady_clock::TimePoint start = steady_clock::now();
+  for (SegmentNo segment = 10; segment < 14; ++segment) {
+    tracker.markSent(segment, start);
+  }
+  BOOST_CHECK_EQUAL(tracker.getNOutstanding(), 4);
+
+  nanoseconds rtt;
+  BOOST_CHECK_EQUAL(tracker.markReceived(12, start + milliseconds(30), rtt), true);
+  BOOST_CHECK(rtt == milliseconds(30));
+  BOOST_CHECK_EQUAL(tracker.getBase(), 10);
+  BOOST_CHECK_EQUAL(tracker.isReceived(12), true);
+  BOOST_CHECK_EQUAL(tracker.isReceived(11), false);
+
+  // a duplicate is not counted twice
+  BOOST_CHECK_EQUAL(tracker.markReceived(12, start, rtt), false);
+  BOOST_CHECK_EQUAL(tracker.getNOutstanding(), 3);
+
+  BOOST_CHECK_EQUAL(tracker.markReceived(10, start, rtt), true);
+  BOOST_CHECK_EQUAL(tracker.getBase(), 11);
+  BOOST_CHECK_EQUAL(tracker.markReceived(11, start, rtt), true);
+  BOOST_CHECK_EQUAL(tracker.getBase(), 13);
+  BOOST_CHECK_EQUAL(tracker.isReceived(10), true);
+
+  // segments never sent are not received
+  BOOST_CHECK_EQUAL(tracker.markReceived(20, start, rtt), false);
+}
+
+BOOST_AUTO_TEST_CASE(Retransmission)
+{
+  SegmentTracker tracker(0);
+  steady_clock::TimePoint start = steady_clock::now();
+  tracker.markSent(0, start);
+  tracker.markSent(1, start);
+  tracker.markSent(2, start);
+
+  BOOST_CHECK_EQUAL(tracker.markTimedOut(2), 1);
+  BOOST_CHECK_EQUAL(tracker.markTimedOut(1), 1);
+  BOOST_CHECK_EQUAL(tracker.markTimedOut(1), 0);
+  BOOST_CHECK_EQUAL(tracker.getNOutstanding(), 1);
+
+  // the lowest segment is retransmitted first
+  BOOST_REQUIRE(tracker.hasRetransmission());
+  BOOST_CHECK_EQUAL(tracker.popRetransmission(), 1);
+  tracker.markSent(1, start);
+  BOOST_CHECK_EQUAL(tracker.markTimedOut(1), 2);
+  BOOST_CHECK_EQUAL(tracker.popRetransmission(), 1);
+  tracker.markSent(1, start);
+
+  // a retransmitted segment gives no RTT sample
+  nanoseconds rtt;
+  BOOST_CHECK_EQUAL(tracker.markReceived(1, start + milliseconds(10), rtt), true);
+  BOOST_CHECK(rtt == nanoseconds::zero());
+
+  // late Data of a timed out segment is still received
+  BOOST_CHECK_EQUAL(tracker.markReceived(2, start, rtt), true);
+  BOOST_CHECK_EQUAL(tracker.hasRetransmission(), false);
+
+  tracker.cancel(0);
+  BOOST_CHECK_EQUAL(tracker.getNOutstanding(), 0);
+  BOOST_CHECK_EQUAL(tracker.getBase(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(Grow)
+{
+  SegmentTracker tracker(5);
+  steady_clock::TimePoint start = steady_clock::now();
+  for (SegmentNo segment = 5; segment < 1005; ++segment) {
+    tracker.markSent(segment, start + milliseconds(segment));
+  }
+  BOOST_CHECK_EQUAL(tracker.getNOutstanding(), 1000);
+
+  nanoseconds rtt;
+  for (SegmentNo segment = 1004; segment > 5; --segment) {
+    BOOST_CHECK_EQUAL(tracker.markReceived(segment, start + milliseconds(2000), rtt), true);
+  }
+  BOOST_CHECK(rtt == milliseconds(2000 - 6));
+  BOOST_CHECK_EQUAL(tracker.getBase(), 5);
+  BOOST_CHECK_EQUAL(tracker.markReceived(5, start, rtt), true);
+  BOOST_CHECK_EQUAL(tracker.getBase(), 1005);
+  BOOST_CHECK_EQUAL(tracker.getNOutstanding(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(End)
+{
+  SegmentTracker tracker(10);
+  SegmentNo end = tracker.getEnd();
+  BOOST_CHECK_GT(end, 10);
+
+  // marking below the end neither grows the ring nor moves the end while the base stays
+  for (SegmentNo segment = 11; segment < end; ++segment) {
+    tracker.markStored(segment);
+  }
+  BOOST_CHECK_EQUAL(tracker.getEnd(), end);
+  BOOST_CHECK_EQUAL(tracker.getBase(), 10);
+
+  tracker.markStored(10);
+  BOOST_CHECK_EQUAL(tracker.getBase(), end);
+  BOOST_CHECK_EQUAL(tracker.getEnd(), 2 * end - 10);
+}
+
+BOOST_AUTO_TEST_CASE(Stored)
+{
+  SegmentTracker tracker(0);
+  steady_clock::TimePoint start = steady_clock::now();
+  tracker.markSent(1, start);
+
+  // stored segments are received without being sent, even far ahead of the base
+  BOOST_CHECK_EQUAL(tracker.markStored(1), true);
+  BOOST_CHECK_EQUAL(tracker.getNOutstanding(), 0);
+  BOOST_CHECK_EQUAL(tracker.markStored(200), true);
+  BOOST_CHECK_EQUAL(tracker.markStored(200), false);
+  BOOST_CHECK_EQUAL(tracker.isReceived(200), true);
+  BOOST_CHECK_EQUAL(tracker.getBase(), 0);
+
+  BOOST_CHECK_EQUAL(tracker.markStored(0), true);
+  BOOST_CHECK_EQUAL(tracker.getBase(), 2);
+
+  nanoseconds rtt;
+  BOOST_CHECK_EQUAL(tracker.markReceived(1, start, rtt), false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -74,6 +74,25 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(InsertReadDelete, T, CommonDatasets, Fixture<T>
   BOOST_CHECK_EQUAL(this->handle->size(), 0);
 }
 
+BOOST_FIXTURE_TEST_CASE(DeletionCount, Fixture<SamePrefixDataset<10>>)
+{
+  std::vector<int64_t> ids;
+  for (const auto& data : this->data) {
+    ids.push_back(handle->insert(*data));
+  }
+  BOOST_CHECK_EQUAL(handle->getNDeleted(), 0);
+
+  BOOST_CHECK_EQUAL(handle->erase(ids[0]), true);
+  BOOST_CHECK_EQUAL(handle->erase(ids[0]), false);
+  BOOST_CHECK_EQUAL(handle->eraseBatch({ids[1], ids[2], ids[3]}), 3);
+  BOOST_CHECK_EQUAL(handle->getNDeleted(), 4);
+
+  // the count is kept in the database
+  repo::SqliteStorage reopened("unittestdb");
+  BOOST_CHECK_EQUAL(reopened.getNDeleted(), 4);
+  BOOST_CHECK_EQUAL(reopened.size(), 6);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace tests
@@ -22,8 +22,11 @@
 #include "../repo-storage-fixture.hpp"
 #include "../dataset-fixtures.hpp"
 
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <fstream>
+
 namespace repo {
 namespace tests {
 
@@ -176,6 +179,174 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(BulkInsertAndRead, T, CommonDatasets, TcpBulkIn
   }
 }
 
+template<class Dataset>
+class TcpBulkInsertAckFixture : public TcpBulkInsertFixture<Dataset>
+{
+public:
+  virtual void
+  onSuccessfullConnect(const boost::system::error_code& error)
+  {
+    TcpClient::onSuccessfullConnect(error);
+
+    for (const auto& data : this->data) {
+      stream.insert(stream.end(), data->wireEncode().begin(), data->wireEncode().end());
+    }
+    // a repeated packet is acknowledged as failed
+    const Block& repeated = this->data.front()->wireEncode();
+    stream.insert(stream.end(), repeated.begin(), repeated.end());
+    // so is an element that is not Data
+    Block other = ndn::makeEmptyBlock(ndn::tlv::Interest);
+    stream.insert(stream.end(), other.begin(), other.end());
+
+    boost::asio::async_write(this->socket, boost::asio::buffer(stream),
+      [this] (const boost::system::error_code& error, size_t) {
+        BOOST_REQUIRE(!error);
+        this->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+      });
+
+    // the repo closes the connection after the final acknowledgement
+    boost::asio::async_read(this->socket, acks,
+      [this] (const boost::system::error_code& error, size_t) {
+        BOOST_CHECK(error == boost::asio::error::eof);
+        this->scheduler.cancelEvent(this->guardEvent);
+        this->socket.close();
+        this->bulkInserter.stop();
+      });
+  }
+
+public:
+  std::vector<uint8_t> stream;
+  boost::asio::streambuf acks;
+};
+
+BOOST_FIXTURE_TEST_CASE(Acknowledgements, TcpBulkInsertAckFixture<SamePrefixDataset<100>>)
+{
+  bulkInserter.setAckInterval(ndn::time::milliseconds(5));
+  bulkInserter.listen("localhost", "17376");
+  start("localhost", "17376");
+  ioService.run();
+
+  // the counts only grow, and the last ones cover every element sent
+  const uint8_t* buffer = boost::asio::buffer_cast<const uint8_t*>(acks.data());
+  size_t size = acks.size();
+  BulkInsertAck last;
+  size_t nAcks = 0;
+  while (size > 0) {
+    bool isOk = false;
+    Block wire;
+    std::tie(isOk, wire) = Block::fromBuffer(buffer, size);
+    BOOST_REQUIRE(isOk);
+    BulkInsertAck ack(wire);
+    BOOST_CHECK_GE(ack.nInserted, last.nInserted);
+    BOOST_CHECK_GE(ack.nFailed, last.nFailed);
+    last = ack;
+    ++nAcks;
+    buffer += wire.size();
+    size -= wire.size();
+  }
+  BOOST_CHECK_GE(nAcks, 1);
+  BOOST_CHECK_EQUAL(last.nInserted, data.size());
+  BOOST_CHECK_EQUAL(last.nFailed, 2);
+
+  for (const auto& interest : interests) {
+    BOOST_CHECK_EQUAL(*handle->readData(interest.first), *interest.second);
+  }
+}
+
+class LocalBulkInsertFixture : public RepoStorageFixture,
+                               public SamePrefixDataset<100>
+{
+public:
+  LocalBulkInsertFixture()
+    : scheduler(ioService)
+    , bulkInserter(ioService, *handle)
+    , socket(ioService)
+  {
+    guardEvent = scheduler.scheduleEvent(ndn::time::seconds(2), [this] {
+        ioService.stop();
+        BOOST_FAIL("Test timed out");
+      });
+  }
+
+  ~LocalBulkInsertFixture()
+  {
+    boost::filesystem::remove(SOCKET_PATH);
+  }
+
+  void
+  send()
+  {
+    for (const auto& item : data) {
+      stream.insert(stream.end(), item->wireEncode().begin(), item->wireEncode().end());
+    }
+
+    socket.async_connect(boost::asio::local::stream_protocol::endpoint(SOCKET_PATH),
+      [this] (const boost::system::error_code& error) {
+        BOOST_REQUIRE(!error);
+        boost::asio::async_write(socket, boost::asio::buffer(stream),
+          [this] (const boost::system::error_code& error, size_t) {
+            BOOST_REQUIRE(!error);
+            socket.shutdown(boost::asio::local::stream_protocol::socket::shutdown_send);
+          });
+        boost::asio::async_read(socket, acks,
+          [this] (const boost::system::error_code& error, size_t) {
+            BOOST_CHECK(error == boost::asio::error::eof);
+            scheduler.cancelEvent(guardEvent);
+            socket.close();
+            bulkInserter.stop();
+          });
+      });
+  }
+
+public:
+  static const std::string SOCKET_PATH;
+
+  boost::asio::io_service ioService;
+  Scheduler scheduler;
+  ndn::EventId guardEvent;
+  repo::TcpBulkInsertHandle bulkInserter;
+  boost::asio::local::stream_protocol::socket socket;
+  std::vector<uint8_t> stream;
+  boost::asio::streambuf acks;
+};
+
+const std::string LocalBulkInsertFixture::SOCKET_PATH = "unittest-bulk-insert.sock";
+
+BOOST_FIXTURE_TEST_CASE(LocalSocket, LocalBulkInsertFixture)
+{
+  bulkInserter.setAckInterval(ndn::time::milliseconds(5));
+  bulkInserter.listenLocal(SOCKET_PATH);
+  send();
+  ioService.run();
+
+  BOOST_CHECK(!boost::filesystem::exists(SOCKET_PATH));
+  BOOST_REQUIRE_GT(acks.size(), 0);
+
+  for (const auto& interest : interests) {
+    BOOST_CHECK_EQUAL(*handle->readData(interest.first), *interest.second);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(LocalSocketPathInUse, LocalBulkInsertFixture)
+{
+  // a file that is not a socket is left alone
+  std::ofstream(SOCKET_PATH) << "not a socket";
+  BOOST_CHECK_THROW(bulkInserter.listenLocal(SOCKET_PATH), boost::system::system_error);
+  BOOST_CHECK(boost::filesystem::is_regular_file(SOCKET_PATH));
+  boost::filesystem::remove(SOCKET_PATH);
+
+  // and so is a socket some other process listens on
+  boost::asio::local::stream_protocol::acceptor other(ioService,
+    boost::asio::local::stream_protocol::endpoint(SOCKET_PATH));
+  BOOST_CHECK_THROW(bulkInserter.listenLocal(SOCKET_PATH), repo::TcpBulkInsertHandle::Error);
+
+  // while a socket left over by a previous run is replaced
+  other.close();
+  bulkInserter.listenLocal(SOCKET_PATH);
+  bulkInserter.stop();
+  BOOST_CHECK(!boost::filesystem::exists(SOCKET_PATH));
+  scheduler.cancelEvent(guardEvent);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "handles/tcp-bulk-read-handle.hpp"
+#include "storage/sqlite-storage.hpp"
+#include "../repo-storage-fixture.hpp"
+#include "../dataset-fixtures.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TcpBulkReadHandle)
+
+template<class Dataset>
+class TcpBulkReadFixture : public RepoStorageFixture,
+                           public Dataset
+{
+public:
+  TcpBulkReadFixture()
+    : scheduler(ioService)
+    , bulkReader(ioService, *handle)
+    , socket(ioService)
+  {
+    guardEvent = scheduler.scheduleEvent(ndn::time::seconds(2), [this] {
+        ioService.stop();
+        BOOST_FAIL("Test timed out");
+      });
+
+    for (const auto& data : this->data) {
+      handle->insertData(*data);
+    }
+  }
+
+  /**
+   * @brief request everything under @p prefix and collect the Data received
+   */
+  void
+  read(const Name& prefix)
+  {
+    bulkReader.listen("localhost", "17378");
+
+    boost::asio::ip::tcp::resolver resolver(ioService);
+    auto endpoint = resolver.resolve(boost::asio::ip::tcp::resolver::query("localhost", "17378"));
+    request = prefix.wireEncode();
+    socket.async_connect(*endpoint, [this] (const boost::system::error_code& error) {
+        BOOST_REQUIRE(!error);
+        boost::asio::async_write(socket, boost::asio::buffer(request.wire(), request.size()),
+                                 [] (const boost::system::error_code&, size_t) {});
+        boost::asio::async_read(socket, stream,
+          [this] (const boost::system::error_code& error, size_t) {
+            BOOST_CHECK(error == boost::asio::error::eof);
+            scheduler.cancelEvent(guardEvent);
+            socket.close();
+            bulkReader.stop();
+          });
+      });
+    ioService.run();
+
+    const uint8_t* buffer = boost::asio::buffer_cast<const uint8_t*>(stream.data());
+    size_t size = stream.size();
+    while (size > 0) {
+      bool isOk = false;
+      Block wire;
+      std::tie(isOk, wire) = Block::fromBuffer(buffer, size);
+      BOOST_REQUIRE(isOk);
+      received.push_back(make_shared<Data>(wire));
+      buffer += wire.size();
+      size -= wire.size();
+    }
+  }
+
+public:
+  boost::asio::io_service ioService;
+  Scheduler scheduler;
+  ndn::EventId guardEvent;
+  repo::TcpBulkReadHandle bulkReader;
+  boost::asio::ip::tcp::socket socket;
+  Block request;
+  boost::asio::streambuf stream;
+  std::vector<shared_ptr<Data>> received;
+};
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(ReadAll, T, CommonDatasets, TcpBulkReadFixture<T>)
+{
+  BOOST_TEST_MESSAGE(T::getName());
+
+  this->read("/");
+
+  BOOST_REQUIRE_EQUAL(this->received.size(), this->data.size());
+  for (size_t i = 0; i < this->received.size(); ++i) {
+    BOOST_CHECK(this->handle->hasData(*this->received[i]));
+    if (i > 0)
+      BOOST_CHECK_LT(this->received[i - 1]->getFullName(), this->received[i]->getFullName());
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(ReadPrefix, TcpBulkReadFixture<SamePrefixDataset<10>>)
+{
+  // a prefix with nothing under it gives an empty stream
+  read("/no/such/prefix");
+  BOOST_CHECK_EQUAL(received.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
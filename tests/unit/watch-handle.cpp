@@ -0,0 +1,192 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "handles/watch-handle.hpp"
+#include "storage/sqlite-storage.hpp"
+
+#include "../repo-storage-fixture.hpp"
+
+#include <ndn-cxx/lp/nack.hpp>
+#include <ndn-cxx/security/validator-null.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestWatchHandle)
+
+class Fixture : public RepoStorageFixture
+{
+public:
+  Fixture()
+    : face(ndn::util::DummyClientFace::Options{true, true})
+    , keyChain("pib-memory:", "tpm-memory:")
+    , scheduler(face.getIoService())
+    , watchHandle(face, *handle, keyChain, scheduler, validator)
+  {
+  }
+
+  static WatchHandle::WatchProcess
+  makeProcess()
+  {
+    WatchHandle::WatchProcess process;
+    process.name = Name("/watched");
+    process.maxWindow = 64;
+    return process;
+  }
+
+  /**
+   * @brief send the watch command @p verb for @p name to the handle
+   */
+  void
+  command(const std::string& verb, const Name& name)
+  {
+    RepoCommandParameter parameter;
+    parameter.setName(name);
+    face.receive(Interest(Name("/repo/watch").append(name::Component(verb))
+                                             .append(parameter.wireEncode())));
+    face.processEvents(milliseconds(-1));
+  }
+
+  static name::Component
+  makeChild(size_t i)
+  {
+    // children of equal length sort like their numbers
+    char child[8];
+    std::snprintf(child, sizeof(child), "c%03zu", i);
+    return name::Component(child);
+  }
+
+public:
+  ndn::util::DummyClientFace face;
+  ndn::KeyChain keyChain;
+  ndn::Scheduler scheduler;
+  ndn::security::v2::ValidatorNull validator;
+  WatchHandle watchHandle;
+};
+
+BOOST_FIXTURE_TEST_CASE(Window, Fixture)
+{
+  WatchHandle::WatchProcess process = makeProcess();
+
+  // unpredictable children are fetched one at a time
+  process.numbering = WatchHandle::WatchProcess::NUMBERING_NONE;
+  BOOST_CHECK_EQUAL(watchHandle.getWindow(process), 1);
+
+  // numbered children start with a small window until the rates are known
+  process.numbering = WatchHandle::WatchProcess::NUMBERING_SEQUENCE;
+  BOOST_CHECK_EQUAL(watchHandle.getWindow(process), 2);
+
+  // one more than the Data published during a round trip
+  process.publishInterval = milliseconds(10);
+  process.minRtt = milliseconds(35);
+  BOOST_CHECK_EQUAL(watchHandle.getWindow(process), 5);
+
+  process.maxWindow = 3;
+  BOOST_CHECK_EQUAL(watchHandle.getWindow(process), 3);
+}
+
+BOOST_AUTO_TEST_CASE(ExcludeStoredChildren)
+{
+  WatchHandle::WatchProcess process = Fixture::makeProcess();
+
+  // children found in the index are excluded one by one, never with a range
+  for (size_t i = 0; i < 150; ++i) {
+    WatchHandle::rememberChild(process, Fixture::makeChild(i), false);
+  }
+  ndn::Exclude exclude = WatchHandle::makeExclude(process);
+  BOOST_CHECK(exclude.isExcluded(Fixture::makeChild(149)));
+  BOOST_CHECK(exclude.isExcluded(Fixture::makeChild(50)));
+  BOOST_CHECK(!exclude.isExcluded(Fixture::makeChild(0)));
+  BOOST_CHECK(!exclude.isExcluded(name::Component("b")));
+}
+
+BOOST_AUTO_TEST_CASE(ExcludeRangeOfFetchedChildren)
+{
+  WatchHandle::WatchProcess process = Fixture::makeProcess();
+
+  // children fetched in increasing order let the oldest ones collapse into a range
+  for (size_t i = 0; i < 150; ++i) {
+    WatchHandle::rememberChild(process, Fixture::makeChild(i), true);
+  }
+  ndn::Exclude exclude = WatchHandle::makeExclude(process);
+  BOOST_CHECK(exclude.isExcluded(Fixture::makeChild(0)));
+  BOOST_CHECK(exclude.isExcluded(Fixture::makeChild(149)));
+  BOOST_CHECK(!exclude.isExcluded(Fixture::makeChild(150)));
+
+  // a child fetched out of order drops the range, which could hide children not stored
+  WatchHandle::rememberChild(process, name::Component("a"), true);
+  exclude = WatchHandle::makeExclude(process);
+  BOOST_CHECK(!process.isMonotonic);
+  BOOST_CHECK(exclude.isExcluded(name::Component("a")));
+  BOOST_CHECK(exclude.isExcluded(Fixture::makeChild(149)));
+  BOOST_CHECK(!exclude.isExcluded(name::Component("b")));
+  BOOST_CHECK(!exclude.isExcluded(Fixture::makeChild(0)));
+
+  // and no range comes back
+  for (size_t i = 150; i < 300; ++i) {
+    WatchHandle::rememberChild(process, Fixture::makeChild(i), true);
+  }
+  exclude = WatchHandle::makeExclude(process);
+  BOOST_CHECK(!exclude.isExcluded(name::Component("b")));
+  BOOST_CHECK(exclude.isExcluded(Fixture::makeChild(299)));
+}
+
+BOOST_FIXTURE_TEST_CASE(ConcurrentWatches, Fixture)
+{
+  watchHandle.listen(Name("/repo"));
+  face.processEvents(milliseconds(-1));
+
+  command("start", Name("/watched/a"));
+  command("start", Name("/watched/b"));
+  BOOST_REQUIRE_EQUAL(watchHandle.m_processes.size(), 2);
+  shared_ptr<WatchHandle::WatchProcess> a = watchHandle.m_processes[Name("/watched/a")];
+  shared_ptr<WatchHandle::WatchProcess> b = watchHandle.m_processes[Name("/watched/b")];
+  BOOST_CHECK_EQUAL(a->interestNum, 1);
+  BOOST_CHECK_EQUAL(b->interestNum, 1);
+
+  // stopping one watch leaves the other as it was
+  command("stop", Name("/watched/a"));
+  BOOST_CHECK(!a->isRunning);
+  BOOST_CHECK(b->isRunning);
+  BOOST_CHECK_EQUAL(b->interestNum, 1);
+  BOOST_CHECK_EQUAL(b->nOutstanding, 1);
+
+  // when the Interests of both fail, only the running watch asks again
+  std::vector<Interest> interests = face.sentInterests;
+  for (const Interest& interest : interests) {
+    if (Name("/watched").isPrefixOf(interest.getName())) {
+      ndn::lp::Nack nack(interest);
+      nack.setReason(ndn::lp::NackReason::NO_ROUTE);
+      face.receive(nack);
+    }
+  }
+  face.processEvents(milliseconds(-1));
+  BOOST_CHECK_EQUAL(a->interestNum, 1);
+  BOOST_CHECK_EQUAL(b->interestNum, 2);
+  BOOST_CHECK_EQUAL(b->nOutstanding, 1);
+  BOOST_CHECK(b->isRunning);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo
@@ -0,0 +1,378 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2017, Regents of the University of California.
+ *
+ * This file is part of NDN repo-ng (Next generation of NDN repository).
+ * See AUTHORS.md for complete list of repo-ng authors and contributors.
+ *
+ * repo-ng is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * repo-ng is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * repo-ng, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "handles/write-handle.hpp"
+#include "storage/sqlite-storage.hpp"
+
+#include "../identity-management-fixture.hpp"
+#include "../repo-storage-fixture.hpp"
+#include "../unit-test-time-fixture.hpp"
+
+#include <ndn-cxx/security/validator-null.hpp>
+#include <ndn-cxx/util/dummy-client-face.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+namespace repo {
+namespace tests {
+
+BOOST_AUTO_TEST_SUITE(TestWriteHandle)
+
+static const Name REPO_PREFIX("/repo");
+static const Name DATA_PREFIX("/data/file");
+static const std::string CHECKPOINT_PATH("unittestdb/insert-checkpoint");
+
+class Fixture : public UnitTestTimeFixture, public IdentityManagementFixture,
+                public RepoStorageFixture
+{
+public:
+  Fixture()
+    : delay(100)
+  {
+    makeHandle();
+  }
+
+  /**
+   * @brief make a new face and handle over the same storage, as after a restart
+   */
+  void
+  makeHandle()
+  {
+    writeHandle.reset();
+    face.reset();
+    scheduler.reset();
+
+    scheduler.reset(new ndn::Scheduler(io));
+    face.reset(new ndn::util::DummyClientFace(io, m_keyChain,
+                                              ndn::util::DummyClientFace::Options{true, true}));
+    face->onSendInterest.connect(bind(&Fixture::onSendInterest, this, _1));
+    writeHandle.reset(new WriteHandle(*face, *handle, m_keyChain, *scheduler, validator));
+    writeHandle->setCheckpointPath(CHECKPOINT_PATH, ndn::time::seconds(1));
+    writeHandle->listen(REPO_PREFIX);
+    advanceClocks(ndn::time::milliseconds(1), 10);
+  }
+
+  shared_ptr<Data>
+  makeSegment(const Name& prefix, SegmentNo segment, SegmentNo finalSegment)
+  {
+    auto data = make_shared<Data>(Name(prefix).appendSegment(segment));
+    data->setContent(reinterpret_cast<const uint8_t*>(&segment), sizeof(segment));
+    data->setFinalBlockId(name::Component::fromSegment(finalSegment));
+    m_keyChain.sign(*data);
+    return data;
+  }
+
+  /**
+   * @brief answer the segment Interests of the handle like a producer behind a link
+   *
+   * An Interest is answered after #delay, unless its prefix has no final segment, its
+   * segment is beyond the final one, or it is to be dropped.
+   */
+  void
+  onSendInterest(const Interest& interest)
+  {
+    const Name& name = interest.getName();
+    auto finalSegment = finalSegments.find(name.getPrefix(-1));
+    if (finalSegment == finalSegments.end() || name.get(-1).toSegment() > finalSegment->second)
+      return;
+    auto drop = drops.find(name);
+    if (drop != drops.end() && drop->second-- > 0)
+      return;
+
+    shared_ptr<Data> data = makeSegment(name.getPrefix(-1), name.get(-1).toSegment(),
+                                        finalSegment->second);
+    scheduler->scheduleEvent(delay, [this, data] { face->receive(*data); });
+  }
+
+  /**
+   * @brief the Interests the face sent for @p segment of @p prefix
+   */
+  std::vector<Interest>
+  getSentInterests(const Name& prefix, SegmentNo segment)
+  {
+    Name name = Name(prefix).appendSegment(segment);
+    std::vector<Interest> interests;
+    for (const Interest& interest : face->sentInterests) {
+      if (interest.getName() == name)
+        interests.push_back(interest);
+    }
+    return interests;
+  }
+
+  /**
+   * @brief send a command to the handle and return its response
+   */
+  RepoCommandResponse
+  command(const std::string& verb, const RepoCommandParameter& parameter)
+  {
+    Interest interest(Name(REPO_PREFIX).append(name::Component(verb))
+                                        .append(parameter.wireEncode()));
+    m_keyChain.sign(interest);
+    face->sentData.clear();
+    face->receive(interest);
+    advanceClocks(ndn::time::milliseconds(1), 10);
+
+    BOOST_REQUIRE_EQUAL(face->sentData.size(), 1);
+    RepoCommandResponse response;
+    response.wireDecode(face->sentData[0].getContent().blockFromValue());
+    return response;
+  }
+
+  ProcessId
+  insert(const Name& prefix, SegmentNo endBlockId,
+         const ndn::time::milliseconds& interestLifetime = ndn::time::milliseconds(4000))
+  {
+    RepoCommandParameter parameter;
+    parameter.setName(prefix);
+    parameter.setStartBlockId(0);
+    parameter.setEndBlockId(endBlockId);
+    parameter.setInterestLifetime(interestLifetime);
+    RepoCommandResponse response = command("insert", parameter);
+    BOOST_REQUIRE_EQUAL(response.getStatusCode(), 100);
+    return response.getProcessId();
+  }
+
+  RepoCommandResponse
+  check(ProcessId processId)
+  {
+    RepoCommandParameter parameter;
+    parameter.setProcessId(processId);
+    return command("insert check", parameter);
+  }
+
+  /**
+   * @brief the segments the face asked for since the last call, in order
+   */
+  std::vector<SegmentNo>
+  takeRequestedSegments()
+  {
+    std::vector<SegmentNo> segments;
+    for (const Interest& interest : face->sentInterests) {
+      if (DATA_PREFIX.isPrefixOf(interest.getName()))
+        segments.push_back(interest.getName().get(-1).toSegment());
+    }
+    face->sentInterests.clear();
+    return segments;
+  }
+
+  void
+  receiveSegments(const std::vector<SegmentNo>& segments, SegmentNo finalSegment)
+  {
+    for (SegmentNo segment : segments) {
+      face->receive(*makeSegment(DATA_PREFIX, segment, finalSegment));
+    }
+    advanceClocks(ndn::time::milliseconds(1), 10);
+  }
+
+public:
+  ndn::time::milliseconds delay;  ///< how long the producer takes to answer
+  std::map<Name, SegmentNo> finalSegments;  ///< final segment of each prefix with a producer
+  std::map<Name, int> drops;  ///< number of Interests to drop for each segment name
+
+  ndn::security::v2::ValidatorNull validator;
+  unique_ptr<ndn::Scheduler> scheduler;
+  unique_ptr<ndn::util::DummyClientFace> face;
+  unique_ptr<WriteHandle> writeHandle;
+};
+
+BOOST_FIXTURE_TEST_CASE(ResumeProcess, Fixture)
+{
+  const SegmentNo finalSegment = 19;
+  ProcessId processId = insert(DATA_PREFIX, finalSegment);
+
+  // the first segments arrive, with a gap at 3 and 4
+  std::vector<SegmentNo> requested = takeRequestedSegments();
+  BOOST_REQUIRE_GE(requested.size(), 6);
+  receiveSegments({0, 1, 2, 5}, finalSegment);
+  BOOST_CHECK_EQUAL(check(processId).getInsertNum(), 4);
+  writeHandle->saveCheckpoint();
+
+  // the repo restarts; meanwhile segments 8 and 9 got into storage, e.g. by a bulk insert
+  makeHandle();
+  handle->insertData(*makeSegment(DATA_PREFIX, 8, finalSegment));
+  handle->insertData(*makeSegment(DATA_PREFIX, 9, finalSegment));
+  writeHandle->resumeProcesses();
+  advanceClocks(ndn::time::milliseconds(1), 10);
+
+  RepoCommandResponse response = check(processId);
+  BOOST_CHECK_EQUAL(response.getStatusCode(), 300);
+  BOOST_CHECK_EQUAL(response.getProcessId(), processId);
+  BOOST_CHECK_EQUAL(response.getInsertNum(), 6);
+
+  // only the missing segments are fetched, each once
+  requested.clear();
+  for (std::vector<SegmentNo> segments = takeRequestedSegments(); !segments.empty();
+       segments = takeRequestedSegments()) {
+    requested.insert(requested.end(), segments.begin(), segments.end());
+    receiveSegments(segments, finalSegment);
+  }
+  std::sort(requested.begin(), requested.end());
+  std::vector<SegmentNo> missing{3, 4, 6, 7, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
+  BOOST_CHECK_EQUAL_COLLECTIONS(requested.begin(), requested.end(),
+                                missing.begin(), missing.end());
+
+  response = check(processId);
+  BOOST_CHECK_EQUAL(response.getStatusCode(), 200);
+  BOOST_CHECK_EQUAL(response.getProcessId(), processId);
+  BOOST_CHECK_EQUAL(response.getInsertNum(), finalSegment + 1);
+  for (SegmentNo segment = 0; segment <= finalSegment; ++segment) {
+    BOOST_CHECK(handle->hasName(Name(DATA_PREFIX).appendSegment(segment)));
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(InterestLifetime, Fixture)
+{
+  finalSegments[DATA_PREFIX] = 49;
+  ProcessId processId = insert(DATA_PREFIX, 49);
+  advanceClocks(ndn::time::milliseconds(10), 100);
+
+  // Interests live for the initial RTO until the first RTT sample, then for the RTO of the
+  // samples, which a steady 100ms RTT brings down to the minimum
+  for (SegmentNo segment = 0; segment < 12; ++segment) {
+    std::vector<Interest> interests = getSentInterests(DATA_PREFIX, segment);
+    BOOST_REQUIRE_EQUAL(interests.size(), 1);
+    BOOST_CHECK_EQUAL(interests[0].getInterestLifetime(), ndn::time::milliseconds(1000));
+  }
+  std::vector<Interest> interests = getSentInterests(DATA_PREFIX, 49);
+  BOOST_REQUIRE_EQUAL(interests.size(), 1);
+  BOOST_CHECK_EQUAL(interests[0].getInterestLifetime(), ndn::time::milliseconds(200));
+
+  RepoCommandResponse response = check(processId);
+  BOOST_CHECK_EQUAL(response.getStatusCode(), 200);
+  BOOST_CHECK_EQUAL(response.getInsertNum(), 50);
+}
+
+BOOST_FIXTURE_TEST_CASE(TimeoutBackoff, Fixture)
+{
+  finalSegments[DATA_PREFIX] = 29;
+  drops[Name(DATA_PREFIX).appendSegment(5)] = 2;
+  ProcessId processId = insert(DATA_PREFIX, 29);
+
+  // every other segment arrives, opening the window by one each in slow start
+  advanceClocks(ndn::time::milliseconds(10), 90);
+  WriteHandle::ProcessInfo& process = writeHandle->m_processes[processId];
+  BOOST_CHECK_EQUAL(process.window.getSize(), 12 + 29);
+  BOOST_CHECK_EQUAL(process.rttEstimator.getRto(), ndn::time::milliseconds(200));
+  BOOST_CHECK_EQUAL(writeHandle->getNOutstanding(), 1);
+
+  // segment 5 times out: the window is halved, and the RTO doubled for its retry
+  advanceClocks(ndn::time::milliseconds(10), 20);
+  BOOST_CHECK_EQUAL(process.window.getSize(), (12 + 29) / 2);
+  BOOST_CHECK_EQUAL(process.rttEstimator.getRto(), ndn::time::milliseconds(400));
+
+  // the retry times out too, in the same congestion event, so only the RTO doubles again
+  advanceClocks(ndn::time::milliseconds(10), 100);
+  std::vector<Interest> interests = getSentInterests(DATA_PREFIX, 5);
+  BOOST_REQUIRE_EQUAL(interests.size(), 3);
+  BOOST_CHECK_EQUAL(interests[0].getInterestLifetime(), ndn::time::milliseconds(1000));
+  BOOST_CHECK_EQUAL(interests[1].getInterestLifetime(), ndn::time::milliseconds(400));
+  BOOST_CHECK_EQUAL(interests[2].getInterestLifetime(), ndn::time::milliseconds(800));
+  BOOST_CHECK_EQUAL(process.window.getSize(), (12 + 29) / 2);
+
+  RepoCommandResponse response = check(processId);
+  BOOST_CHECK_EQUAL(response.getStatusCode(), 200);
+  BOOST_CHECK_EQUAL(response.getInsertNum(), 30);
+  BOOST_CHECK_EQUAL(writeHandle->getNOutstanding(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(GiveUp, Fixture)
+{
+  finalSegments[DATA_PREFIX] = 9;
+  drops[Name(DATA_PREFIX).appendSegment(0)] = std::numeric_limits<int>::max();
+  ProcessId processId = insert(DATA_PREFIX, 9, ndn::time::milliseconds(500));
+  advanceClocks(ndn::time::milliseconds(10), 300);
+
+  // segment 0 is tried retrytimes more times, never for longer than the InterestLifetime of
+  // the command, then the process fails
+  std::vector<Interest> interests = getSentInterests(DATA_PREFIX, 0);
+  BOOST_REQUIRE_EQUAL(interests.size(), 4);
+  BOOST_CHECK_EQUAL(interests[0].getInterestLifetime(), ndn::time::milliseconds(500));
+  for (const Interest& interest : interests) {
+    BOOST_CHECK_LE(interest.getInterestLifetime(), ndn::time::milliseconds(500));
+  }
+  BOOST_CHECK_EQUAL(check(processId).getStatusCode(), 404);
+  BOOST_CHECK_EQUAL(writeHandle->getNOutstanding(), 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(FinalBlockIdLearnedLater, Fixture)
+{
+  finalSegments[DATA_PREFIX] = 4;
+  RepoCommandParameter parameter;
+  parameter.setName(DATA_PREFIX);
+  parameter.setStartBlockId(0);
+  ProcessId processId = command("insert", parameter).getProcessId();
+
+  // the first window goes out before the FinalBlockId is known
+  advanceClocks(ndn::time::milliseconds(10), 5);
+  BOOST_CHECK_EQUAL(writeHandle->getNOutstanding(), 12);
+
+  // the segments past it time out, and are neither retried nor taken for congestion
+  advanceClocks(ndn::time::milliseconds(10), 200);
+  for (SegmentNo segment = 0; segment < 12; ++segment) {
+    BOOST_CHECK_EQUAL(getSentInterests(DATA_PREFIX, segment).size(), 1);
+  }
+  BOOST_CHECK_EQUAL(getSentInterests(DATA_PREFIX, 12).size(), 0);
+  BOOST_CHECK_EQUAL(writeHandle->m_processes[processId].window.getSize(), 12 + 5);
+  BOOST_CHECK_EQUAL(writeHandle->getNOutstanding(), 0);
+
+  RepoCommandResponse response = check(processId);
+  BOOST_CHECK_EQUAL(response.getStatusCode(), 200);
+  BOOST_CHECK_EQUAL(response.getEndBlockId(), 4);
+  BOOST_CHECK_EQUAL(response.getInsertNum(), 5);
+}
+
+BOOST_FIXTURE_TEST_CASE(SharedBudget, Fixture)
+{
+  // the unreachable insert takes the whole budget first, and fails while still holding
+  // part of it
+  const Name unreachablePrefix("/data/unreachable");
+  finalSegments[DATA_PREFIX] = 99;
+  writeHandle->setMaxOutstanding(12);
+  ProcessId unreachable = insert(unreachablePrefix, 99);
+  insert(DATA_PREFIX, 99);
+  BOOST_CHECK_EQUAL(writeHandle->getNOutstanding(), 12);
+
+  size_t nOutstandingAtFailure = 0;
+  for (int i = 0; i < 3000; ++i) {
+    advanceClocks(ndn::time::milliseconds(10));
+
+    // Interests of a failed process may still time out, and are no longer counted
+    size_t nOutstanding = 0;
+    for (const auto& entry : writeHandle->m_processes) {
+      nOutstanding += entry.second.segments.getNOutstanding();
+    }
+    BOOST_REQUIRE_EQUAL(writeHandle->getNOutstanding(), nOutstanding);
+    BOOST_REQUIRE_LE(writeHandle->getNOutstanding(), 12);
+
+    if (writeHandle->m_processes.count(unreachable) > 0)
+      nOutstandingAtFailure = writeHandle->m_processes[unreachable].segments.getNOutstanding();
+  }
+  BOOST_CHECK_EQUAL(writeHandle->m_processes.count(unreachable), 0);
+  BOOST_CHECK_GT(nOutstandingAtFailure, 1);
+  BOOST_CHECK_EQUAL(writeHandle->getNOutstanding(), 0);
+
+  for (SegmentNo segment = 0; segment <= 99; ++segment) {
+    BOOST_CHECK(handle->hasName(Name(DATA_PREFIX).appendSegment(segment)));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace repo